@@ -0,0 +1,483 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+// Headless benchmarks of the font engine, the glyph caches and the LCD
+// pixel formats. Each result is printed as one JSON object per line:
+//
+//   {"name": "prepare_glyph/outline", "iterations": 120, "seconds": 0.5,
+//    "items": 11400, "rate": 22800.0, "unit": "glyph"}
+//
+// where rate is items per second.
+//
+//   agg-font-bench [-t seconds] [-f filter] [-o file] font-file
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <ft2build.h>
+#include FT_GLYPH_H
+
+#include "agg_font_freetype.h"
+#include "agg_font_text.h"
+#include "agg_gamma_lut.h"
+#include "agg_pixfmt_rgb24_lcd.h"
+#include "agg_rasterizer_scanline_aa.h"
+#include "agg_renderer_base.h"
+#include "agg_renderer_scanline.h"
+#include "agg_rendering_buffer.h"
+#include "agg_scanline_u.h"
+
+namespace {
+
+const char paragraph[] =
+    "The quick brown fox jumps over the lazy dog. Pack my box with five\n"
+    "dozen liquor jugs! How vexingly quick daft zebras jump; sphinx of\n"
+    "black quartz, judge my vow. \"Waltz, bad nymph, for quick jigs vex.\"\n"
+    "Typography (1450-2024): 0123456789 & @#$%^*+=<>[]{}|~/\\ AVAWATAY\n"
+    "Fjord, office, waffle, Yoyo; To, Ta, Te, LT, VA, P., r. y, f) j]\n";
+
+const unsigned paragraph_len = sizeof(paragraph) - 1;
+const double font_height = 13.0;
+
+//------------------------------------------------------------------------
+double now() {
+#ifdef _WIN32
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return double(count.QuadPart) / double(freq.QuadPart);
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return double(ts.tv_sec) + double(ts.tv_nsec) * 1e-9;
+#endif
+}
+
+//------------------------------------------------------------------------
+struct bench_config {
+  double min_time;
+  const char* filter;
+  const char* font;
+  FILE* out;
+};
+
+bench_config config;
+
+// Run f until min_time has elapsed, each call processes items units
+template <class F>
+void run(const char* name, const char* unit, double items, F& f) {
+  if (config.filter && strstr(name, config.filter) == 0) return;
+  f();  // Warm up
+  unsigned long n = 0;
+  double start = now();
+  double elapsed;
+  do {
+    f();
+    ++n;
+    elapsed = now() - start;
+  } while (elapsed < config.min_time);
+  fprintf(config.out,
+          "{\"name\": \"%s\", \"iterations\": %lu, \"seconds\": %.6f, "
+          "\"items\": %.0f, \"rate\": %.1f, \"unit\": \"%s\"}\n",
+          name, n, elapsed, items * n, items * n / elapsed, unit);
+  fflush(config.out);
+}
+
+typedef agg::font_engine_freetype_int32 font_engine_type;
+typedef agg::font_cache_manager<font_engine_type> font_manager_type;
+
+//------------------------------------------------------------------------
+struct paragraph_codes {
+  unsigned codes[paragraph_len];
+  unsigned num_codes;
+
+  paragraph_codes() : num_codes(0) {
+    for (unsigned i = 0; i < paragraph_len; ++i) {
+      if (paragraph[i] == '\n') continue;
+      codes[num_codes++] = (unsigned char)paragraph[i];
+    }
+  }
+};
+
+//------------------------------------------------------------------------
+struct prepare_glyph_bench {
+  font_engine_type* feng;
+  const paragraph_codes* text;
+  agg::pod_array<agg::int8u> buf;
+
+  void operator()() {
+    for (unsigned i = 0; i < text->num_codes; ++i) {
+      if (feng->prepare_glyph(text->codes[i])) {
+        if (buf.size() < feng->data_size()) buf.resize(feng->data_size());
+        feng->write_glyph_to(&buf[0]);
+      }
+    }
+  }
+};
+
+void bench_prepare_glyph(const paragraph_codes& text) {
+  static const struct {
+    const char* name;
+    agg::glyph_rendering mode;
+  } modes[] = {{"prepare_glyph/native_mono", agg::glyph_ren_native_mono},
+               {"prepare_glyph/native_gray8", agg::glyph_ren_native_gray8},
+               {"prepare_glyph/outline", agg::glyph_ren_outline},
+               {"prepare_glyph/agg_mono", agg::glyph_ren_agg_mono},
+               {"prepare_glyph/agg_gray8", agg::glyph_ren_agg_gray8}};
+  for (unsigned i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i) {
+    font_engine_type feng;
+    if (!feng.load_font(config.font, 0, modes[i].mode)) continue;
+    feng.height(font_height);
+    prepare_glyph_bench b;
+    b.feng = &feng;
+    b.text = &text;
+    b.buf.resize(4096);
+    run(modes[i].name, "glyph", text.num_codes, b);
+  }
+}
+
+//------------------------------------------------------------------------
+struct load_font_cold_bench {
+  void operator()() {
+    font_engine_type feng;
+    feng.load_font(config.font, 0, agg::glyph_ren_outline);
+    feng.height(font_height);
+  }
+};
+
+struct load_font_warm_bench {
+  font_engine_type* feng;
+  void operator()() {
+    feng->load_font(config.font, 0, agg::glyph_ren_outline);
+    feng->height(font_height);
+  }
+};
+
+void bench_load_font() {
+  load_font_cold_bench cold;
+  run("load_font/cold", "font", 1, cold);
+  font_engine_type feng;
+  feng.load_font(config.font, 0, agg::glyph_ren_outline);
+  load_font_warm_bench warm;
+  warm.feng = &feng;
+  run("load_font/warm", "font", 1, warm);
+}
+
+//------------------------------------------------------------------------
+struct ft_glyphs {
+  FT_Library library;
+  FT_Face face;
+  agg::pod_vector<FT_Glyph> glyphs;
+
+  ft_glyphs() : library(0), face(0), glyphs(paragraph_len) {}
+  ~ft_glyphs() {
+    for (unsigned i = 0; i < glyphs.size(); ++i) FT_Done_Glyph(glyphs[i]);
+    if (face) FT_Done_Face(face);
+    if (library) FT_Done_FreeType(library);
+  }
+
+  // Load the glyphs of the text, rendered to bitmaps unless outline
+  bool load(const paragraph_codes& text, bool outline, FT_Render_Mode mode) {
+    if (FT_Init_FreeType(&library) ||
+        FT_New_Face(library, config.font, 0, &face) ||
+        FT_Set_Char_Size(face, 0, int(font_height * 64), 0, 0)) {
+      return false;
+    }
+    for (unsigned i = 0; i < text.num_codes; ++i) {
+      FT_UInt index = FT_Get_Char_Index(face, text.codes[i]);
+      FT_Glyph glyph;
+      if (FT_Load_Glyph(face, index, FT_LOAD_NO_HINTING) ||
+          FT_Get_Glyph(face->glyph, &glyph)) {
+        continue;
+      }
+      if (!outline && FT_Glyph_To_Bitmap(&glyph, mode, 0, 1)) {
+        FT_Done_Glyph(glyph);
+        continue;
+      }
+      glyphs.add(glyph);
+    }
+    return glyphs.size() > 0;
+  }
+};
+
+template <class PathStorage>
+struct decompose_outline_bench {
+  const ft_glyphs* src;
+  agg::trans_affine mtx;
+  PathStorage path;
+
+  void operator()() {
+    for (unsigned i = 0; i < src->glyphs.size(); ++i) {
+      path.remove_all();
+      agg::decompose_ft_outline(((FT_OutlineGlyph)src->glyphs[i])->outline,
+                                true, mtx, path);
+    }
+  }
+};
+
+struct decompose_mono_bench {
+  const ft_glyphs* src;
+  agg::scanline_bin sl;
+  agg::scanline_storage_bin storage;
+
+  void operator()() {
+    for (unsigned i = 0; i < src->glyphs.size(); ++i) {
+      FT_BitmapGlyph g = (FT_BitmapGlyph)src->glyphs[i];
+      agg::decompose_ft_bitmap_mono(g->bitmap, g->left, -g->top, true, sl,
+                                    storage);
+    }
+  }
+};
+
+struct decompose_gray8_bench {
+  const ft_glyphs* src;
+  agg::rasterizer_scanline_aa<> ras;
+  agg::scanline_u8 sl;
+  agg::scanline_storage_aa8 storage;
+
+  void operator()() {
+    for (unsigned i = 0; i < src->glyphs.size(); ++i) {
+      FT_BitmapGlyph g = (FT_BitmapGlyph)src->glyphs[i];
+      agg::decompose_ft_bitmap_gray8(g->bitmap, g->left, -g->top, true, ras,
+                                     sl, storage);
+    }
+  }
+};
+
+void bench_decompose(const paragraph_codes& text) {
+  ft_glyphs outlines;
+  if (outlines.load(text, true, FT_RENDER_MODE_NORMAL)) {
+    decompose_outline_bench<agg::path_storage_integer<agg::int16, 6> > b16;
+    b16.src = &outlines;
+    run("decompose_ft_outline/int16", "glyph", outlines.glyphs.size(), b16);
+    decompose_outline_bench<agg::path_storage_integer<agg::int32, 6> > b32;
+    b32.src = &outlines;
+    run("decompose_ft_outline/int32", "glyph", outlines.glyphs.size(), b32);
+  }
+  ft_glyphs mono;
+  if (mono.load(text, false, FT_RENDER_MODE_MONO)) {
+    decompose_mono_bench b;
+    b.src = &mono;
+    run("decompose_ft_bitmap_mono", "glyph", mono.glyphs.size(), b);
+  }
+  ft_glyphs gray;
+  if (gray.load(text, false, FT_RENDER_MODE_NORMAL)) {
+    decompose_gray8_bench b;
+    b.src = &gray;
+    run("decompose_ft_bitmap_gray8", "glyph", gray.glyphs.size(), b);
+  }
+}
+
+//------------------------------------------------------------------------
+// Draws the paragraph with render_text() into an LCD pixel format, the
+// engine is set up for subpixel rendering as in the demo.
+template <class PixFmt>
+struct draw_text_bench {
+  font_engine_type* feng;
+  font_manager_type* fman;
+  PixFmt* pf;
+  bool reset_cache;
+
+  void operator()() {
+    typedef agg::renderer_base<PixFmt> base_type;
+    base_type ren_base(*pf);
+    agg::renderer_scanline_aa_solid<base_type> ren(ren_base);
+    agg::rasterizer_scanline_aa<> ras;
+    agg::scanline_u8 sl;
+    ren_base.clear(agg::rgba8(255, 255, 255));
+    ren.color(agg::rgba8(0, 0, 0));
+    if (reset_cache) fman->reset_cache();
+    double x = 6.0, y = 20.0;
+    agg::render_text(*feng, *fman, ras, sl, ren, paragraph, paragraph_len, &x,
+                     &y);
+  }
+};
+
+//------------------------------------------------------------------------
+// Renderer keeping the spans of the scanlines it is given, so that the
+// blending of the paragraph can be timed without rasterization
+struct span_recorder {
+  struct span {
+    int x;
+    int y;
+    int len;
+    unsigned offset;
+  };
+
+  agg::pod_bvector<span> spans;
+  agg::pod_bvector<agg::int8u, 12> covers;
+
+  void prepare() {}
+
+  template <class Scanline>
+  void render(const Scanline& sl) {
+    typename Scanline::const_iterator it = sl.begin();
+    for (unsigned n = sl.num_spans(); n > 0; --n, ++it) {
+      span s = {it->x, sl.y(), it->len < 0 ? -it->len : it->len,
+                covers.size()};
+      for (int i = 0; i < s.len; ++i) {
+        covers.add(it->covers[it->len < 0 ? 0 : i]);
+      }
+      spans.add(s);
+    }
+  }
+};
+
+// Blends the recorded spans with blend_solid_hspan() only
+template <class PixFmt>
+struct blend_bench {
+  PixFmt* pf;
+  const span_recorder::span* spans;
+  unsigned num_spans;
+  const agg::int8u* covers;
+
+  void operator()() {
+    agg::renderer_base<PixFmt> ren_base(*pf);
+    agg::rgba8 c(0, 0, 0);
+    for (unsigned i = 0; i < num_spans; ++i) {
+      const span_recorder::span& s = spans[i];
+      ren_base.blend_solid_hspan(s.x, s.y, s.len, c, covers + s.offset);
+    }
+  }
+};
+
+template <class PixFmt>
+void run_blend(const char* name, PixFmt& pf,
+               const agg::pod_array<span_recorder::span>& spans,
+               const agg::pod_array<agg::int8u>& covers, double glyphs) {
+  blend_bench<PixFmt> b;
+  b.pf = &pf;
+  b.spans = &spans[0];
+  b.num_spans = spans.size();
+  b.covers = &covers[0];
+  run(name, "glyph", glyphs, b);
+}
+
+void bench_draw_text(const paragraph_codes& text) {
+  font_engine_type feng;
+  font_manager_type fman(feng);
+  if (!feng.load_font(config.font, 0, agg::glyph_ren_outline)) return;
+  feng.flip_y(true);
+  feng.height(font_height);
+  feng.width(font_height * 3);
+
+  const unsigned width = 640, height = 120;
+  agg::pod_array<agg::int8u> buf(width * height * 3);
+  agg::rendering_buffer rbuf(&buf[0], width, height, width * 3);
+  agg::lcd_distribution_lut lut(1.0 / 3.0, 2.0 / 9.0, 1.0 / 9.0);
+
+  agg::pixfmt_rgb24_lcd pf(rbuf, lut);
+  draw_text_bench<agg::pixfmt_rgb24_lcd> b;
+  b.feng = &feng;
+  b.fman = &fman;
+  b.pf = &pf;
+  b.reset_cache = true;
+  run("render_text/cache_miss", "glyph", text.num_codes, b);
+  b.reset_cache = false;
+  run("render_text/cache_hit", "glyph", text.num_codes, b);
+
+  // The scanlines of the paragraph, clipped to the buffer, are taken once
+  span_recorder rec;
+  agg::rasterizer_scanline_aa<> ras;
+  agg::scanline_u8 sl;
+  ras.clip_box(0, 0, width * 3, height);
+  double x = 6.0, y = 20.0;
+  agg::render_text(feng, fman, ras, sl, rec, paragraph, paragraph_len, &x,
+                   &y);
+  if (rec.spans.size() == 0) return;
+  agg::pod_array<span_recorder::span> spans(rec.spans.size());
+  agg::pod_array<agg::int8u> covers(rec.covers.size());
+  rec.spans.serialize((agg::int8u*)&spans[0]);
+  rec.covers.serialize(&covers[0]);
+
+  run_blend("blend/pixfmt_rgb24_lcd", pf, spans, covers, text.num_codes);
+
+  agg::gamma_lut<> gamma(1.8);
+  agg::pixfmt_rgb24_lcd_gamma<agg::gamma_lut<> > pf_gamma(rbuf, lut, gamma);
+  run_blend("blend/pixfmt_rgb24_lcd_gamma", pf_gamma, spans, covers,
+            text.num_codes);
+
+  agg::lcd_gamma_lut16 gamma16(1.8);
+  agg::pixfmt_rgb24_lcd_linear<agg::lcd_gamma_lut16> pf_linear(rbuf, lut,
+                                                               gamma16);
+  run_blend("blend/pixfmt_rgb24_lcd_linear", pf_linear, spans, covers,
+            text.num_codes);
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: agg-font-bench [-t seconds] [-f filter] [-o file] "
+          "font-file\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  config.min_time = 0.5;
+  config.filter = 0;
+  config.font = getenv("AGG_FONT_BENCH_FONT");
+  config.out = stdout;
+
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-'; ++i) {
+    if (i + 1 >= argc) {
+      usage();
+      return 1;
+    }
+    if (strcmp(argv[i], "-t") == 0) {
+      config.min_time = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-f") == 0) {
+      config.filter = argv[++i];
+    } else if (strcmp(argv[i], "-o") == 0) {
+      config.out = fopen(argv[++i], "w");
+      if (config.out == 0) {
+        fprintf(stderr, "cannot open %s\n", argv[i]);
+        return 1;
+      }
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (i < argc) config.font = argv[i];
+  if (config.font == 0 || config.font[0] == 0) {
+    // Exit code 77 marks the benchmark as skipped
+    fprintf(stderr, "no font given, set the test_font option or "
+                    "AGG_FONT_BENCH_FONT\n");
+    return 77;
+  }
+
+  font_engine_type probe;
+  if (!probe.load_font(config.font, 0, agg::glyph_ren_outline)) {
+    fprintf(stderr, "cannot load font %s\n", config.font);
+    return 1;
+  }
+
+  paragraph_codes text;
+  bench_load_font();
+  bench_prepare_glyph(text);
+  bench_decompose(text);
+  bench_draw_text(text);
+
+  if (config.out != stdout) fclose(config.out);
+  return 0;
+}
@@ -0,0 +1,333 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+//
+// See implementation agg_font_arena.cpp
+//
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_ARENA_INCLUDED
+#define AGG_FONT_ARENA_INCLUDED
+
+#include <string.h>
+
+#include "agg_array.h"
+#include "agg_basics.h"
+#include "agg_font_cache_manager.h"
+
+namespace agg {
+
+//---------------------------------------------------------font_block_pool
+// Source of the memory blocks of font_arena. Blocks of the standard size
+// given back by an arena are kept, up to max_free_blocks, and handed out
+// again, so fonts dropped and cached again do not go through the heap.
+// Larger requests get a block of their own that is freed on return.
+//
+class font_block_pool {
+ public:
+  ~font_block_pool();
+  explicit font_block_pool(unsigned block_size = 16384 - 16,
+                           unsigned max_free_blocks = 64);
+
+  // Returns a block of actual_size(size) bytes
+  int8u* allocate(unsigned size);
+  void deallocate(int8u* block, unsigned size);
+  unsigned actual_size(unsigned size) const {
+    return size > m_block_size ? size : m_block_size;
+  }
+
+  // Free the blocks kept for reuse
+  void trim();
+
+  unsigned block_size() const { return m_block_size; }
+  unsigned long bytes_in_use() const { return m_bytes_in_use; }
+  unsigned long bytes_free() const {
+    return (unsigned long)m_num_free * m_block_size;
+  }
+
+ private:
+  font_block_pool(const font_block_pool&);
+  const font_block_pool& operator=(const font_block_pool&);
+
+  struct free_block {
+    free_block* next;
+  };
+
+  unsigned m_block_size;
+  unsigned m_max_free_blocks;
+  free_block* m_free;
+  unsigned m_num_free;
+  unsigned long m_bytes_in_use;
+};
+
+//--------------------------------------------------------------font_arena
+// Bump allocator on blocks taken from a font_block_pool. Allocations are
+// not freed one by one: reset() rewinds the arena and keeps its blocks,
+// for scratch storage reused from one glyph to the next, release() gives
+// all the blocks back to the pool at once. The engine does not need one
+// for its own scratch, AGG's storages already keep their blocks.
+//
+class font_arena {
+ public:
+  ~font_arena() { release(); }
+  explicit font_arena(font_block_pool& pool)
+      : m_pool(&pool), m_cur(0), m_pos(0), m_bytes_used(0) {}
+
+  int8u* allocate(unsigned size, unsigned alignment = 1);
+  void reset();
+  void release();
+
+  unsigned long bytes_used() const { return m_bytes_used; }
+  unsigned long bytes_reserved() const;
+
+ private:
+  font_arena(const font_arena&);
+  const font_arena& operator=(const font_arena&);
+
+  struct block {
+    int8u* data;
+    unsigned size;
+  };
+
+  font_block_pool* m_pool;
+  pod_bvector<block, 4> m_blocks;
+  unsigned m_cur;  // Block being filled
+  unsigned m_pos;  // Position in it
+  unsigned long m_bytes_used;
+};
+
+//--------------------------------------------------------arena_font_cache
+// Glyphs of one font signature. The glyph records, the lookup pages and
+// the glyph data are allocated contiguously in the font's arena and all
+// freed together when the font is dropped.
+//
+class arena_font_cache {
+ public:
+  arena_font_cache(font_block_pool& pool, const char* font_signature);
+
+  bool font_is(const char* font_signature) const {
+    return strcmp(m_signature, font_signature) == 0;
+  }
+  const char* signature() const { return m_signature; }
+
+  const glyph_cache* find_glyph(unsigned glyph_code) const;
+  glyph_cache* cache_glyph(unsigned glyph_code, unsigned glyph_index,
+                           unsigned data_size, glyph_data_type data_type,
+                           const rect_i& bounds, double advance_x,
+                           double advance_y);
+
+  unsigned long bytes_used() const { return m_arena.bytes_used(); }
+  unsigned long bytes_reserved() const { return m_arena.bytes_reserved(); }
+
+ private:
+  arena_font_cache(const arena_font_cache&);
+  const arena_font_cache& operator=(const arena_font_cache&);
+
+  // Codes above 0xFFFF are kept in a small hash table of chained entries
+  enum { num_astral_buckets = 64 };
+  struct astral_entry {
+    glyph_cache glyph;
+    unsigned code;
+    astral_entry* next;
+  };
+
+  font_arena m_arena;
+  char* m_signature;
+  glyph_cache** m_glyphs[256];
+  astral_entry* m_astral[num_astral_buckets];
+};
+
+//---------------------------------------------------arena_font_cache_pool
+// Counterpart of font_cache_pool on arenas: up to max_fonts fonts share
+// one font_block_pool, the least recently used font is dropped to make
+// room for a new one and its blocks are reused by the next.
+//
+class arena_font_cache_pool {
+ public:
+  ~arena_font_cache_pool();
+  explicit arena_font_cache_pool(unsigned max_fonts = 32,
+                                 unsigned block_size = 16384 - 16);
+
+  void font(const char* font_signature, bool reset_cache = false);
+  const arena_font_cache* font() const { return m_cur_font; }
+
+  const glyph_cache* find_glyph(unsigned glyph_code) const {
+    return m_cur_font ? m_cur_font->find_glyph(glyph_code) : 0;
+  }
+  glyph_cache* cache_glyph(unsigned glyph_code, unsigned glyph_index,
+                           unsigned data_size, glyph_data_type data_type,
+                           const rect_i& bounds, double advance_x,
+                           double advance_y) {
+    if (m_cur_font == 0) return 0;
+    return m_cur_font->cache_glyph(glyph_code, glyph_index, data_size,
+                                   data_type, bounds, advance_x, advance_y);
+  }
+
+  unsigned num_fonts() const { return m_num_fonts; }
+  font_block_pool& blocks() { return m_blocks; }
+
+ private:
+  arena_font_cache_pool(const arena_font_cache_pool&);
+  const arena_font_cache_pool& operator=(const arena_font_cache_pool&);
+
+  font_block_pool m_blocks;
+  arena_font_cache** m_fonts;
+  unsigned m_max_fonts;
+  unsigned m_num_fonts;
+  arena_font_cache* m_cur_font;
+};
+
+//------------------------------------------------arena_font_cache_manager
+// Drop-in replacement of font_cache_manager storing the glyphs in
+// arena_font_cache_pool.
+//
+template <class FontEngine>
+class arena_font_cache_manager {
+ public:
+  typedef FontEngine font_engine_type;
+  typedef arena_font_cache_manager<FontEngine> self_type;
+  typedef typename font_engine_type::path_adaptor_type path_adaptor_type;
+  typedef typename font_engine_type::gray8_adaptor_type gray8_adaptor_type;
+  typedef typename gray8_adaptor_type::embedded_scanline gray8_scanline_type;
+  typedef typename font_engine_type::mono_adaptor_type mono_adaptor_type;
+  typedef typename mono_adaptor_type::embedded_scanline mono_scanline_type;
+
+  arena_font_cache_manager(font_engine_type& engine, unsigned max_fonts = 32,
+                           unsigned block_size = 16384 - 16)
+      : m_fonts(max_fonts, block_size),
+        m_engine(&engine),
+        m_change_stamp(-1),
+        m_prev_glyph(0),
+        m_last_glyph(0) {}
+
+  void reset_last_glyph() { m_prev_glyph = m_last_glyph = 0; }
+
+  const glyph_cache* glyph(unsigned glyph_code) {
+    synchronize();
+    const glyph_cache* gl = m_fonts.find_glyph(glyph_code);
+    if (gl) {
+      m_prev_glyph = m_last_glyph;
+      return m_last_glyph = gl;
+    }
+    if (m_engine->prepare_glyph(glyph_code)) {
+      glyph_cache* g = m_fonts.cache_glyph(
+          glyph_code, m_engine->glyph_index(), m_engine->data_size(),
+          m_engine->data_type(), m_engine->bounds(), m_engine->advance_x(),
+          m_engine->advance_y());
+      if (g) {
+        m_engine->write_glyph_to(g->data);
+        m_prev_glyph = m_last_glyph;
+        return m_last_glyph = g;
+      }
+    }
+    return 0;
+  }
+
+  void init_embedded_adaptors(const glyph_cache* gl, double x, double y,
+                              double scale = 1.0) {
+    if (gl) {
+      switch (gl->data_type) {
+        default:
+          return;
+        case glyph_data_mono:
+          m_mono_adaptor.init(gl->data, gl->data_size, x, y);
+          break;
+        case glyph_data_gray8:
+          m_gray8_adaptor.init(gl->data, gl->data_size, x, y);
+          break;
+        case glyph_data_outline:
+          m_path_adaptor.init(gl->data, gl->data_size, x, y, scale);
+          break;
+      }
+    }
+  }
+
+  path_adaptor_type& path_adaptor() { return m_path_adaptor; }
+  gray8_adaptor_type& gray8_adaptor() { return m_gray8_adaptor; }
+  gray8_scanline_type& gray8_scanline() { return m_gray8_scanline; }
+  mono_adaptor_type& mono_adaptor() { return m_mono_adaptor; }
+  mono_scanline_type& mono_scanline() { return m_mono_scanline; }
+
+  const glyph_cache* perv_glyph() const { return m_prev_glyph; }
+  const glyph_cache* last_glyph() const { return m_last_glyph; }
+
+  bool add_kerning(double* x, double* y) {
+    if (m_prev_glyph && m_last_glyph) {
+      return m_engine->add_kerning(m_prev_glyph->glyph_index,
+                                   m_last_glyph->glyph_index, x, y);
+    }
+    return false;
+  }
+
+  void precache(unsigned from, unsigned to) {
+    for (; from <= to; ++from) glyph(from);
+  }
+
+  // Add glyphs prepared elsewhere, such as the font_glyph_set of a
+  // font_prewarmer job. Glyphs already cached are kept.
+  template <class GlyphSet>
+  unsigned add_glyphs(const GlyphSet& set) {
+    unsigned n = 0;
+    m_fonts.font(set.signature());
+    for (unsigned i = 0; i < set.size(); ++i) {
+      const glyph_cache& gl = set.glyph(i);
+      glyph_cache* g = m_fonts.cache_glyph(
+          set.code(i), gl.glyph_index, gl.data_size, gl.data_type, gl.bounds,
+          gl.advance_x, gl.advance_y);
+      if (g) {
+        if (gl.data_size) memcpy(g->data, gl.data, gl.data_size);
+        ++n;
+      }
+    }
+    // Select the font of the engine again on the next glyph()
+    m_change_stamp = -1;
+    m_prev_glyph = m_last_glyph = 0;
+    return n;
+  }
+
+  void reset_cache() {
+    m_fonts.font(m_engine->font_signature(), true);
+    m_change_stamp = m_engine->change_stamp();
+    m_prev_glyph = m_last_glyph = 0;
+  }
+
+  arena_font_cache_pool& fonts() { return m_fonts; }
+
+ private:
+  arena_font_cache_manager(const self_type&);
+  const self_type& operator=(const self_type&);
+
+  void synchronize() {
+    if (m_change_stamp != m_engine->change_stamp()) {
+      m_fonts.font(m_engine->font_signature());
+      m_change_stamp = m_engine->change_stamp();
+      m_prev_glyph = m_last_glyph = 0;
+    }
+  }
+
+  arena_font_cache_pool m_fonts;
+  font_engine_type* m_engine;
+  int m_change_stamp;
+  const glyph_cache* m_prev_glyph;
+  const glyph_cache* m_last_glyph;
+  path_adaptor_type m_path_adaptor;
+  gray8_adaptor_type m_gray8_adaptor;
+  gray8_scanline_type m_gray8_scanline;
+  mono_adaptor_type m_mono_adaptor;
+  mono_scanline_type m_mono_scanline;
+};
+
+}  // namespace agg
+
+#endif
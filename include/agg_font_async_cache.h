@@ -0,0 +1,308 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_ASYNC_CACHE_INCLUDED
+#define AGG_FONT_ASYNC_CACHE_INCLUDED
+
+#include <string.h>
+
+#include "agg_array.h"
+#include "agg_font_budget_cache.h"
+#include "agg_font_prewarm.h"
+
+namespace agg {
+
+//-------------------------------------------------async_font_cache_manager
+// Font cache manager that never renders in the draw loop. A glyph not in
+// the cache is returned at once as a placeholder with the advance of the
+// glyph and no data (glyph_data_invalid, skipped by the text renderers)
+// and its code is queued. update(), called once per frame, sends the
+// queued codes to the font_prewarmer as one job and adds the glyphs of
+// the finished jobs to the cache; it returns true when glyphs arrived and
+// the text should be drawn again. A completion_callback on the prewarmer
+// can be used to wake up the application for that.
+//
+// If the worker cannot reproduce the font of the engine, a font loaded
+// from memory for instance, the manager falls back to rendering glyphs
+// as they are requested; blocking(true) does this from the start.
+//
+template <class FontEngine>
+class async_font_cache_manager {
+ public:
+  typedef FontEngine font_engine_type;
+  typedef async_font_cache_manager<FontEngine> self_type;
+  typedef typename font_engine_type::path_adaptor_type path_adaptor_type;
+  typedef typename font_engine_type::gray8_adaptor_type gray8_adaptor_type;
+  typedef typename gray8_adaptor_type::embedded_scanline gray8_scanline_type;
+  typedef typename font_engine_type::mono_adaptor_type mono_adaptor_type;
+  typedef typename mono_adaptor_type::embedded_scanline mono_scanline_type;
+
+  ~async_font_cache_manager() {
+    for (unsigned i = 0; i < m_jobs.size(); ++i) {
+      m_worker->wait(m_jobs[i].id);
+      m_worker->release(m_jobs[i].id);
+      delete[] m_jobs[i].signature;
+    }
+    delete[] m_request_name;
+    delete[] m_request_signature;
+  }
+
+  async_font_cache_manager(font_engine_type& engine, font_prewarmer& worker,
+                           unsigned long max_bytes = 4 * 1024 * 1024)
+      : m_glyphs(max_bytes),
+        m_placeholders(max_bytes / 8),
+        m_engine(&engine),
+        m_worker(&worker),
+        m_change_stamp(-1),
+        m_blocking(false),
+        m_installs(0),
+        m_request_name(0),
+        m_request_signature(0),
+        m_prev_glyph(0),
+        m_last_glyph(0) {}
+
+  void reset_last_glyph() { m_prev_glyph = m_last_glyph = 0; }
+
+  const glyph_cache* glyph(unsigned glyph_code) {
+    synchronize();
+    const glyph_cache* gl = m_glyphs.find_glyph(glyph_code);
+    if (gl == 0) {
+      gl = m_blocking ? render_glyph(glyph_code) : placeholder(glyph_code);
+    }
+    if (gl) {
+      m_prev_glyph = m_last_glyph;
+      m_last_glyph = gl;
+    }
+    return gl;
+  }
+
+  // Submit the queued codes and take in the finished glyphs, returns true
+  // if any arrived.
+  bool update() {
+    submit_queue();
+    bool arrived = false;
+    for (unsigned i = m_jobs.size(); i-- > 0;) {
+      pending_job job = m_jobs[i];
+      if (!m_worker->done(job.id)) continue;
+      const font_glyph_set* set = m_worker->glyphs(job.id);
+      if (set == 0 || strcmp(set->signature(), job.signature) != 0) {
+        m_blocking = true;
+      } else if (add_glyphs(*set)) {
+        arrived = true;
+      }
+      m_worker->release(job.id);
+      delete[] job.signature;
+      m_jobs[i] = m_jobs[m_jobs.size() - 1];
+      m_jobs.remove_last();
+    }
+    return arrived;
+  }
+
+  // Glyphs queued or being rendered
+  bool pending() const { return m_queue.size() != 0 || m_jobs.size() != 0; }
+
+  // SDF and color glyphs are tagged glyph_data_invalid too, but have data
+  bool is_placeholder(const glyph_cache* gl) const {
+    return gl && gl->data_type == glyph_data_invalid && gl->data_size == 0;
+  }
+
+  void blocking(bool b) { m_blocking = b; }
+  bool blocking() const { return m_blocking; }
+
+  void init_embedded_adaptors(const glyph_cache* gl, double x, double y,
+                              double scale = 1.0) {
+    if (gl) {
+      switch (gl->data_type) {
+        default:
+          return;
+        case glyph_data_mono:
+          m_mono_adaptor.init(gl->data, gl->data_size, x, y);
+          break;
+        case glyph_data_gray8:
+          m_gray8_adaptor.init(gl->data, gl->data_size, x, y);
+          break;
+        case glyph_data_outline:
+          m_path_adaptor.init(gl->data, gl->data_size, x, y, scale);
+          break;
+      }
+    }
+  }
+
+  path_adaptor_type& path_adaptor() { return m_path_adaptor; }
+  gray8_adaptor_type& gray8_adaptor() { return m_gray8_adaptor; }
+  gray8_scanline_type& gray8_scanline() { return m_gray8_scanline; }
+  mono_adaptor_type& mono_adaptor() { return m_mono_adaptor; }
+  mono_scanline_type& mono_scanline() { return m_mono_scanline; }
+
+  const glyph_cache* perv_glyph() const { return m_prev_glyph; }
+  const glyph_cache* last_glyph() const { return m_last_glyph; }
+
+  bool add_kerning(double* x, double* y) {
+    if (m_prev_glyph && m_last_glyph) {
+      return m_engine->add_kerning(m_prev_glyph->glyph_index,
+                                   m_last_glyph->glyph_index, x, y);
+    }
+    return false;
+  }
+
+  void precache(unsigned from, unsigned to) {
+    for (; from <= to; ++from) glyph(from);
+  }
+
+  // Add glyphs prepared elsewhere, see budget_font_cache_manager. Their
+  // placeholders are dropped, a glyph evicted later is queued again.
+  template <class GlyphSet>
+  unsigned add_glyphs(const GlyphSet& set) {
+    unsigned n = 0;
+    m_glyphs.font(set.signature());
+    m_placeholders.font(set.signature());
+    for (unsigned i = 0; i < set.size(); ++i) {
+      m_placeholders.remove_glyph(set.code(i));
+      const glyph_cache& gl = set.glyph(i);
+      glyph_cache* g = m_glyphs.cache_glyph(
+          set.code(i), gl.glyph_index, gl.data_size, gl.data_type, gl.bounds,
+          gl.advance_x, gl.advance_y);
+      if (g) {
+        if (gl.data_size) memcpy(g->data, gl.data, gl.data_size);
+        ++n;
+      }
+    }
+    m_change_stamp = -1;
+    m_prev_glyph = m_last_glyph = 0;
+    if (n) ++m_installs;
+    return n;
+  }
+
+  void reset_cache() {
+    m_glyphs.font(m_engine->font_signature(), true);
+    m_placeholders.font(m_engine->font_signature(), true);
+    m_change_stamp = m_engine->change_stamp();
+    m_prev_glyph = m_last_glyph = 0;
+  }
+
+  glyph_budget_cache& glyphs() { return m_glyphs; }
+  const glyph_budget_cache& glyphs() const { return m_glyphs; }
+
+  // Changes when cached glyphs are dropped or placeholders replaced
+  unsigned generation() const {
+    return m_glyphs.generation() + m_placeholders.generation() + m_installs;
+  }
+
+ private:
+  async_font_cache_manager(const self_type&);
+  const self_type& operator=(const self_type&);
+
+  struct pending_job {
+    int id;
+    char* signature;  // Of the engine when the codes were queued
+  };
+
+  void synchronize() {
+    if (m_change_stamp != m_engine->change_stamp()) {
+      submit_queue();
+      m_glyphs.font(m_engine->font_signature());
+      m_placeholders.font(m_engine->font_signature());
+      m_change_stamp = m_engine->change_stamp();
+      m_prev_glyph = m_last_glyph = 0;
+    }
+  }
+
+  const glyph_cache* render_glyph(unsigned glyph_code) {
+    if (m_engine->prepare_glyph(glyph_code)) {
+      glyph_cache* g = m_glyphs.cache_glyph(
+          glyph_code, m_engine->glyph_index(), m_engine->data_size(),
+          m_engine->data_type(), m_engine->bounds(), m_engine->advance_x(),
+          m_engine->advance_y());
+      if (g) m_engine->write_glyph_to(g->data);
+      return g;
+    }
+    return 0;
+  }
+
+  // A placeholder stays until the glyph arrives, so a code is queued once
+  const glyph_cache* placeholder(unsigned glyph_code) {
+    const glyph_cache* gl = m_placeholders.find_glyph(glyph_code);
+    if (gl) return gl;
+    if (!m_engine->prepare_glyph_metrics(glyph_code, true)) return 0;
+    gl = m_placeholders.cache_glyph(
+        glyph_code, m_engine->glyph_index(), 0, glyph_data_invalid,
+        m_engine->bounds(), m_engine->advance_x(), m_engine->advance_y());
+    if (m_queue.size() == 0) {
+      const char* name = m_engine->name();
+      delete[] m_request_name;
+      m_request_name = new char[strlen(name) + 1];
+      strcpy(m_request_name, name);
+      m_request.match(*m_engine);
+      m_request.font_name = m_request_name;
+      m_request.charset = prewarm_codes;
+      const char* sig = m_engine->font_signature();
+      delete[] m_request_signature;
+      m_request_signature = new char[strlen(sig) + 1];
+      strcpy(m_request_signature, sig);
+    }
+    m_queue.add(glyph_code);
+    return gl;
+  }
+
+  void submit_queue() {
+    if (m_queue.size() == 0) return;
+    m_codes.capacity(m_queue.size());
+    for (unsigned i = 0; i < m_queue.size(); ++i) m_codes.add(m_queue[i]);
+    m_request.codes = &m_codes[0];
+    m_request.num_codes = m_codes.size();
+    pending_job job;
+    job.id = m_worker->submit(m_request);
+    m_queue.remove_all();
+    if (job.id < 0) {
+      m_blocking = true;
+      return;
+    }
+    job.signature = m_request_signature;
+    m_request_signature = 0;
+    m_jobs.add(job);
+  }
+
+  glyph_budget_cache m_glyphs;
+  glyph_budget_cache m_placeholders;
+  font_engine_type* m_engine;
+  font_prewarmer* m_worker;
+  int m_change_stamp;
+  bool m_blocking;
+  unsigned m_installs;
+  font_prewarm_request m_request;  // Of the codes in the queue
+  char* m_request_name;
+  char* m_request_signature;
+  pod_bvector<unsigned> m_queue;
+  pod_vector<unsigned> m_codes;
+  pod_bvector<pending_job> m_jobs;
+  const glyph_cache* m_prev_glyph;
+  const glyph_cache* m_last_glyph;
+  path_adaptor_type m_path_adaptor;
+  gray8_adaptor_type m_gray8_adaptor;
+  gray8_scanline_type m_gray8_scanline;
+  mono_adaptor_type m_mono_adaptor;
+  mono_scanline_type m_mono_scanline;
+};
+
+//------------------------------------------------------------------------
+template <class FontEngine>
+inline unsigned glyph_cache_generation(
+    const async_font_cache_manager<FontEngine>& fman) {
+  return fman.generation();
+}
+
+}  // namespace agg
+
+#endif
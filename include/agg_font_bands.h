@@ -0,0 +1,364 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+//
+// See implementation agg_font_bands.cpp
+//
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_BANDS_INCLUDED
+#define AGG_FONT_BANDS_INCLUDED
+
+#include <math.h>
+
+#include "agg_array.h"
+#include "agg_basics.h"
+#include "agg_conv_curve.h"
+#include "agg_conv_transform.h"
+#include "agg_font_cache_manager.h"
+#include "agg_font_text.h"
+#include "agg_rasterizer_scanline_aa.h"
+#include "agg_renderer_base.h"
+#include "agg_renderer_scanline.h"
+#include "agg_rendering_buffer.h"
+#include "agg_scanline_u.h"
+#include "agg_trans_affine.h"
+
+namespace agg {
+
+struct band_pool_state;
+
+//------------------------------------------------------------------------
+// Called by run() for each band, on any thread of the pool
+typedef void (*font_band_func)(void* data, unsigned band);
+
+//----------------------------------------------------------font_band_pool
+// Worker threads drawing bands. run() hands the bands to the workers and
+// the calling thread as they become free, and returns when all are done.
+// Without thread support, or if no thread can be started, the calling
+// thread draws them all. run() is for one thread at a time.
+//
+class font_band_pool {
+ public:
+  ~font_band_pool();
+  explicit font_band_pool(unsigned num_threads);
+
+  void run(font_band_func func, void* data, unsigned num_bands);
+  unsigned num_threads() const;
+
+ private:
+  font_band_pool(const font_band_pool&);
+  const font_band_pool& operator=(const font_band_pool&);
+
+  band_pool_state* m_state;
+};
+
+//--------------------------------------------------------------band_glyph
+// A glyph of a text_block at its pen position, with the rows it may
+// touch. Glyphs of the same sweep are rasterized together, as those of a
+// line by render_text().
+struct band_glyph {
+  const glyph_cache* glyph;
+  double x;
+  double y;
+  int y1;
+  int y2;
+  unsigned sweep;
+  unsigned run;  // add_text() call it comes from
+};
+
+//--------------------------------------------------------------text_block
+// Text laid out ahead of drawing by band_text_renderer. add_text() lays
+// out a run as render_text() does, from the same glyph sources, and the
+// block keeps pointers to the glyphs: they must stay in the cache until
+// the block is drawn, as with font_cache_manager until reset_cache().
+//
+class text_block {
+ public:
+  text_block() : m_sweep(0), m_min_y(1), m_max_y(0) {}
+
+  template <class FontEngine, class GlyphSource, class CharT>
+  void add_text(FontEngine& feng, GlyphSource& glyphs, const CharT* text,
+                unsigned len, double* x, double* y,
+                const text_style& style = text_style()) {
+    m_runs.add(trans_affine(style.width, 0.0, style.slant, 1.0, 0.0, 0.0));
+    recorder rec(*this, m_runs.size() - 1, style.snap_baseline);
+    layout_text(feng, glyphs, text, len, x, y, style, rec);
+  }
+
+  void clear() {
+    m_glyphs.remove_all();
+    m_runs.remove_all();
+    m_sweep = 0;
+    m_min_y = 1;
+    m_max_y = 0;
+  }
+
+  unsigned size() const { return m_glyphs.size(); }
+  const band_glyph& operator[](unsigned i) const { return m_glyphs[i]; }
+  // Width and slant of the text_style of a run
+  const trans_affine& run_matrix(unsigned run) const { return m_runs[run]; }
+  // Rows of all the glyphs, min_y() > max_y() when there are none
+  int min_y() const { return m_min_y; }
+  int max_y() const { return m_max_y; }
+
+ private:
+  class recorder {
+   public:
+    recorder(text_block& block, unsigned run, bool snap_baseline)
+        : m_block(&block), m_run(run), m_snap_baseline(snap_baseline) {}
+
+    void add_glyph(const glyph_cache* glyph, unsigned, double x, double y) {
+      if (m_snap_baseline) y = floor(y + 0.5);
+      m_block->add_glyph(glyph, x, y, m_run);
+    }
+    void end_line() { ++m_block->m_sweep; }
+
+   private:
+    text_block* m_block;
+    unsigned m_run;
+    bool m_snap_baseline;
+  };
+
+  void add_glyph(const glyph_cache* glyph, double x, double y, unsigned run) {
+    // Only the types text_run_renderer draws, with a pixel of margin for
+    // the cells of the edges and the rounding of gray8 positions
+    if (glyph->data_type != glyph_data_outline &&
+        glyph->data_type != glyph_data_gray8) {
+      return;
+    }
+    const rect_i& b = glyph->bounds;
+    if (b.x1 > b.x2 || b.y1 > b.y2) return;
+    band_glyph g;
+    g.glyph = glyph;
+    g.x = x;
+    g.y = y;
+    g.y1 = int(floor(y + b.y1)) - 1;
+    g.y2 = int(ceil(y + b.y2)) + 1;
+    g.sweep = m_sweep;
+    g.run = run;
+    m_glyphs.add(g);
+    if (m_min_y > m_max_y) {
+      m_min_y = g.y1;
+      m_max_y = g.y2;
+    } else {
+      if (g.y1 < m_min_y) m_min_y = g.y1;
+      if (g.y2 > m_max_y) m_max_y = g.y2;
+    }
+  }
+
+  pod_bvector<band_glyph, 8> m_glyphs;
+  pod_bvector<trans_affine, 4> m_runs;
+  unsigned m_sweep;
+  int m_min_y;
+  int m_max_y;
+};
+
+//------------------------------------------------------band_text_renderer
+// Draws a text_block in a solid color on a pool of threads. The rows of
+// the block are split into bands, each drawn by one thread with a
+// pixel format, renderer, rasterizer and scanline of its own and its
+// clip box limited to the band. The glyph data is only read.
+//
+// The output is the same, pixel for pixel, as render_text() with a
+// renderer_scanline_aa_solid and scanline_u8: each band rasterizes the
+// glyphs of a sweep touching it together, as render_text() does with
+// all the glyphs of a line, and draws only its own rows of the sweep.
+// Bands are rows of the pixel format, the LCD filter spreads along them
+// only, also for lcd_vertical layouts whose rows are buffer columns.
+//
+// The pixel formats are made from the rendering buffer and the
+// arguments given after it, such as the LCD distribution and gamma.
+//
+//   font_band_pool pool(7);
+//   band_text_renderer<font_manager_type, pixfmt_rgb24_lcd>
+//       bands(pool, 0, rbuf, lut);
+//   block.add_text(feng, fman, text, len, &x, &y, style);
+//   bands.render(block, rgba8(0, 0, 0));
+//
+template <class FontCacheManager, class PixFmt>
+class band_text_renderer {
+ public:
+  typedef typename PixFmt::color_type color_type;
+  typedef typename FontCacheManager::path_adaptor_type path_adaptor_type;
+  typedef typename FontCacheManager::gray8_adaptor_type gray8_adaptor_type;
+  typedef typename FontCacheManager::gray8_scanline_type gray8_scanline_type;
+  typedef conv_curve<path_adaptor_type> curve_type;
+  typedef renderer_base<PixFmt> base_ren_type;
+  typedef renderer_scanline_aa_solid<base_ren_type> solid_ren_type;
+
+  ~band_text_renderer() {
+    for (unsigned i = 0; i < m_bands.size(); ++i) delete m_bands[i];
+  }
+
+  // Up to num_bands bands, zero for one per thread of the pool and one
+  // for the calling thread
+  band_text_renderer(font_band_pool& pool, unsigned num_bands,
+                     rendering_buffer& rbuf)
+      : m_pool(&pool) {
+    unsigned n = bands_for(pool, num_bands);
+    for (unsigned i = 0; i < n; ++i) m_bands.add(new band(rbuf));
+    reset_clipping();
+  }
+
+  template <class A1>
+  band_text_renderer(font_band_pool& pool, unsigned num_bands,
+                     rendering_buffer& rbuf, const A1& a1)
+      : m_pool(&pool) {
+    unsigned n = bands_for(pool, num_bands);
+    for (unsigned i = 0; i < n; ++i) m_bands.add(new band(rbuf, a1));
+    reset_clipping();
+  }
+
+  template <class A1, class A2>
+  band_text_renderer(font_band_pool& pool, unsigned num_bands,
+                     rendering_buffer& rbuf, const A1& a1, const A2& a2)
+      : m_pool(&pool) {
+    unsigned n = bands_for(pool, num_bands);
+    for (unsigned i = 0; i < n; ++i) m_bands.add(new band(rbuf, a1, a2));
+    reset_clipping();
+  }
+
+  // Clipping as by renderer_base
+  void clip_box(int x1, int y1, int x2, int y2) {
+    m_clip = rect_i(x1, y1, x2, y2);
+    m_clip.normalize();
+    if (!m_clip.clip(rect_i(0, 0, m_bands[0]->pixf.width() - 1,
+                            m_bands[0]->pixf.height() - 1))) {
+      m_clip = rect_i(1, 1, 0, 0);
+    }
+  }
+  void reset_clipping() {
+    m_clip = rect_i(0, 0, m_bands[0]->pixf.width() - 1,
+                    m_bands[0]->pixf.height() - 1);
+  }
+
+  template <class GammaF>
+  void gamma(const GammaF& f) {
+    for (unsigned i = 0; i < m_bands.size(); ++i) m_bands[i]->ras.gamma(f);
+  }
+
+  unsigned num_bands() const { return m_bands.size(); }
+
+  void render(const text_block& block, const color_type& color) {
+    m_y1 = block.min_y() > m_clip.y1 ? block.min_y() : m_clip.y1;
+    int y2 = block.max_y() < m_clip.y2 ? block.max_y() : m_clip.y2;
+    if (m_clip.x1 > m_clip.x2 || m_y1 > y2) return;
+    m_rows = unsigned(y2 - m_y1 + 1);
+    m_num = m_bands.size() < m_rows ? m_bands.size() : m_rows;
+    m_block = &block;
+    m_color = color;
+    m_pool->run(render_band, this, m_num);
+  }
+
+ private:
+  band_text_renderer(const band_text_renderer&);
+  const band_text_renderer& operator=(const band_text_renderer&);
+
+  struct band {
+    PixFmt pixf;
+    base_ren_type ren_base;
+    solid_ren_type ren;
+    rasterizer_scanline_aa<> ras;
+    scanline_u8 sl;
+    path_adaptor_type path;
+    curve_type curves;
+    trans_affine mtx;
+    conv_transform<curve_type> trans;
+    gray8_adaptor_type gray8;
+    gray8_scanline_type gray8_sl;
+
+    explicit band(rendering_buffer& rbuf)
+        : pixf(rbuf), ren_base(pixf), ren(ren_base), curves(path),
+          trans(curves, mtx) {}
+    template <class A1>
+    band(rendering_buffer& rbuf, const A1& a1)
+        : pixf(rbuf, a1), ren_base(pixf), ren(ren_base), curves(path),
+          trans(curves, mtx) {}
+    template <class A1, class A2>
+    band(rendering_buffer& rbuf, const A1& a1, const A2& a2)
+        : pixf(rbuf, a1, a2), ren_base(pixf), ren(ren_base), curves(path),
+          trans(curves, mtx) {}
+  };
+
+  static unsigned bands_for(const font_band_pool& pool, unsigned num_bands) {
+    return num_bands ? num_bands : pool.num_threads() + 1;
+  }
+
+  static void render_band(void* self, unsigned i) {
+    ((band_text_renderer*)self)->render_band(i);
+  }
+
+  void render_band(unsigned i) {
+    band& b = *m_bands[i];
+    int y1 = m_y1 + int(m_rows * i / m_num);
+    int y2 = m_y1 + int(m_rows * (i + 1) / m_num) - 1;
+    b.ren_base.clip_box(m_clip.x1, y1, m_clip.x2, y2);
+    b.ren.color(m_color);
+    b.ras.reset();
+
+    const text_block& block = *m_block;
+    unsigned sweep = 0;
+    bool pending = false;
+    for (unsigned k = 0; k < block.size(); ++k) {
+      const band_glyph& g = block[k];
+      if (g.y2 < y1 || g.y1 > y2) continue;
+      if (pending && g.sweep != sweep) {
+        sweep_rows(b, y1, y2);
+        pending = false;
+      }
+      sweep = g.sweep;
+      const glyph_cache* glyph = g.glyph;
+      if (glyph->data_type == glyph_data_outline) {
+        b.path.init(glyph->data, glyph->data_size, 0, 0);
+        b.mtx = block.run_matrix(g.run);
+        b.mtx *= trans_affine_translation(g.x, g.y);
+        b.ras.add_path(b.trans);
+        pending = true;
+      } else {
+        b.gray8.init(glyph->data, glyph->data_size, g.x, g.y);
+        render_scanlines(b.gray8, b.gray8_sl, b.ren);
+      }
+    }
+    if (pending) sweep_rows(b, y1, y2);
+  }
+
+  // render_scanlines() starting at the first row of the band
+  static void sweep_rows(band& b, int y1, int y2) {
+    if (b.ras.rewind_scanlines()) {
+      int y = b.ras.min_y() > y1 ? b.ras.min_y() : y1;
+      if (y <= y2 && b.ras.navigate_scanline(y)) {
+        b.sl.reset(b.ras.min_x(), b.ras.max_x());
+        b.ren.prepare();
+        while (b.ras.sweep_scanline(b.sl) && b.sl.y() <= y2) {
+          b.ren.render(b.sl);
+        }
+      }
+    }
+    b.ras.reset();
+  }
+
+  font_band_pool* m_pool;
+  pod_bvector<band*, 4> m_bands;
+  rect_i m_clip;
+  const text_block* m_block;
+  color_type m_color;
+  int m_y1;
+  unsigned m_rows;
+  unsigned m_num;
+};
+
+}  // namespace agg
+
+#endif
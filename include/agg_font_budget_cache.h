@@ -0,0 +1,252 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+//
+// See implementation agg_font_budget_cache.cpp
+//
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_BUDGET_CACHE_INCLUDED
+#define AGG_FONT_BUDGET_CACHE_INCLUDED
+
+#include <string.h>
+
+#include "agg_basics.h"
+#include "agg_font_cache_manager.h"
+
+namespace agg {
+
+//-----------------------------------------------------glyph_budget_cache
+// Glyphs of any number of fonts held within a memory budget. Each glyph
+// is charged its data size plus its record, fonts their signature. When
+// caching a glyph would go over max_bytes, the least recently used glyphs
+// of all the fonts are freed, and a font is forgotten with its last
+// glyph. The two most recently used glyphs are never evicted, so the
+// glyph returned last and the one before it, used for kerning, stay
+// valid; the budget may be exceeded by them.
+//
+// Any glyph pointer other than those two may be freed by cache_glyph(),
+// generation() changes whenever that happens.
+//
+class glyph_budget_cache {
+ public:
+  ~glyph_budget_cache();
+  explicit glyph_budget_cache(unsigned long max_bytes = 4 * 1024 * 1024);
+
+  void font(const char* font_signature, bool reset_cache = false);
+  const char* font() const;
+
+  // Look up a glyph of the current font and mark it as the most recent
+  const glyph_cache* find_glyph(unsigned glyph_code);
+  glyph_cache* cache_glyph(unsigned glyph_code, unsigned glyph_index,
+                           unsigned data_size, glyph_data_type data_type,
+                           const rect_i& bounds, double advance_x,
+                           double advance_y);
+  // Free a glyph of the current font, false if it is not cached
+  bool remove_glyph(unsigned glyph_code);
+
+  void max_bytes(unsigned long max_bytes);
+  unsigned long max_bytes() const { return m_max_bytes; }
+  unsigned long bytes_used() const { return m_bytes_used; }
+  unsigned num_glyphs() const { return m_num_glyphs; }
+  unsigned num_fonts() const { return m_num_fonts; }
+  unsigned long evictions() const { return m_evictions; }
+  unsigned generation() const { return m_generation; }
+
+  // Drop all the glyphs and the fonts other than the current one
+  void clear();
+
+ private:
+  struct font_entry;
+  struct entry;
+
+  glyph_budget_cache(const glyph_budget_cache&);
+  const glyph_budget_cache& operator=(const glyph_budget_cache&);
+
+  unsigned bucket(const font_entry* font, unsigned glyph_code) const;
+  void rehash(unsigned num_buckets);
+  void shrink(unsigned long extra);
+  void unlink(entry* e);
+  void push_front(entry* e);
+  void remove(entry* e);
+  void remove_font(font_entry* font);
+  void drop_glyphs(font_entry* font);
+
+  entry** m_buckets;
+  unsigned m_num_buckets;
+  entry* m_lru_first;
+  entry* m_lru_last;
+  font_entry* m_fonts;
+  font_entry* m_cur_font;
+  unsigned m_num_glyphs;
+  unsigned m_num_fonts;
+  unsigned long m_max_bytes;
+  unsigned long m_bytes_used;
+  unsigned long m_evictions;
+  unsigned m_generation;
+};
+
+//------------------------------------------------budget_font_cache_manager
+// Drop-in replacement of font_cache_manager for long running processes
+// rendering arbitrary text: glyphs are kept in a glyph_budget_cache
+// instead of fixed font slots that keep their glyphs forever.
+//
+template <class FontEngine>
+class budget_font_cache_manager {
+ public:
+  typedef FontEngine font_engine_type;
+  typedef budget_font_cache_manager<FontEngine> self_type;
+  typedef typename font_engine_type::path_adaptor_type path_adaptor_type;
+  typedef typename font_engine_type::gray8_adaptor_type gray8_adaptor_type;
+  typedef typename gray8_adaptor_type::embedded_scanline gray8_scanline_type;
+  typedef typename font_engine_type::mono_adaptor_type mono_adaptor_type;
+  typedef typename mono_adaptor_type::embedded_scanline mono_scanline_type;
+
+  budget_font_cache_manager(font_engine_type& engine,
+                            unsigned long max_bytes = 4 * 1024 * 1024)
+      : m_glyphs(max_bytes),
+        m_engine(&engine),
+        m_change_stamp(-1),
+        m_prev_glyph(0),
+        m_last_glyph(0) {}
+
+  void reset_last_glyph() { m_prev_glyph = m_last_glyph = 0; }
+
+  const glyph_cache* glyph(unsigned glyph_code) {
+    synchronize();
+    const glyph_cache* gl = m_glyphs.find_glyph(glyph_code);
+    if (gl) {
+      m_prev_glyph = m_last_glyph;
+      return m_last_glyph = gl;
+    }
+    if (m_engine->prepare_glyph(glyph_code)) {
+      glyph_cache* g = m_glyphs.cache_glyph(
+          glyph_code, m_engine->glyph_index(), m_engine->data_size(),
+          m_engine->data_type(), m_engine->bounds(), m_engine->advance_x(),
+          m_engine->advance_y());
+      if (g) {
+        m_engine->write_glyph_to(g->data);
+        m_prev_glyph = m_last_glyph;
+        return m_last_glyph = g;
+      }
+    }
+    return 0;
+  }
+
+  void init_embedded_adaptors(const glyph_cache* gl, double x, double y,
+                              double scale = 1.0) {
+    if (gl) {
+      switch (gl->data_type) {
+        default:
+          return;
+        case glyph_data_mono:
+          m_mono_adaptor.init(gl->data, gl->data_size, x, y);
+          break;
+        case glyph_data_gray8:
+          m_gray8_adaptor.init(gl->data, gl->data_size, x, y);
+          break;
+        case glyph_data_outline:
+          m_path_adaptor.init(gl->data, gl->data_size, x, y, scale);
+          break;
+      }
+    }
+  }
+
+  path_adaptor_type& path_adaptor() { return m_path_adaptor; }
+  gray8_adaptor_type& gray8_adaptor() { return m_gray8_adaptor; }
+  gray8_scanline_type& gray8_scanline() { return m_gray8_scanline; }
+  mono_adaptor_type& mono_adaptor() { return m_mono_adaptor; }
+  mono_scanline_type& mono_scanline() { return m_mono_scanline; }
+
+  const glyph_cache* perv_glyph() const { return m_prev_glyph; }
+  const glyph_cache* last_glyph() const { return m_last_glyph; }
+
+  bool add_kerning(double* x, double* y) {
+    if (m_prev_glyph && m_last_glyph) {
+      return m_engine->add_kerning(m_prev_glyph->glyph_index,
+                                   m_last_glyph->glyph_index, x, y);
+    }
+    return false;
+  }
+
+  void precache(unsigned from, unsigned to) {
+    for (; from <= to; ++from) glyph(from);
+  }
+
+  // Add glyphs prepared elsewhere, such as the font_glyph_set of a
+  // font_prewarmer job. Glyphs already cached are kept.
+  template <class GlyphSet>
+  unsigned add_glyphs(const GlyphSet& set) {
+    unsigned n = 0;
+    m_glyphs.font(set.signature());
+    for (unsigned i = 0; i < set.size(); ++i) {
+      const glyph_cache& gl = set.glyph(i);
+      glyph_cache* g = m_glyphs.cache_glyph(
+          set.code(i), gl.glyph_index, gl.data_size, gl.data_type, gl.bounds,
+          gl.advance_x, gl.advance_y);
+      if (g) {
+        if (gl.data_size) memcpy(g->data, gl.data, gl.data_size);
+        ++n;
+      }
+    }
+    // Select the font of the engine again on the next glyph()
+    m_change_stamp = -1;
+    m_prev_glyph = m_last_glyph = 0;
+    return n;
+  }
+
+  void reset_cache() {
+    m_glyphs.font(m_engine->font_signature(), true);
+    m_change_stamp = m_engine->change_stamp();
+    m_prev_glyph = m_last_glyph = 0;
+  }
+
+  glyph_budget_cache& glyphs() { return m_glyphs; }
+  const glyph_budget_cache& glyphs() const { return m_glyphs; }
+  unsigned generation() const { return m_glyphs.generation(); }
+
+ private:
+  budget_font_cache_manager(const self_type&);
+  const self_type& operator=(const self_type&);
+
+  void synchronize() {
+    if (m_change_stamp != m_engine->change_stamp()) {
+      m_glyphs.font(m_engine->font_signature());
+      m_change_stamp = m_engine->change_stamp();
+      m_prev_glyph = m_last_glyph = 0;
+    }
+  }
+
+  glyph_budget_cache m_glyphs;
+  font_engine_type* m_engine;
+  int m_change_stamp;
+  const glyph_cache* m_prev_glyph;
+  const glyph_cache* m_last_glyph;
+  path_adaptor_type m_path_adaptor;
+  gray8_adaptor_type m_gray8_adaptor;
+  gray8_scanline_type m_gray8_scanline;
+  mono_adaptor_type m_mono_adaptor;
+  mono_scanline_type m_mono_scanline;
+};
+
+//------------------------------------------------------------------------
+template <class FontEngine>
+inline unsigned glyph_cache_generation(
+    const budget_font_cache_manager<FontEngine>& fman) {
+  return fman.generation();
+}
+
+}  // namespace agg
+
+#endif
@@ -0,0 +1,253 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_COLOR_INCLUDED
+#define AGG_FONT_COLOR_INCLUDED
+
+#include <math.h>
+#include <string.h>
+
+#include "agg_array.h"
+#include "agg_basics.h"
+#include "agg_font_budget_cache.h"
+#include "agg_font_cache_manager.h"
+#include "agg_font_outline_units.h"
+#include "agg_font_text.h"
+#include "agg_renderer_scanline.h"
+
+namespace agg {
+
+//------------------------------------------------------------------------
+// Rendering mode of font_engine_freetype_base for color fonts: glyphs are
+// loaded with FT_LOAD_COLOR and those with colors, from CBDT, sbix or
+// COLR tables, are cached as premultiplied BGRA pixels, 4 bytes per pixel
+// over their bounds, rows in order of increasing y. AGG's glyph_data_type
+// has no such value, the pixels are cached as glyph_data_invalid like
+// distance fields. Glyphs without colors are cached as for
+// glyph_ren_native_gray8. Both are drawn by render_text_color().
+const glyph_rendering glyph_ren_color =
+    glyph_rendering(glyph_ren_outline_units + 1);
+
+//------------------------------------------------------------------------
+// Premultiplied source over destination, k being 255 minus the source
+// alpha
+inline int8u color_glyph_over(unsigned src, unsigned dst, unsigned k) {
+  unsigned t = dst * k + 128;
+  unsigned v = src + ((t + (t >> 8)) >> 8);
+  return int8u(v > 255 ? 255 : v);
+}
+
+// The alpha channel of rgba32 formats is blended too, rgb24 has none
+template <unsigned PixWidth>
+struct color_glyph_alpha {
+  template <class Order>
+  static void blend(int8u*, unsigned, unsigned) {}
+};
+
+template <>
+struct color_glyph_alpha<4> {
+  template <class Order>
+  static void blend(int8u* p, unsigned a, unsigned k) {
+    p[Order::A] = color_glyph_over(a, p[Order::A], k);
+  }
+};
+
+//------------------------------------------------------------------------
+// Area average of the premultiplied BGRA pixels of a sw by sh glyph into
+// dw by dh pixels, in fixed point. Texel i of a row covers the target
+// pixels ox + i * sx to ox + (i + 1) * sx, likewise down the columns.
+void color_bitmap_resample(const int8u* src, int sw, int sh, double ox,
+                           double oy, double sx, double sy, int8u* dst,
+                           int dw, int dh);
+
+//-----------------------------------------------------color_bitmap_cache
+// Color glyphs resampled to the size they are drawn at, kept in a
+// glyph_budget_cache by glyph index under the font signature and scale.
+// The bounds of a scaled glyph are in target pixels from the pen, which
+// is rounded to whole pixels when drawing, so that drawing a glyph again
+// is an integer blit.
+//
+class color_bitmap_cache {
+ public:
+  explicit color_bitmap_cache(unsigned long max_bytes = 4 * 1024 * 1024)
+      : m_bitmaps(max_bytes), m_scale_x(1.0), m_scale_y(1.0) {}
+
+  // Select the font and the scale of the next lookups
+  void font(const char* font_signature, double scale_x, double scale_y);
+
+  // Glyph of a color strike resampled to the current scale, 0 if it
+  // does not fit the budget
+  const glyph_cache* scaled(const glyph_cache* glyph);
+
+  const glyph_budget_cache& bitmaps() const { return m_bitmaps; }
+  void clear() { m_bitmaps.clear(); }
+
+ private:
+  color_bitmap_cache(const color_bitmap_cache&);
+  const color_bitmap_cache& operator=(const color_bitmap_cache&);
+
+  glyph_budget_cache m_bitmaps;
+  pod_array<char> m_key;
+  double m_scale_x;
+  double m_scale_y;
+};
+
+//-------------------------------------------------------color_run_renderer
+// Glyph sink for layout_text() blending color glyphs into a renderer_base
+// of an rgb24 or rgba32 pixel format, scaled from the size of their
+// bitmap strike by scale, and gray8 glyphs in a solid color. Color glyphs
+// are drawn at the pen rounded to whole pixels, their premultiplied
+// pixels blended in integers; scaled ones are taken from bitmaps. The
+// slant of the style does not apply to bitmaps.
+//
+template <class FontCacheManager, class BaseRenderer>
+class color_run_renderer {
+ public:
+  typedef typename BaseRenderer::color_type color_type;
+
+  color_run_renderer(FontCacheManager& fman, BaseRenderer& ren,
+                     color_bitmap_cache& bitmaps,
+                     const char* font_signature, const color_type& color,
+                     double scale, const text_style& style)
+      : m_fman(&fman),
+        m_ren(&ren),
+        m_bitmaps(&bitmaps),
+        m_solid(ren),
+        m_scaled(scale * style.width != 1.0 || scale != 1.0),
+        m_snap_baseline(style.snap_baseline) {
+    m_solid.color(color);
+    if (m_scaled) bitmaps.font(font_signature, scale * style.width, scale);
+  }
+
+  void add_glyph(const glyph_cache* glyph, unsigned, double x, double y) {
+    if (m_snap_baseline) y = floor(y + 0.5);
+    if (glyph->data_type == glyph_data_gray8) {
+      m_fman->init_embedded_adaptors(glyph, x, y);
+      render_scanlines(m_fman->gray8_adaptor(), m_fman->gray8_scanline(),
+                       m_solid);
+      return;
+    }
+    if (glyph->data_type != glyph_data_invalid) return;
+
+    const rect_i& b = glyph->bounds;
+    int gw = b.x2 - b.x1;
+    int gh = b.y2 - b.y1;
+    if (gw <= 0 || gh <= 0 || unsigned(gw * gh * 4) != glyph->data_size) {
+      return;
+    }
+    if (m_scaled) {
+      glyph = m_bitmaps->scaled(glyph);
+      if (glyph == 0) return;
+    }
+
+    const rect_i& sb = glyph->bounds;
+    int gx = int(floor(x + 0.5)) + sb.x1;
+    int gy = int(floor(y + 0.5)) + sb.y1;
+    int px1 = gx > m_ren->xmin() ? gx : m_ren->xmin();
+    int px2 = gx + sb.x2 - sb.x1;
+    int py1 = gy > m_ren->ymin() ? gy : m_ren->ymin();
+    int py2 = gy + sb.y2 - sb.y1;
+    if (px2 > m_ren->xmax() + 1) px2 = m_ren->xmax() + 1;
+    if (py2 > m_ren->ymax() + 1) py2 = m_ren->ymax() + 1;
+    if (px1 >= px2 || py1 >= py2) return;
+    blend_pixels(glyph->data, sb.x2 - sb.x1, gx, gy, px1, px2, py1, py2);
+  }
+
+  void end_line() {}
+
+ private:
+  color_run_renderer(const color_run_renderer&);
+  const color_run_renderer& operator=(const color_run_renderer&);
+
+  // Glyph with its top left pixel at (gx, gy), clipped to the pixels
+  // x1 to x2 and y1 to y2, all inside the glyph
+  void blend_pixels(const int8u* data, int gw, int gx, int gy, int x1,
+                    int x2, int y1, int y2) {
+    typedef typename BaseRenderer::pixfmt_type pixfmt_type;
+    typedef typename pixfmt_type::order_type order_type;
+    pixfmt_type& pf = m_ren->ren();
+    for (int py = y1; py < y2; ++py) {
+      const int8u* s = data + ((py - gy) * gw + x1 - gx) * 4;
+      int8u* p = pf.pix_ptr(x1, py);
+      for (int px = x1; px < x2; ++px, s += 4, p += pixfmt_type::pix_width) {
+        unsigned a = s[3];
+        if (a == 0) continue;
+        unsigned k = 255 - a;
+        p[order_type::R] = color_glyph_over(s[2], p[order_type::R], k);
+        p[order_type::G] = color_glyph_over(s[1], p[order_type::G], k);
+        p[order_type::B] = color_glyph_over(s[0], p[order_type::B], k);
+        color_glyph_alpha<pixfmt_type::pix_width>::template blend<order_type>(
+            p, a, k);
+      }
+    }
+  }
+
+  FontCacheManager* m_fman;
+  BaseRenderer* m_ren;
+  color_bitmap_cache* m_bitmaps;
+  renderer_scanline_aa_solid<BaseRenderer> m_solid;
+  bool m_scaled;
+  bool m_snap_baseline;
+};
+
+//--------------------------------------------------------render_text_color
+// render_text() for an engine in glyph_ren_color mode, drawing into a
+// renderer_base. Glyphs of bitmap strikes are scaled to the height() of
+// the engine by its color_scale(), glyphs without colors are drawn in
+// color. Keep bitmaps across calls so that each glyph is resampled once
+// per size; without it they are resampled once per call.
+//
+template <class FontEngine, class FontCacheManager, class BaseRenderer,
+          class CharT>
+void render_text_color(FontEngine& feng, FontCacheManager& fman,
+                       BaseRenderer& ren, color_bitmap_cache& bitmaps,
+                       const CharT* text, unsigned len, double* x, double* y,
+                       const typename BaseRenderer::color_type& color,
+                       const text_style& style = text_style()) {
+  double scale = feng.color_scale();
+  color_run_renderer<FontCacheManager, BaseRenderer> run(
+      fman, ren, bitmaps, feng.font_signature(), color, scale, style);
+  // The advances and kerning are those of the strike
+  text_style scaled = style;
+  scaled.width *= scale;
+  layout_text(feng, fman, text, len, x, y, scaled, run);
+}
+
+//------------------------------------------------------------------------
+template <class FontEngine, class FontCacheManager, class BaseRenderer,
+          class CharT>
+void render_text_color(FontEngine& feng, FontCacheManager& fman,
+                       BaseRenderer& ren, const CharT* text, unsigned len,
+                       double* x, double* y,
+                       const typename BaseRenderer::color_type& color,
+                       const text_style& style = text_style()) {
+  color_bitmap_cache bitmaps;
+  render_text_color(feng, fman, ren, bitmaps, text, len, x, y, color, style);
+}
+
+//------------------------------------------------------------------------
+template <class FontEngine, class FontCacheManager, class BaseRenderer>
+void render_text_color(FontEngine& feng, FontCacheManager& fman,
+                       BaseRenderer& ren, const char* text, double* x,
+                       double* y,
+                       const typename BaseRenderer::color_type& color,
+                       const text_style& style = text_style()) {
+  render_text_color(feng, fman, ren, text, unsigned(strlen(text)), x, y,
+                    color, style);
+}
+
+}  // namespace agg
+
+#endif
@@ -0,0 +1,219 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+//
+// See implementation agg_font_fallback.cpp
+//
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_FALLBACK_INCLUDED
+#define AGG_FONT_FALLBACK_INCLUDED
+
+#include "agg_array.h"
+#include "agg_font_freetype.h"
+#include "agg_font_text.h"
+#include "agg_font_utf8.h"
+
+namespace agg {
+
+//-----------------------------------------------------------font_coverage
+// Character codes of a face as a two-level bitmap: pages of 256 codes,
+// 32 bytes each, for the ranges the face covers, the others share an
+// empty page, so has() is two lookups whatever the code.
+//
+class font_coverage {
+ public:
+  enum {
+    max_code = 0x110000,
+    page_shift = 8,
+    num_pages = max_code >> page_shift
+  };
+
+  font_coverage() { clear(); }
+
+  void clear();
+  void add(unsigned code);
+  // Codes of the character map of the engine's current face
+  void build(const font_engine_freetype_base& feng);
+
+  bool has(unsigned code) const {
+    if (code >= max_code) return false;
+    const page& p = m_pages[m_index[code >> page_shift]];
+    return (p.bits[(code >> 3) & 31] >> (code & 7)) & 1;
+  }
+
+  unsigned num_codes() const { return m_num_codes; }
+  unsigned byte_size() const {
+    return unsigned(sizeof(m_index)) + m_pages.size() * sizeof(page);
+  }
+
+ private:
+  struct page {
+    int8u bits[32];
+  };
+
+  int16u m_index[num_pages];  // Page of each range, 0 for the empty one
+  pod_bvector<page, 4> m_pages;
+  unsigned m_num_codes;
+};
+
+//-----------------------------------------------------font_fallback_chain
+// Faces tried in order for each character code: the first one covering
+// it draws it, codes covered by none are drawn with the .notdef glyph of
+// the first face. The coverage of each face is built once by add(),
+// resolve() is then a bitmap test per face and does not go to FreeType.
+// All the faces are loaded with the rendering mode of the chain.
+//
+// The font names are copied, fonts in memory must stay valid as long as
+// the chain is used.
+//
+class font_fallback_chain {
+ public:
+  ~font_fallback_chain();
+  explicit font_fallback_chain(glyph_rendering ren = glyph_ren_agg_gray8);
+
+  // Append a face. It is loaded into feng to read its character map, the
+  // first face of the chain is the current one of feng again afterwards.
+  bool add(font_engine_freetype_base& feng, const char* font_name,
+           unsigned face_index = 0, const char* font_mem = 0,
+           long font_mem_size = 0);
+  void remove_all();
+
+  unsigned num_faces() const { return m_faces.size(); }
+  const char* font_name(unsigned i) const { return m_faces[i]->name; }
+  const font_coverage& coverage(unsigned i) const {
+    return m_faces[i]->coverage;
+  }
+  glyph_rendering rendering() const { return m_rendering; }
+
+  // Face drawing code; its glyph index is that of the glyph cached for
+  // code once the face is selected
+  unsigned resolve(unsigned code) const {
+    for (unsigned i = 0; i < m_faces.size(); ++i) {
+      if (m_faces[i]->coverage.has(code)) return i;
+    }
+    return 0;
+  }
+
+  // Make face i the current face of feng, keeping its size and other
+  // parameters
+  bool select(font_engine_freetype_base& feng, unsigned i) const;
+
+ private:
+  font_fallback_chain(const font_fallback_chain&);
+  const font_fallback_chain& operator=(const font_fallback_chain&);
+
+  struct face_entry {
+    char* name;
+    unsigned face_index;
+    const char* font_mem;
+    long font_mem_size;
+    font_coverage coverage;
+  };
+
+  glyph_rendering m_rendering;
+  pod_bvector<face_entry*, 4> m_faces;
+};
+
+//-----------------------------------------------------fallback_glyph_table
+// Glyph table for layout_text(), render_text_utf8() and the others,
+// taking each glyph from the face of the chain that covers it. The engine
+// must have the first face of the chain selected; the face is switched
+// as the text goes, which switches the glyph cache of the manager too,
+// and the first face is selected again by the destructor. engine()
+// stands for the engine in the layout, kerning only glyphs of the same
+// face.
+//
+//   fallback_glyph_table<font_cache_manager<font_engine_freetype_int32> >
+//       table(chain, feng, fman);
+//   render_text_utf8(table, ras, sl, ren, text, len, &x, &y);
+//
+template <class FontCacheManager>
+class fallback_glyph_table {
+ public:
+  typedef fallback_glyph_table<FontCacheManager> font_engine_type;
+  typedef FontCacheManager font_cache_manager_type;
+
+  fallback_glyph_table(const font_fallback_chain& chain,
+                       font_engine_freetype_base& feng, FontCacheManager& fman)
+      : m_chain(&chain),
+        m_feng(&feng),
+        m_fman(&fman),
+        m_face(0),
+        m_prev_face(0),
+        m_same_face(false) {}
+
+  ~fallback_glyph_table() {
+    if (m_face != 0) m_chain->select(*m_feng, 0);
+  }
+
+  const glyph_cache* glyph(unsigned code) {
+    unsigned face = m_chain->resolve(code);
+    if (face != m_face) {
+      if (!m_chain->select(*m_feng, face)) return 0;
+      m_face = face;
+    }
+    m_same_face = face == m_prev_face;
+    m_prev_face = face;
+    return m_fman->glyph(code);
+  }
+
+  // Font engine interface used by layout_text()
+  double height() const { return m_feng->height(); }
+  bool flip_y() const { return m_feng->flip_y(); }
+  bool add_kerning(unsigned first, unsigned second, double* x, double* y) {
+    return m_same_face && m_feng->add_kerning(first, second, x, y);
+  }
+
+  font_engine_type& engine() { return *this; }
+  FontCacheManager& cache() { return *m_fman; }
+
+  // Scratch storage for decoded text
+  unsigned* codes(unsigned len) {
+    m_codes.capacity(len + 1);
+    return &m_codes[0];
+  }
+
+ private:
+  fallback_glyph_table(const fallback_glyph_table&);
+  const fallback_glyph_table& operator=(const fallback_glyph_table&);
+
+  const font_fallback_chain* m_chain;
+  font_engine_freetype_base* m_feng;
+  FontCacheManager* m_fman;
+  unsigned m_face;       // Face selected in the engine
+  unsigned m_prev_face;  // Face of the previous glyph
+  bool m_same_face;
+  pod_vector<unsigned> m_codes;
+};
+
+//----------------------------------------------------render_text_fallback
+// render_text_utf8() with the glyphs of each code point taken from the
+// face of the chain covering it, see fallback_glyph_table.
+//
+template <class FontCacheManager, class Rasterizer, class Scanline,
+          class Renderer>
+void render_text_fallback(const font_fallback_chain& chain,
+                          font_engine_freetype_base& feng,
+                          FontCacheManager& fman, Rasterizer& ras,
+                          Scanline& sl, Renderer& ren, const char* text,
+                          unsigned len, double* x, double* y,
+                          const text_style& style = text_style()) {
+  fallback_glyph_table<FontCacheManager> table(chain, feng, fman);
+  render_text_utf8(table, ras, sl, ren, text, len, x, y, style);
+}
+
+}  // namespace agg
+
+#endif
@@ -20,11 +20,21 @@
 #ifndef AGG_FONT_FREETYPE_INCLUDED
 #define AGG_FONT_FREETYPE_INCLUDED
 
+#include <math.h>
+#include <string.h>
+
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_ADVANCES_H
+#include FT_MULTIPLE_MASTERS_H
+#include FT_OUTLINE_H
 
 #include "agg_conv_curve.h"
+#include "agg_conv_stroke.h"
 #include "agg_font_cache_manager.h"
+#include "agg_font_color.h"
+#include "agg_font_outline_units.h"
+#include "agg_font_sdf.h"
 #include "agg_path_storage_integer.h"
 #include "agg_rasterizer_scanline_aa.h"
 #include "agg_scanline_bin.h"
@@ -35,6 +45,169 @@
 
 namespace agg {
 
+// Conversion of FreeType outlines and bitmaps to the AGG storages, as done
+// by prepare_glyph(). Instantiated for the types used by the engine.
+//------------------------------------------------------------------------
+template <class PathStorage>
+bool decompose_ft_outline(const FT_Outline& outline, bool flip_y,
+                          const trans_affine& mtx, PathStorage& path);
+
+template <class Scanline, class ScanlineStorage>
+void decompose_ft_bitmap_mono(const FT_Bitmap& bitmap, int x, int y,
+                              bool flip_y, Scanline& sl,
+                              ScanlineStorage& storage);
+
+template <class Rasterizer, class Scanline, class ScanlineStorage>
+void decompose_ft_bitmap_gray8(const FT_Bitmap& bitmap, int x, int y,
+                               bool flip_y, Rasterizer& ras, Scanline& sl,
+                               ScanlineStorage& storage);
+
+//----------------------------------------------------------font_hinting_e
+// Hinting applied by prepare_glyph(). font_hinting_light snaps to the
+// pixel grid vertically only and keeps the unhinted advances, so glyphs
+// can be scaled horizontally and placed at subpixel positions, as for
+// LCD rendering, at their real size. font_hinting_native uses the hints
+// of the font, if any, and font_hinting_autohint always the FreeType
+// autohinter.
+enum font_hinting_e {
+  font_hinting_none,
+  font_hinting_light,
+  font_hinting_native,
+  font_hinting_autohint
+};
+
+//---------------------------------------------------------------font_axis
+// A design axis of a variable font, see font_engine_freetype_base::axis().
+// The tag is made with FT_MAKE_TAG, such as FT_MAKE_TAG('w', 'g', 'h', 't')
+// for the weight, the values are design coordinates.
+//
+struct font_axis {
+  enum { max_axes = 16 };  // Axes the engine sets, the others stay default
+
+  FT_ULong tag;
+  double minimum;
+  double def;
+  double maximum;
+};
+
+//-------------------------------------------------------font_engine_stats
+// Counters kept by font_engine_freetype_base. They are plain increments
+// done along with the work they count, so they are always enabled.
+//
+struct font_engine_stats {
+  enum { max_glyph_rendering = 8 };
+
+  unsigned long faces_opened;
+  unsigned long faces_evicted;
+  unsigned long load_font_hits;     // load_font() of an already open face
+  unsigned long size_changes;       // Sizes set on a face that differed
+  unsigned long signature_updates;
+  unsigned long glyphs_prepared[max_glyph_rendering];  // By glyph_rendering
+  unsigned long metrics_prepared;
+  unsigned long load_errors;        // FT_New_Face() and FT_Load_Glyph()
+  unsigned long render_errors;      // FT_Render_Glyph() and decomposition
+  unsigned long kerning_lookups;
+  unsigned long bytes_prepared;     // Sum of data_size() of the glyphs
+
+  font_engine_stats() { reset(); }
+  void reset() { memset(this, 0, sizeof(*this)); }
+
+  unsigned long total_glyphs_prepared() const {
+    unsigned long n = 0;
+    for (unsigned i = 0; i < max_glyph_rendering; ++i) n += glyphs_prepared[i];
+    return n;
+  }
+};
+
+//-----------------------------------------------------font_timing_stage_e
+// Stages of load_font() and prepare_glyph() reported to the timing
+// callback. The hooks are compiled in only with AGG_FONT_TIMING defined
+// when building the engine, see the timing meson option.
+//
+enum font_timing_stage_e {
+  font_timing_open_face,      // FT_New_Face() in load_font()
+  font_timing_set_size,       // FT_Set_Char_Size() / FT_Set_Pixel_Sizes()
+  font_timing_load_glyph,     // FT_Load_Glyph(), including hinting
+  font_timing_render_bitmap,  // FT_Render_Glyph() of the native modes
+  font_timing_decompose,      // Conversion to AGG paths or scanlines
+  font_timing_rasterize,      // AGG rasterization of the agg modes
+  font_timing_serialize,      // write_glyph_to()
+  font_timing_num_stages
+};
+
+// Called with the duration of a stage in seconds, the font file name and
+// the rendering mode of the font.
+typedef void (*font_timing_callback)(void* data, font_timing_stage_e stage,
+                                     const char* font_name,
+                                     glyph_rendering ren, double seconds);
+
+//---------------------------------------------------font_timing_histogram
+// Built-in timing sink: log2 histograms of the durations per stage and
+// rendering mode. Bucket i counts durations of 2^i to 2^(i+1) ns.
+//
+//   font_timing_histogram hist;
+//   feng.timing_callback(font_timing_histogram::record, &hist);
+//
+class font_timing_histogram {
+ public:
+  enum {
+    num_buckets = 32,
+    max_glyph_rendering = font_engine_stats::max_glyph_rendering
+  };
+
+  font_timing_histogram() { reset(); }
+  void reset() { memset(this, 0, sizeof(*this)); }
+
+  void add(font_timing_stage_e stage, glyph_rendering ren, double seconds) {
+    entry& e = m_entries[stage][unsigned(ren) % max_glyph_rendering];
+    double ns = seconds * 1e9;
+    unsigned i = 0;
+    while (i < num_buckets - 1 && ns >= ldexp(1.0, i + 1)) ++i;
+    ++e.buckets[i];
+    ++e.count;
+    e.total += seconds;
+  }
+
+  static void record(void* hist, font_timing_stage_e stage, const char*,
+                     glyph_rendering ren, double seconds) {
+    ((font_timing_histogram*)hist)->add(stage, ren, seconds);
+  }
+
+  unsigned long count(font_timing_stage_e stage, glyph_rendering ren) const {
+    return m_entries[stage][unsigned(ren) % max_glyph_rendering].count;
+  }
+  double total(font_timing_stage_e stage, glyph_rendering ren) const {
+    return m_entries[stage][unsigned(ren) % max_glyph_rendering].total;
+  }
+  unsigned long bucket(font_timing_stage_e stage, glyph_rendering ren,
+                       unsigned i) const {
+    return m_entries[stage][unsigned(ren) % max_glyph_rendering].buckets[i];
+  }
+
+  // Upper bound in seconds of the bucket holding the p-th percentile. The
+  // last bucket also holds the samples above its bound of 2^32 ns.
+  double percentile(font_timing_stage_e stage, glyph_rendering ren,
+                    double p) const {
+    const entry& e = m_entries[stage][unsigned(ren) % max_glyph_rendering];
+    unsigned long n = 0;
+    for (unsigned i = 0; i < num_buckets; ++i) {
+      n += e.buckets[i];
+      if (n > 0 && double(n) >= p * 0.01 * double(e.count)) {
+        return ldexp(1.0, i + 1) * 1e-9;
+      }
+    }
+    return 0.0;
+  }
+
+ private:
+  struct entry {
+    unsigned long buckets[num_buckets];
+    unsigned long count;
+    double total;
+  };
+  entry m_entries[font_timing_num_stages][max_glyph_rendering];
+};
+
 //-----------------------------------------------font_engine_freetype_base
 class font_engine_freetype_base {
  public:
@@ -58,10 +231,40 @@ class font_engine_freetype_base {
   bool char_map(FT_Encoding map);
   bool height(double h);
   bool width(double w);
-  void hinting(bool h);
+  void hinting(font_hinting_e h);
+  void hinting(bool h) {
+    hinting(h ? font_hinting_autohint : font_hinting_none);
+  }
   void flip_y(bool f);
   void transform(const trans_affine& affine);
 
+  // Synthetic styles applied to the outlines by prepare_glyph() and
+  // cached with them: embolden() makes the stems strength pixels wider
+  // at height(), horizontally only, negative values make them thinner;
+  // oblique() shears x by slant * y. Bitmap glyphs are left as they are.
+  void embolden(double strength);
+  void oblique(double slant);
+
+  // Cache the stroke of the outlines instead of their fill, for outlined
+  // and halo text, in glyph_ren_outline and the agg modes. The width is
+  // in pixels after transform(), zero fills the glyphs again.
+  void stroke(double width, line_join_e join = round_join,
+              double miter_limit = 4.0);
+
+  // Reference height of the distance fields of glyph_ren_sdf and their
+  // spread in pixels at that height, zero for an eighth of the height.
+  // height() is then only the size render_text_sdf() draws at.
+  bool sdf_size(double height, double spread = 0.0);
+
+  // Design coordinates of a variable font, set on the current face in
+  // place: each face keeps the instance last set on it, its glyphs are
+  // cached under a signature with the coordinates, so switching weights
+  // only switches caches. axis() sets one axis, axes() the first num in
+  // the order of axis_info(), the others to their default, and no
+  // coordinates at all return to the default instance of the face.
+  bool axis(FT_ULong tag, double value);
+  bool axes(const double* coords, unsigned num);
+
   // Set Gamma
   //--------------------------------------------------------------------
   template <class GammaF>
@@ -80,8 +283,41 @@ class font_engine_freetype_base {
   double width() const { return double(m_width) / 64.0; }
   double ascender() const;
   double descender() const;
-  bool hinting() const { return m_hinting; }
+  bool hinting() const { return m_hinting != font_hinting_none; }
+  font_hinting_e hinting_mode() const { return m_hinting; }
+  double embolden() const { return m_embolden; }
+  double oblique() const { return m_oblique; }
+  double stroke_width() const { return m_stroke_width; }
+  line_join_e stroke_join() const { return m_stroke_join; }
+  double stroke_miter_limit() const { return m_stroke_miter_limit; }
   bool flip_y() const { return m_flip_y; }
+  unsigned face_index() const { return m_face_index; }
+  glyph_rendering rendering() const { return m_glyph_rendering; }
+  const trans_affine& transform() const { return m_affine; }
+  double sdf_height() const { return m_sdf_height; }
+  double sdf_spread() const { return m_sdf_spread; }
+  unsigned num_axes() const;
+  bool axis_info(unsigned i, font_axis* axis) const;
+  double axis(FT_ULong tag) const;
+  // Copy the coordinates set by axis() or axes() to coords, at most
+  // font_axis::max_axes, and return their number, zero for the instance
+  // the face was opened with
+  unsigned axes(double* coords) const;
+  // Size of the glyphs drawn in glyph_ren_color mode relative to the
+  // bitmap strike chosen for height(), 1 for scalable color fonts
+  double color_scale() const;
+  unsigned units_per_em() const;
+  // Font units to pixels at the current height() and width(), without
+  // transform(); glyph_ren_outline_units glyphs are drawn through it
+  trans_affine units_matrix() const;
+  // Character codes of the current face in increasing order, from its
+  // character map: first_char(), then next_char() while the glyph index
+  // is not zero
+  unsigned first_char(unsigned* glyph_index) const;
+  unsigned next_char(unsigned code, unsigned* glyph_index) const;
+  unsigned apply_gamma(unsigned cover) const {
+    return m_rasterizer.apply_gamma(cover);
+  }
 
   // Interface mandatory to implement for font_cache_manager
   //--------------------------------------------------------------------
@@ -98,13 +334,62 @@ class font_engine_freetype_base {
   void write_glyph_to(int8u* data) const;
   bool add_kerning(unsigned first, unsigned second, double* x, double* y);
 
+  // Metrics only: load the glyph without rendering or decomposing it.
+  // glyph_index(), bounds() and advances are set as by prepare_glyph(),
+  // bounds() comes from the glyph metrics and data_size() is zero. With
+  // advance_only just the advance is retrieved and bounds() is empty.
+  //--------------------------------------------------------------------
+  bool prepare_glyph_metrics(unsigned glyph_code, bool advance_only = false);
+
+  // Statistics, stats() returns a snapshot of the counters
+  //--------------------------------------------------------------------
+  font_engine_stats stats() const { return m_stats; }
+  void reset_stats() { m_stats.reset(); }
+
+  // Timing hooks, without effect unless built with AGG_FONT_TIMING
+  //--------------------------------------------------------------------
+  void timing_callback(font_timing_callback cb, void* data) {
+    m_timing_callback = cb;
+    m_timing_data = data;
+  }
+
  private:
   font_engine_freetype_base(const font_engine_freetype_base&);
   const font_engine_freetype_base& operator=(const font_engine_freetype_base&);
 
   void update_char_size();
   void update_signature();
-  int find_face(const char* face_name) const;
+  FT_Int32 load_flags() const;
+  FT_Pos embolden_strength() const;
+  void synthesize_style();
+  bool stroked() const;
+  void update_advance();
+  bool render_glyph();
+  bool render_sdf_glyph();
+  bool render_units_glyph();
+  bool render_color_glyph();
+  void select_color_strike();
+  double timing_now() const;
+  void timing_end(font_timing_stage_e stage, double start,
+                  const char* font_name, glyph_rendering ren) const;
+  int find_face(const char* face_name, unsigned face_index) const;
+  void done_face(unsigned i);
+  bool set_axes(const FT_Fixed* coords, unsigned num);
+
+  // Variations of a face: the axes read from it once and the coordinates
+  // set on it, none for the default instance. The size last set on the
+  // face is kept with them, a change of instance invalidates it.
+  struct face_variation {
+    FT_MM_Var* mm;
+    FT_Fixed coords[font_axis::max_axes];
+    unsigned num_coords;
+    bool sized;
+    bool size_strike;  // Set by select_color_strike()
+    unsigned size_width;
+    unsigned size_height;
+    int size_resolution;
+    double color_strike;
+  };
 
   bool m_flag32;
   int m_change_stamp;
@@ -116,15 +401,23 @@ class font_engine_freetype_base {
   char* m_signature;
   unsigned m_height;
   unsigned m_width;
-  bool m_hinting;
+  font_hinting_e m_hinting;
+  double m_embolden;
+  double m_oblique;
+  double m_stroke_width;
+  line_join_e m_stroke_join;
+  double m_stroke_miter_limit;
   bool m_flip_y;
   bool m_library_initialized;
   FT_Library m_library;  // handle to library
   FT_Face* m_faces;      // A pool of font faces
   char** m_face_names;
+  unsigned* m_face_indices;  // As opened, with the named instance
+  face_variation** m_face_vars;
   unsigned m_num_faces;
   unsigned m_max_faces;
   FT_Face m_cur_face;  // handle to the current face object
+  face_variation* m_cur_vars;
   int m_resolution;
   glyph_rendering m_glyph_rendering;
   unsigned m_glyph_index;
@@ -135,15 +428,30 @@ class font_engine_freetype_base {
   double m_advance_y;
   trans_affine m_affine;
 
+  // Per-glyph scratch. remove_all(), prepare() and reset() only rewind
+  // these, their blocks stay allocated for the next glyph.
   path_storage_integer<int16, 6> m_path16;
   path_storage_integer<int32, 6> m_path32;
   conv_curve<path_storage_integer<int16, 6> > m_curves16;
   conv_curve<path_storage_integer<int32, 6> > m_curves32;
+  conv_stroke<conv_curve<path_storage_integer<int16, 6> > > m_stroke16;
+  conv_stroke<conv_curve<path_storage_integer<int32, 6> > > m_stroke32;
+  path_storage_integer<int16, 6> m_stroked16;
+  path_storage_integer<int32, 6> m_stroked32;
   scanline_u8 m_scanline_aa;
   scanline_bin m_scanline_bin;
   scanlines_aa_type m_scanlines_aa;
   scanlines_bin_type m_scanlines_bin;
   rasterizer_scanline_aa<> m_rasterizer;
+  double m_sdf_height;
+  double m_sdf_spread;
+  distance_field m_sdf;
+  pod_vector<int8u> m_sdf_data;
+  double m_color_strike;  // Pixel size of the strike, zero when scalable
+  pod_vector<int8u> m_color_data;
+  font_engine_stats m_stats;
+  font_timing_callback m_timing_callback;
+  void* m_timing_data;
 };
 
 //------------------------------------------------font_engine_freetype_int16
@@ -0,0 +1,300 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_GLYPH_FILE_INCLUDED
+#define AGG_FONT_GLYPH_FILE_INCLUDED
+
+#include <string.h>
+
+#include "agg_array.h"
+#include "agg_basics.h"
+#include "agg_font_cache_manager.h"
+
+namespace agg {
+
+//------------------------------------------------------------------------
+// Layout of a baked glyph file. The file starts with a glyph_file_header
+// followed by the font table, the zero terminated font signatures, the
+// glyph records of every font sorted by code and the glyph data, as
+// produced by write_glyph_to(). Offsets are in bytes from the start of
+// the file and every block is 8-byte aligned, so the file can be mapped
+// and used in place. Values are stored in native byte order, a file
+// baked on a platform of the other endianness is rejected.
+//
+// A font is identified by the hash of its file and its signature without
+// the font name (see baked_font_signature()), so that the glyphs are
+// found whatever path the font is opened through. Version 1 files, keyed
+// on the full signature, are rejected.
+//
+enum glyph_file_constants_e {
+  glyph_file_version = 2,
+  glyph_file_byte_order = 0x01020304
+};
+
+struct glyph_file_header {
+  char magic[8];  // "AGGGLYPH"
+  int32u version;
+  int32u byte_order;
+  int32u num_fonts;
+  int32u fonts_offset;
+};
+
+struct glyph_file_font {
+  int32u signature_offset;
+  int32u font_hash;
+  int32u vertex_size;  // Size of an outline vertex, int16 or int32 paths
+  int32u num_glyphs;
+  int32u glyphs_offset;
+  int32u reserved;
+};
+
+struct glyph_file_glyph {
+  int32u code;
+  int32u glyph_index;
+  int32u data_offset;
+  int32u data_size;
+  int32u data_type;
+  int32 x1, y1, x2, y2;
+  int32u reserved;
+  double advance_x;
+  double advance_y;
+};
+
+//------------------------------------------------------------------------
+// FNV-1a hash of a font file or of a font in memory, used along with the
+// font signature to detect fonts changed since baking. Returns 0 if the
+// file cannot be read.
+int32u font_data_hash(const void* data, unsigned size);
+int32u font_file_hash(const char* file_name);
+
+//----------------------------------------------------baked_font_signature
+// Part of a font signature following the font name: face, size, rendering
+// and transformation, the font itself being known by its hash.
+inline const char* baked_font_signature(const char* signature,
+                                        const char* font_name) {
+  unsigned len = font_name ? unsigned(strlen(font_name)) : 0;
+  if (len && strncmp(signature, font_name, len) == 0) return signature + len;
+  return signature;
+}
+
+//--------------------------------------------------------------glyph_file
+// Read-only view of a baked glyph file. The file is memory mapped and the
+// glyph data is used in place, the glyph_cache records of a font are
+// built on first access from its glyph table.
+//
+class glyph_file {
+ public:
+  glyph_file();
+  ~glyph_file();
+
+  bool open(const char* file_name);
+  void close();
+  bool is_open() const { return m_data != 0; }
+
+  unsigned num_fonts() const { return m_num_fonts; }
+  const char* font_signature(unsigned font) const;
+  int32u font_hash(unsigned font) const;
+
+  // Index of the font baked with the given parameters, or -1. signature
+  // is a baked_font_signature().
+  int find_font(const char* signature, int32u font_hash,
+                unsigned vertex_size) const;
+
+  // Baked glyph of code, or 0 if it is not in the file
+  const glyph_cache* find_glyph(int font, unsigned code);
+
+ private:
+  glyph_file(const glyph_file&);
+  const glyph_file& operator=(const glyph_file&);
+
+  bool check_header();
+  bool load_font(unsigned font);
+
+  const int8u* m_data;
+  unsigned m_size;
+  void* m_mapping;
+  unsigned m_num_fonts;
+  const glyph_file_font* m_fonts;
+  glyph_cache** m_glyphs;  // Per font, built on demand
+};
+
+//-------------------------------------------------------glyph_file_writer
+// Collects baked glyphs and writes them out as a glyph file. Glyphs are
+// added to the font started by the last call of add_font().
+//
+class glyph_file_writer {
+ public:
+  glyph_file_writer();
+  ~glyph_file_writer();
+
+  void add_font(const char* signature, int32u font_hash,
+                unsigned vertex_size);
+  void add_glyph(unsigned code, unsigned glyph_index, const int8u* data,
+                 unsigned data_size, glyph_data_type data_type,
+                 const rect_i& bounds, double advance_x, double advance_y);
+  bool save(const char* file_name) const;
+  void clear();
+
+  unsigned num_fonts() const { return m_fonts.size(); }
+  unsigned num_glyphs() const { return m_glyphs.size(); }
+
+ private:
+  glyph_file_writer(const glyph_file_writer&);
+  const glyph_file_writer& operator=(const glyph_file_writer&);
+
+  struct font_entry {
+    char* signature;
+    int32u font_hash;
+    unsigned vertex_size;
+    unsigned first_glyph;
+  };
+
+  pod_bvector<font_entry, 4> m_fonts;
+  pod_bvector<glyph_file_glyph, 8> m_glyphs;
+  pod_bvector<int8u, 12> m_data;
+};
+
+//-------------------------------------------------------------bake_glyphs
+// Prepare the glyphs of num_codes character codes with the current
+// parameters of feng and add them to the writer as a new font. Codes the
+// font has no glyph for are skipped. Returns the number of glyphs added.
+// font_hash is that of the font file or data, see font_file_hash().
+//
+template <class FontEngine>
+unsigned bake_glyphs(FontEngine& feng, glyph_file_writer& writer,
+                     const unsigned* codes, unsigned num_codes,
+                     int32u font_hash) {
+  typedef typename FontEngine::path_adaptor_type::vertex_integer_type
+      vertex_type;
+  writer.add_font(baked_font_signature(feng.font_signature(), feng.name()),
+                  font_hash, sizeof(vertex_type));
+  pod_array<int8u> buf;
+  unsigned n = 0;
+  for (unsigned i = 0; i < num_codes; ++i) {
+    if (!feng.prepare_glyph(codes[i]) || feng.glyph_index() == 0) continue;
+    buf.resize(feng.data_size() + 1);
+    feng.write_glyph_to(&buf[0]);
+    writer.add_glyph(codes[i], feng.glyph_index(), &buf[0], feng.data_size(),
+                     feng.data_type(), feng.bounds(), feng.advance_x(),
+                     feng.advance_y());
+    ++n;
+  }
+  return n;
+}
+
+//-------------------------------------------------------baked_glyph_cache
+// Glyph source that serves the glyphs baked in a glyph_file for the
+// current font signature and font file, and falls back to the
+// font_cache_manager for everything else. The embedded adaptors are
+// those of the manager, so it can be used in place of the manager with
+// render_text() and ascii_glyph_table.
+//
+// Font files are hashed the first time their name is met, and not again
+// while the cache lives: call reset_hashes() after a font file changes.
+//
+template <class FontEngine, class FontCacheManager>
+class baked_glyph_cache {
+ public:
+  typedef FontEngine font_engine_type;
+  typedef typename FontCacheManager::path_adaptor_type path_adaptor_type;
+  typedef typename FontCacheManager::gray8_adaptor_type gray8_adaptor_type;
+  typedef typename FontCacheManager::gray8_scanline_type gray8_scanline_type;
+  typedef typename FontCacheManager::mono_adaptor_type mono_adaptor_type;
+  typedef typename FontCacheManager::mono_scanline_type mono_scanline_type;
+
+  baked_glyph_cache(FontEngine& feng, FontCacheManager& fman,
+                    glyph_file& file)
+      : m_feng(&feng),
+        m_fman(&fman),
+        m_file(&file),
+        m_change_stamp(-1),
+        m_font(-1) {}
+
+  ~baked_glyph_cache() { reset_hashes(); }
+
+  const glyph_cache* glyph(unsigned code) {
+    synchronize();
+    if (m_font >= 0) {
+      const glyph_cache* gl = m_file->find_glyph(m_font, code);
+      if (gl) return gl;
+    }
+    return m_fman->glyph(code);
+  }
+
+  // Call after the glyph file is reopened
+  void reset() { m_change_stamp = -1; }
+
+  // Forget the hashes of the font files
+  void reset_hashes() {
+    for (unsigned i = 0; i < m_hashes.size(); ++i) delete[] m_hashes[i].name;
+    m_hashes.remove_all();
+    m_change_stamp = -1;
+  }
+
+  void init_embedded_adaptors(const glyph_cache* gl, double x, double y,
+                              double scale = 1.0) {
+    m_fman->init_embedded_adaptors(gl, x, y, scale);
+  }
+
+  path_adaptor_type& path_adaptor() { return m_fman->path_adaptor(); }
+  gray8_adaptor_type& gray8_adaptor() { return m_fman->gray8_adaptor(); }
+  gray8_scanline_type& gray8_scanline() { return m_fman->gray8_scanline(); }
+  mono_adaptor_type& mono_adaptor() { return m_fman->mono_adaptor(); }
+  mono_scanline_type& mono_scanline() { return m_fman->mono_scanline(); }
+
+ private:
+  baked_glyph_cache(const baked_glyph_cache&);
+  const baked_glyph_cache& operator=(const baked_glyph_cache&);
+
+  void synchronize() {
+    if (m_change_stamp == m_feng->change_stamp()) return;
+    m_change_stamp = m_feng->change_stamp();
+    m_font = -1;
+    const char* name = m_feng->name();
+    if (name == 0 || !m_file->is_open()) return;
+    typedef typename path_adaptor_type::vertex_integer_type vertex_type;
+    m_font = m_file->find_font(
+        baked_font_signature(m_feng->font_signature(), name),
+        font_hash(name), sizeof(vertex_type));
+  }
+
+  int32u font_hash(const char* name) {
+    for (unsigned i = 0; i < m_hashes.size(); ++i) {
+      if (strcmp(m_hashes[i].name, name) == 0) return m_hashes[i].hash;
+    }
+    hash_entry e;
+    e.name = new char[strlen(name) + 1];
+    strcpy(e.name, name);
+    e.hash = font_file_hash(name);
+    m_hashes.add(e);
+    return e.hash;
+  }
+
+  struct hash_entry {
+    char* name;
+    int32u hash;
+  };
+
+  FontEngine* m_feng;
+  FontCacheManager* m_fman;
+  glyph_file* m_file;
+  int m_change_stamp;
+  int m_font;
+  pod_bvector<hash_entry, 4> m_hashes;
+};
+
+}  // namespace agg
+
+#endif
@@ -0,0 +1,185 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+//
+// See implementation agg_font_layout_cache.cpp
+//
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_LAYOUT_CACHE_INCLUDED
+#define AGG_FONT_LAYOUT_CACHE_INCLUDED
+
+#include "agg_array.h"
+#include "agg_font_text.h"
+
+namespace agg {
+
+//-------------------------------------------------------------text_layout
+// The glyphs of a run with their positions, the bounding box of the
+// glyphs (x1 > x2 when there is nothing to draw) and the pen position
+// following the last glyph, all relative to the origin of the run. The
+// glyph pointers are those of the cache generation they were taken in.
+struct text_layout {
+  positioned_glyph* glyphs;
+  unsigned num_glyphs;
+  unsigned generation;
+  unsigned num_lines;
+  rect_d bounds;
+  double advance_x;
+  double advance_y;
+};
+
+//----------------------------------------------------text_layout_recorder
+// Glyph sink for layout_text() that fills a text_layout. The layout must
+// have room for one glyph per character code.
+class text_layout_recorder {
+ public:
+  text_layout_recorder(text_layout& layout, const text_style& style);
+
+  void add_glyph(const glyph_cache* glyph, unsigned code, double x, double y);
+  void end_line() { ++m_layout->num_lines; }
+
+ private:
+  text_layout* m_layout;
+  trans_affine m_run_mtx;
+};
+
+//-------------------------------------------------------text_layout_cache
+// Cache of laid out runs keyed by font signature, character codes and
+// text_style, so that labels drawn again and again skip the glyph lookups,
+// kerning and advances. When more than max_layouts runs are cached the
+// least recently used one is dropped.
+//
+// The layouts keep the glyph pointers, so that drawing a cached run goes
+// straight to the rasterizer. A hit from another generation of the glyph
+// cache, see glyph_cache_generation(), looks its glyphs up again. The
+// pointers are only as valid as the glyph cache: clear() the layouts
+// after font_cache_manager::reset_cache(), and use no more fonts than
+// the manager keeps caches for (max_fonts).
+//
+class text_layout_cache {
+ public:
+  ~text_layout_cache();
+  explicit text_layout_cache(unsigned max_layouts = 256);
+
+  // Return the layout of the text, laying it out on a miss.
+  //--------------------------------------------------------------------
+  template <class FontEngine, class FontCacheManager, class CharT>
+  const text_layout* layout(FontEngine& feng, FontCacheManager& fman,
+                            const CharT* text, unsigned len,
+                            const text_style& style = text_style()) {
+    m_codes.capacity(len + 1);
+    for (unsigned i = 0; i < len; ++i) {
+      m_codes.add(text_char_code(text[i]));
+    }
+    const char* signature = feng.font_signature();
+    const text_layout* found = find(signature, &m_codes[0], len, style);
+    if (found) {
+      if (found->generation != glyph_cache_generation(fman)) {
+        // The layouts are owned by the cache
+        text_layout* tl = const_cast<text_layout*>(found);
+        tl->generation = glyph_cache_generation(fman);
+        for (unsigned i = 0; i < tl->num_glyphs; ++i) {
+          tl->glyphs[i].glyph = fman.glyph(tl->glyphs[i].code);
+        }
+      }
+      return found;
+    }
+
+    text_layout* tl = add(signature, &m_codes[0], len, style);
+    text_layout_recorder recorder(*tl, style);
+    // Taken before the lookups, which may evict, so that a layout made
+    // across generations is not trusted
+    unsigned generation = glyph_cache_generation(fman);
+    double x = 0.0, y = 0.0;
+    layout_text(feng, fman, &m_codes[0], len, &x, &y, style, recorder);
+    tl->generation = generation;
+    tl->advance_x = x;
+    tl->advance_y = y;
+    return tl;
+  }
+
+  const text_layout* find(const char* signature, const unsigned* codes,
+                          unsigned len, const text_style& style);
+  text_layout* add(const char* signature, const unsigned* codes,
+                   unsigned len, const text_style& style);
+  void clear();
+
+  unsigned size() const { return m_num_layouts; }
+  unsigned byte_size() const { return m_byte_size; }
+  unsigned max_layouts() const { return m_max_layouts; }
+  unsigned hits() const { return m_hits; }
+  unsigned misses() const { return m_misses; }
+
+ private:
+  struct entry;
+
+  text_layout_cache(const text_layout_cache&);
+  const text_layout_cache& operator=(const text_layout_cache&);
+
+  static unsigned calc_hash(const char* signature, const unsigned* codes,
+                            unsigned len, const text_style& style);
+  void unlink(entry* e);
+  void push_front(entry* e);
+  void remove(entry* e);
+
+  entry** m_buckets;
+  unsigned m_num_buckets;
+  entry* m_lru_first;
+  entry* m_lru_last;
+  unsigned m_num_layouts;
+  unsigned m_max_layouts;
+  unsigned m_byte_size;
+  unsigned m_hits;
+  unsigned m_misses;
+  pod_vector<unsigned> m_codes;
+};
+
+//------------------------------------------------------render_text_layout
+// Draw a cached layout with its origin at (x, y), one rasterizer sweep per
+// line. style must be the one the layout was made with. The glyphs kept
+// by the layout are drawn as they are, unless the generation of the
+// glyph cache changed since: they are then looked up by code, the engine
+// set to the font of the layout.
+//
+template <class FontCacheManager, class Rasterizer, class Scanline,
+          class Renderer>
+void render_text_layout(FontCacheManager& fman, Rasterizer& ras,
+                        Scanline& sl, Renderer& ren, const text_layout& tl,
+                        double x, double y,
+                        const text_style& style = text_style()) {
+  text_run_renderer<FontCacheManager, Rasterizer, Scanline, Renderer> run(
+      fman, ras, sl, ren, style);
+  if (tl.generation == glyph_cache_generation(fman)) {
+    layout_glyphs(tl.glyphs, tl.num_glyphs, x, y, run);
+    return;
+  }
+  unsigned line = 0;
+  for (unsigned i = 0; i < tl.num_glyphs; ++i) {
+    const positioned_glyph& pg = tl.glyphs[i];
+    if (pg.line != line) {
+      run.end_line();
+      line = pg.line;
+    }
+    const glyph_cache* glyph = fman.glyph(pg.code);
+    if (glyph) {
+      run.add_glyph(glyph, pg.code, x + pg.x, y + pg.y);
+    }
+  }
+  run.end_line();
+}
+
+}  // namespace agg
+
+#endif
@@ -0,0 +1,135 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_METRICS_INCLUDED
+#define AGG_FONT_METRICS_INCLUDED
+
+#include <string.h>
+
+#include "agg_font_cache_manager.h"
+#include "agg_font_text.h"
+
+namespace agg {
+
+//----------------------------------------------------font_metrics_manager
+// Counterpart of font_cache_manager for text measurement. Glyphs are
+// prepared with FontEngine::prepare_glyph_metrics(), nothing is rendered,
+// and cached as glyph_cache records that carry glyph_index, bounds and
+// advances but no data (data_type is glyph_data_invalid). The fonts are
+// kept in a pool of their own, apart from the rendered glyphs, keyed by
+// the engine's font signature. With advance_only the bounds are not
+// retrieved, which lets FreeType skip loading the outlines.
+//
+// glyph() has the same signature as font_cache_manager::glyph(), so the
+// manager can be used as glyph source for layout_text(), measure_text()
+// and ascii_glyph_table.
+//
+template <class FontEngine>
+class font_metrics_manager {
+ public:
+  typedef FontEngine font_engine_type;
+
+  font_metrics_manager(FontEngine& engine, bool advance_only = false,
+                       unsigned max_fonts = 32)
+      : m_fonts(max_fonts),
+        m_engine(&engine),
+        m_advance_only(advance_only),
+        m_change_stamp(-1) {}
+
+  const glyph_cache* glyph(unsigned glyph_code) {
+    synchronize();
+    const glyph_cache* gl = m_fonts.find_glyph(glyph_code);
+    if (gl) return gl;
+    if (m_engine->prepare_glyph_metrics(glyph_code, m_advance_only)) {
+      return m_fonts.cache_glyph(glyph_code, m_engine->glyph_index(), 0,
+                                 glyph_data_invalid, m_engine->bounds(),
+                                 m_engine->advance_x(), m_engine->advance_y());
+    }
+    return 0;
+  }
+
+  void reset_cache() {
+    m_fonts.font(m_engine->font_signature(), true);
+    m_change_stamp = m_engine->change_stamp();
+  }
+
+  bool advance_only() const { return m_advance_only; }
+
+ private:
+  font_metrics_manager(const font_metrics_manager&);
+  const font_metrics_manager& operator=(const font_metrics_manager&);
+
+  void synchronize() {
+    if (m_change_stamp != m_engine->change_stamp()) {
+      m_fonts.font(m_engine->font_signature());
+      m_change_stamp = m_engine->change_stamp();
+    }
+  }
+
+  font_cache_pool m_fonts;
+  FontEngine* m_engine;
+  bool m_advance_only;
+  int m_change_stamp;
+};
+
+//---------------------------------------------------------text_width_sink
+// layout_text() sink that records the extent of the widest line, from
+// the start of the line to the end of the advance of its last glyph.
+//
+class text_width_sink {
+ public:
+  text_width_sink(double start_x, double width)
+      : m_start_x(start_x), m_scale(width), m_width(0.0) {}
+
+  void add_glyph(const glyph_cache* glyph, unsigned, double x, double) {
+    double w = x + glyph->advance_x * m_scale - m_start_x;
+    if (w > m_width) m_width = w;
+  }
+
+  void end_line() {}
+
+  double width() const { return m_width; }
+
+ private:
+  double m_start_x;
+  double m_scale;
+  double m_width;
+};
+
+//------------------------------------------------------------measure_text
+// Width of len character codes laid out as by render_text(), using the
+// advances and kerning of the glyphs from glyphs.glyph(code). With
+// multiple lines the width of the widest one is returned. Pass a
+// font_metrics_manager as glyph source to measure without rasterizing.
+//
+template <class FontEngine, class GlyphSource, class CharT>
+double measure_text(FontEngine& feng, GlyphSource& glyphs, const CharT* text,
+                    unsigned len, const text_style& style = text_style()) {
+  double x = 0.0, y = 0.0;
+  text_width_sink sink(0.0, style.width);
+  layout_text(feng, glyphs, text, len, &x, &y, style, sink);
+  return sink.width();
+}
+
+//------------------------------------------------------------------------
+template <class FontEngine, class GlyphSource>
+double measure_text(FontEngine& feng, GlyphSource& glyphs, const char* text,
+                    const text_style& style = text_style()) {
+  return measure_text(feng, glyphs, text, unsigned(strlen(text)), style);
+}
+
+}  // namespace agg
+
+#endif
@@ -0,0 +1,165 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_OUTLINE_UNITS_INCLUDED
+#define AGG_FONT_OUTLINE_UNITS_INCLUDED
+
+#include <string.h>
+
+#include "agg_basics.h"
+#include "agg_conv_curve.h"
+#include "agg_conv_transform.h"
+#include "agg_font_cache_manager.h"
+#include "agg_font_sdf.h"
+#include "agg_font_text.h"
+#include "agg_trans_affine.h"
+
+namespace agg {
+
+//------------------------------------------------------------------------
+// Rendering mode of font_engine_freetype_base caching unhinted outlines
+// in font units. The font signature leaves out the size, the hinting and
+// the transformation, so one cached outline serves every size and
+// transformation of the face, which render_text_units() applies when
+// drawing. Like glyph_ren_sdf it follows the last value of AGG's
+// glyph_rendering.
+const glyph_rendering glyph_ren_outline_units =
+    glyph_rendering(glyph_ren_sdf + 1);
+
+// The outlines are stored as 26.6 values of the font units, their path
+// adaptor is initialized with this scale to read back font units.
+const double outline_units_scale = 64.0;
+
+//------------------------------------------------------units_run_renderer
+// Glyph sink for layout_text() drawing outlines cached in font units.
+// Pen positions are in font units too and each glyph is mapped to pixels
+// by the run transformation of the style, its pen position and mtx, the
+// engine's units_matrix() followed by its transform() and the origin of
+// the text. The outlines of a line are rendered in a single sweep.
+//
+template <class FontCacheManager, class Rasterizer, class Scanline,
+          class Renderer>
+class units_run_renderer {
+ public:
+  typedef typename FontCacheManager::path_adaptor_type path_adaptor_type;
+  typedef conv_curve<path_adaptor_type> curve_type;
+
+  units_run_renderer(FontCacheManager& fman, Rasterizer& ras, Scanline& sl,
+                     Renderer& ren, const trans_affine& mtx,
+                     const text_style& style)
+      : m_fman(&fman),
+        m_ras(&ras),
+        m_sl(&sl),
+        m_ren(&ren),
+        m_units_mtx(mtx),
+        m_run_mtx(style.width, 0.0, style.slant, 1.0, 0.0, 0.0),
+        m_curves(fman.path_adaptor()),
+        m_trans(m_curves, m_mtx),
+        m_pending(false) {
+    m_ras->reset();
+  }
+
+  void add_glyph(const glyph_cache* glyph, unsigned, double x, double y) {
+    if (glyph->data_type != glyph_data_outline) return;
+    m_fman->path_adaptor().init(glyph->data, glyph->data_size, 0, 0,
+                                outline_units_scale);
+    m_mtx = m_run_mtx;
+    m_mtx *= trans_affine_translation(x, y);
+    m_mtx *= m_units_mtx;
+    m_ras->add_path(m_trans);
+    m_pending = true;
+  }
+
+  void end_line() {
+    if (m_pending) {
+      render_scanlines(*m_ras, *m_sl, *m_ren);
+      m_ras->reset();
+      m_pending = false;
+    }
+  }
+
+ private:
+  units_run_renderer(const units_run_renderer&);
+  const units_run_renderer& operator=(const units_run_renderer&);
+
+  FontCacheManager* m_fman;
+  Rasterizer* m_ras;
+  Scanline* m_sl;
+  Renderer* m_ren;
+  trans_affine m_units_mtx;
+  trans_affine m_run_mtx;
+  trans_affine m_mtx;
+  curve_type m_curves;
+  conv_transform<curve_type> m_trans;
+  bool m_pending;
+};
+
+//-------------------------------------------------------render_text_units
+// render_text() for an engine in glyph_ren_outline_units mode. The text
+// is laid out in font units, then scaled to the engine's height() and
+// width() and transformed by its transform() about the pen position
+// (*x, *y), which is updated like by render_text(). Changing the size or
+// the transformation only changes this mapping, the cached outlines are
+// reused. interval and line_height of the style are in pixels and
+// snap_baseline is ignored. Engines in other modes, such as a bitmap
+// face that fell back to glyph_ren_native_gray8, go to render_text().
+//
+template <class FontEngine, class FontCacheManager, class Rasterizer,
+          class Scanline, class Renderer, class CharT>
+void render_text_units(FontEngine& feng, FontCacheManager& fman,
+                       Rasterizer& ras, Scanline& sl, Renderer& ren,
+                       const CharT* text, unsigned len, double* x, double* y,
+                       const text_style& style = text_style()) {
+  if (feng.rendering() != glyph_ren_outline_units) {
+    render_text(feng, fman, ras, sl, ren, text, len, x, y, style);
+    return;
+  }
+  trans_affine size_mtx = feng.units_matrix();
+  if (size_mtx.sx == 0.0 || size_mtx.sy == 0.0) return;
+
+  text_style units = style;
+  units.interval = style.interval / size_mtx.sx;
+  units.line_height = (style.line_height != 0.0 ? style.line_height
+                                                : 1.25 * feng.height()) /
+                      size_mtx.sy;
+  units.snap_baseline = false;
+
+  trans_affine mtx = size_mtx;
+  mtx *= feng.transform();
+  mtx *= trans_affine_translation(*x, *y);
+
+  units_run_renderer<FontCacheManager, Rasterizer, Scanline, Renderer> run(
+      fman, ras, sl, ren, mtx, units);
+  double ux = 0.0, uy = 0.0;
+  layout_text(feng, fman, text, len, &ux, &uy, units, run);
+  mtx.transform(&ux, &uy);
+  *x = ux;
+  *y = uy;
+}
+
+//------------------------------------------------------------------------
+template <class FontEngine, class FontCacheManager, class Rasterizer,
+          class Scanline, class Renderer>
+void render_text_units(FontEngine& feng, FontCacheManager& fman,
+                       Rasterizer& ras, Scanline& sl, Renderer& ren,
+                       const char* text, double* x, double* y,
+                       const text_style& style = text_style()) {
+  render_text_units(feng, fman, ras, sl, ren, text, unsigned(strlen(text)),
+                    x, y, style);
+}
+
+}  // namespace agg
+
+#endif
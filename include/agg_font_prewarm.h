@@ -0,0 +1,177 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+//
+// See implementation agg_font_prewarm.cpp
+//
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_PREWARM_INCLUDED
+#define AGG_FONT_PREWARM_INCLUDED
+
+#include "agg_array.h"
+#include "agg_font_freetype.h"
+
+namespace agg {
+
+//---------------------------------------------------font_prewarm_charset_e
+enum font_prewarm_charset_e {
+  prewarm_ascii,   // Printable ASCII, 32 to 126
+  prewarm_digits,  // Digits, signs and separators for numbers
+  prewarm_latin1,  // Printable ASCII and Latin-1, 160 to 255
+  prewarm_codes    // The codes of the request
+};
+
+//-----------------------------------------------------font_prewarm_request
+// Font, size and rendering mode of a prewarm job, set as they would be on
+// a font engine, and the character codes to prepare. The glyph set of
+// the job has the signature of an engine set up the same way, with the
+// gray levels of gamma_power(gamma), or no gamma when gamma is 1, unless
+// use_gamma_table is set. match() copies all of it from an engine.
+//
+// The font name and the codes are copied, a font in memory must stay
+// valid until the job is done.
+//
+struct font_prewarm_request {
+  const char* font_name;
+  unsigned face_index;
+  const char* font_mem;
+  long font_mem_size;
+  glyph_rendering rendering;
+  unsigned resolution;
+  double height;
+  double width;
+  font_hinting_e hinting;
+  double embolden;
+  double oblique;
+  double stroke_width;
+  line_join_e stroke_join;
+  double stroke_miter_limit;
+  double axes[font_axis::max_axes];  // Instance of a variable font
+  unsigned num_axes;
+  bool flip_y;
+  trans_affine transform;
+  double gamma;
+  bool use_gamma_table;
+  int8u gamma_table[256];
+  font_prewarm_charset_e charset;
+  const unsigned* codes;
+  unsigned num_codes;
+
+  font_prewarm_request()
+      : font_name(0),
+        face_index(0),
+        font_mem(0),
+        font_mem_size(0),
+        rendering(glyph_ren_agg_gray8),
+        resolution(0),
+        height(0.0),
+        width(0.0),
+        hinting(font_hinting_autohint),
+        embolden(0.0),
+        oblique(0.0),
+        stroke_width(0.0),
+        stroke_join(round_join),
+        stroke_miter_limit(4.0),
+        num_axes(0),
+        flip_y(false),
+        gamma(1.0),
+        use_gamma_table(false),
+        charset(prewarm_ascii),
+        codes(0),
+        num_codes(0) {}
+
+  // Take the font and its parameters from the engine. The font name is
+  // not copied and a font loaded from memory needs font_mem as well.
+  void match(const font_engine_freetype_base& feng);
+};
+
+//----------------------------------------------------------font_glyph_set
+// Glyphs of one font signature prepared away from the font cache, ready
+// to be added to it with add_glyphs() of arena_font_cache_manager or
+// budget_font_cache_manager.
+//
+class font_glyph_set {
+ public:
+  font_glyph_set();
+  ~font_glyph_set();
+
+  void signature(const char* font_signature);
+  const char* signature() const { return m_signature ? m_signature : ""; }
+
+  // Add the glyph last prepared by the engine
+  void add(const font_engine_freetype_base& feng, unsigned glyph_code);
+  void clear();
+
+  unsigned size() const { return m_glyphs.size(); }
+  unsigned code(unsigned i) const { return m_codes[i]; }
+  const glyph_cache& glyph(unsigned i) const { return m_glyphs[i]; }
+
+ private:
+  font_glyph_set(const font_glyph_set&);
+  const font_glyph_set& operator=(const font_glyph_set&);
+
+  char* m_signature;
+  pod_bvector<unsigned, 8> m_codes;
+  pod_bvector<glyph_cache, 8> m_glyphs;
+  block_allocator m_data;
+};
+
+struct prewarm_queue;
+
+//------------------------------------------------------------------------
+// Called on a worker thread once a job is done, successfully or not
+typedef void (*font_prewarm_callback)(void* data, int job);
+
+//----------------------------------------------------------font_prewarmer
+// Prepares the glyphs of prewarm requests on background threads, each
+// with a font engine of its own, while the application keeps drawing
+// with its engine. submit() returns a job id, done() and wait() tell when
+// the glyph set of the job is ready to be added to a cache, from the
+// thread owning the cache. release() frees the job, at once or when it
+// is done, and its id is reused by later jobs.
+//
+// Without thread support, or if no thread can be started, jobs are run
+// by submit() itself.
+//
+class font_prewarmer {
+ public:
+  ~font_prewarmer();
+  explicit font_prewarmer(bool flag32 = true, unsigned num_threads = 1);
+
+  int submit(const font_prewarm_request& req);
+
+  bool done(int job) const;
+  // Wait for a job, returns false if its font could not be loaded
+  bool wait(int job);
+  void wait_all();
+
+  // Glyphs of a finished job, 0 while the job runs or if it failed
+  const font_glyph_set* glyphs(int job) const;
+  // Free a job and its glyphs, the id must not be used after this
+  void release(int job);
+
+  void completion_callback(font_prewarm_callback cb, void* data);
+  unsigned num_threads() const;
+
+ private:
+  font_prewarmer(const font_prewarmer&);
+  const font_prewarmer& operator=(const font_prewarmer&);
+
+  prewarm_queue* m_queue;
+};
+
+}  // namespace agg
+
+#endif
@@ -0,0 +1,241 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+//
+// See implementation agg_font_sdf.cpp
+//
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_SDF_INCLUDED
+#define AGG_FONT_SDF_INCLUDED
+
+#include <math.h>
+
+#include "agg_array.h"
+#include "agg_basics.h"
+#include "agg_font_cache_manager.h"
+#include "agg_font_text.h"
+
+namespace agg {
+
+//------------------------------------------------------------------------
+// Rendering mode of font_engine_freetype_base caching glyphs as signed
+// distance fields at a reference size, see font_engine_freetype_base::
+// sdf_size(). AGG's glyph_rendering has no such value, glyph_ren_sdf
+// follows its last one. The fields are cached as glyph_data_invalid,
+// which the other renderers skip, and drawn by render_text_sdf().
+const glyph_rendering glyph_ren_sdf =
+    glyph_rendering(glyph_ren_agg_gray8 + 1);
+
+//----------------------------------------------------------distance_field
+// Signed distance field of a polygon given as closed contours, with the
+// nonzero fill rule of font outlines. build() fills one byte per pixel:
+// 255 at spread pixels or more inside, 0 at spread pixels or more
+// outside, the outline passing between 127 and 128.
+//
+class distance_field {
+ public:
+  distance_field() { reset(); }
+
+  void reset();
+  void move_to(double x, double y);
+  void line_to(double x, double y);
+  void close_polygon();
+
+  template <class VertexSource>
+  void add_path(VertexSource& vs, unsigned path_id = 0) {
+    double x, y;
+    unsigned cmd;
+    vs.rewind(path_id);
+    while (!is_stop(cmd = vs.vertex(&x, &y))) {
+      if (is_move_to(cmd)) {
+        move_to(x, y);
+      } else if (is_vertex(cmd)) {
+        line_to(x, y);
+      } else if (is_end_poly(cmd)) {
+        close_polygon();
+      }
+    }
+    close_polygon();
+  }
+
+  // Pixels covered by the contours grown by spread, x1 > x2 when empty
+  rect_i bounds(double spread) const;
+  // Fill the (x2 - x1) * (y2 - y1) bytes of the field, row by row
+  void build(int8u* data, const rect_i& bounds, double spread);
+
+ private:
+  struct edge {
+    double x1, y1, x2, y2;
+  };
+  struct crossing {
+    double x;
+    int dir;
+  };
+
+  pod_bvector<edge> m_edges;
+  pod_vector<double> m_dist;
+  pod_vector<crossing> m_crossings;
+  double m_start_x, m_start_y;
+  double m_last_x, m_last_y;
+  bool m_open;
+  rect_d m_box;
+};
+
+//------------------------------------------------------------------------
+// Value of a distance field byte as a distance in units of spread,
+// positive inside
+inline double sdf_distance(unsigned v) { return v / 127.5 - 1.0; }
+
+//--------------------------------------------------------sdf_run_renderer
+// Glyph sink for layout_text() drawing distance field glyphs scaled from
+// their reference size by scale, through the run transformation of the
+// style. Each pixel gets the coverage of the outline found by sampling
+// the field, antialiased over one pixel, and is passed to the renderer
+// in a scanline, so any AGG scanline renderer can be used.
+//
+template <class Scanline, class Renderer>
+class sdf_run_renderer {
+ public:
+  sdf_run_renderer(Scanline& sl, Renderer& ren, double scale, double spread,
+                   const text_style& style)
+      : m_sl(&sl),
+        m_ren(&ren),
+        m_scale(scale),
+        m_spread(spread),
+        m_width(style.width),
+        m_slant(style.slant),
+        m_snap_baseline(style.snap_baseline) {
+    m_ren->prepare();
+  }
+
+  void add_glyph(const glyph_cache* glyph, unsigned, double x, double y) {
+    if (glyph->data_type != glyph_data_invalid || glyph->data_size == 0) {
+      return;
+    }
+    if (m_snap_baseline) y = floor(y + 0.5);
+
+    const rect_i& b = glyph->bounds;
+    int fw = b.x2 - b.x1;
+    int fh = b.y2 - b.y1;
+    if (fw <= 0 || fh <= 0 || unsigned(fw * fh) > glyph->data_size) return;
+
+    // Pixel box of the field corners through scale, width and slant
+    double sx = m_scale * m_width;
+    double gy1 = b.y1 * m_scale, gy2 = b.y2 * m_scale;
+    double xa = x + b.x1 * sx + m_slant * gy1;
+    double xb = x + b.x2 * sx + m_slant * gy1;
+    double xc = x + b.x1 * sx + m_slant * gy2;
+    double xd = x + b.x2 * sx + m_slant * gy2;
+    int px1 = int(floor(sdf_min(sdf_min(xa, xb), sdf_min(xc, xd))));
+    int px2 = int(ceil(sdf_max(sdf_max(xa, xb), sdf_max(xc, xd))));
+    int py1 = int(floor(y + gy1));
+    int py2 = int(ceil(y + gy2));
+
+    // One unit of the field is spread pixels at the reference size
+    double aa = m_spread * m_scale * (m_width < 1.0 ? m_width : 1.0);
+    m_sl->reset(px1, px2);
+    for (int py = py1; py < py2; ++py) {
+      m_sl->reset_spans();
+      double gy = (py + 0.5 - y) / m_scale;
+      double v = gy - b.y1 - 0.5;
+      for (int px = px1; px < px2; ++px) {
+        double gx = ((px + 0.5 - x) - m_slant * gy * m_scale) / sx;
+        double d = sample(glyph->data, fw, fh, gx - b.x1 - 0.5, v) * aa;
+        if (d > -0.5) {
+          unsigned cover = d >= 0.5 ? unsigned(cover_full)
+                                    : uround((d + 0.5) * cover_full);
+          if (cover) m_sl->add_cell(px, cover);
+        }
+      }
+      if (m_sl->num_spans()) {
+        m_sl->finalize(py);
+        m_ren->render(*m_sl);
+      }
+    }
+  }
+
+  void end_line() {}
+
+ private:
+  sdf_run_renderer(const sdf_run_renderer&);
+  const sdf_run_renderer& operator=(const sdf_run_renderer&);
+
+  static double sdf_min(double a, double b) { return a < b ? a : b; }
+  static double sdf_max(double a, double b) { return a > b ? a : b; }
+
+  // Bilinear sample at field coordinates, outside the field is outside
+  // the glyph
+  static double sample(const int8u* data, int fw, int fh, double u,
+                       double v) {
+    int iu = int(floor(u));
+    int iv = int(floor(v));
+    double fu = u - iu;
+    double fv = v - iv;
+    double v00 = texel(data, fw, fh, iu, iv);
+    double v10 = texel(data, fw, fh, iu + 1, iv);
+    double v01 = texel(data, fw, fh, iu, iv + 1);
+    double v11 = texel(data, fw, fh, iu + 1, iv + 1);
+    double top = v00 + (v10 - v00) * fu;
+    double bottom = v01 + (v11 - v01) * fu;
+    return top + (bottom - top) * fv;
+  }
+
+  static double texel(const int8u* data, int fw, int fh, int u, int v) {
+    if (u < 0 || v < 0 || u >= fw || v >= fh) return -1.0;
+    return sdf_distance(data[v * fw + u]);
+  }
+
+  Scanline* m_sl;
+  Renderer* m_ren;
+  double m_scale;
+  double m_spread;
+  double m_width;
+  double m_slant;
+  bool m_snap_baseline;
+};
+
+//---------------------------------------------------------render_text_sdf
+// render_text() for an engine in glyph_ren_sdf mode: the glyphs cached
+// at sdf_height() are drawn at the height() of the engine, so changing
+// the height does not change the font signature nor the cache.
+//
+template <class FontEngine, class FontCacheManager, class Scanline,
+          class Renderer, class CharT>
+void render_text_sdf(FontEngine& feng, FontCacheManager& fman, Scanline& sl,
+                     Renderer& ren, const CharT* text, unsigned len,
+                     double* x, double* y,
+                     const text_style& style = text_style()) {
+  double scale = feng.height() / feng.sdf_height();
+  sdf_run_renderer<Scanline, Renderer> run(sl, ren, scale, feng.sdf_spread(),
+                                           style);
+  // The advances and kerning are those of the reference size
+  text_style scaled = style;
+  scaled.width *= scale;
+  layout_text(feng, fman, text, len, x, y, scaled, run);
+}
+
+//------------------------------------------------------------------------
+template <class FontEngine, class FontCacheManager, class Scanline,
+          class Renderer>
+void render_text_sdf(FontEngine& feng, FontCacheManager& fman, Scanline& sl,
+                     Renderer& ren, const char* text, double* x, double* y,
+                     const text_style& style = text_style()) {
+  render_text_sdf(feng, fman, sl, ren, text, unsigned(strlen(text)), x, y,
+                  style);
+}
+
+}  // namespace agg
+
+#endif
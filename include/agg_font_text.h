@@ -0,0 +1,297 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_TEXT_INCLUDED
+#define AGG_FONT_TEXT_INCLUDED
+
+#include <math.h>
+#include <string.h>
+
+#include "agg_conv_curve.h"
+#include "agg_conv_transform.h"
+#include "agg_font_cache_manager.h"
+#include "agg_renderer_scanline.h"
+#include "agg_trans_affine.h"
+
+namespace agg {
+
+//--------------------------------------------------------------text_style
+// Parameters applied to a whole run by render_text(). width scales glyphs
+// and advances horizontally, slant shears x by slant * y (faux italic) and
+// interval is added to the advance of every glyph. Lines are line_height
+// apart, zero means 1.25 times the font height. With snap_baseline the
+// baseline is rounded to whole pixels, which goes along with hinting.
+//
+// width and slant transform the outlines only: gray8 glyphs are bitmaps
+// drawn as cached, only their advances are scaled by width. Use an
+// outline rendering mode for LCD text (width 3) or faux italic.
+//
+struct text_style {
+  double width;
+  double slant;
+  double interval;
+  double line_height;
+  bool kerning;
+  bool snap_baseline;
+
+  text_style()
+      : width(1.0),
+        slant(0.0),
+        interval(0.0),
+        line_height(0.0),
+        kerning(true),
+        snap_baseline(false) {}
+};
+
+//-------------------------------------------------glyph_cache_generation
+// Number that changes whenever a glyph cache drops glyphs by itself, so
+// that tables holding glyph pointers know to refill. font_cache_manager
+// keeps its glyphs until reset_cache(), caches that evict overload this.
+template <class FontCacheManager>
+inline unsigned glyph_cache_generation(const FontCacheManager&) {
+  return 0;
+}
+
+//--------------------------------------------------------positioned_glyph
+// A glyph already looked up, at its position relative to the origin of a
+// run, as kept by text_layout_cache or given by a shaper. code is only
+// passed on to the glyph sink, lines start at zero.
+struct positioned_glyph {
+  const glyph_cache* glyph;
+  unsigned code;
+  unsigned glyph_index;
+  unsigned line;
+  double x;
+  double y;
+};
+
+//------------------------------------------------------------------------
+// Character code of a text element: bytes are taken as unsigned, any
+// other integer type (wchar_t, int, int32u...) as is
+template <class CharT>
+inline unsigned text_char_code(CharT c) { return unsigned(c); }
+inline unsigned text_char_code(char c) { return (unsigned char)c; }
+inline unsigned text_char_code(signed char c) { return (unsigned char)c; }
+
+//-------------------------------------------------------text_run_renderer
+// Draws glyphs at given pen positions. The outlines are accumulated in the
+// rasterizer and rendered with a single sweep by end_line(). Glyphs cached
+// as gray8 scanlines are rendered one by one, without the width and
+// slant of the style. Mono glyphs need a binary renderer and are skipped,
+// as are the other types of data; num_skipped() counts them.
+//
+template <class FontCacheManager, class Rasterizer, class Scanline,
+          class Renderer>
+class text_run_renderer {
+ public:
+  typedef typename FontCacheManager::path_adaptor_type path_adaptor_type;
+  typedef conv_curve<path_adaptor_type> curve_type;
+
+  text_run_renderer(FontCacheManager& fman, Rasterizer& ras, Scanline& sl,
+                    Renderer& ren, const text_style& style)
+      : m_fman(&fman),
+        m_ras(&ras),
+        m_sl(&sl),
+        m_ren(&ren),
+        m_snap_baseline(style.snap_baseline),
+        m_run_mtx(style.width, 0.0, style.slant, 1.0, 0.0, 0.0),
+        m_curves(fman.path_adaptor()),
+        m_trans(m_curves, m_mtx),
+        m_pending(false),
+        m_num_skipped(0) {
+    m_ras->reset();
+  }
+
+  void add_glyph(const glyph_cache* glyph, unsigned, double x, double y) {
+    if (m_snap_baseline) y = floor(y + 0.5);
+    switch (glyph->data_type) {
+      case glyph_data_outline:
+        m_fman->init_embedded_adaptors(glyph, 0, 0);
+        m_mtx = m_run_mtx;
+        m_mtx *= trans_affine_translation(x, y);
+        m_ras->add_path(m_trans);
+        m_pending = true;
+        break;
+
+      case glyph_data_gray8:
+        m_fman->init_embedded_adaptors(glyph, x, y);
+        render_scanlines(m_fman->gray8_adaptor(), m_fman->gray8_scanline(),
+                         *m_ren);
+        break;
+
+      default:
+        ++m_num_skipped;
+        break;
+    }
+  }
+
+  unsigned num_skipped() const { return m_num_skipped; }
+
+  void end_line() {
+    if (m_pending) {
+      render_scanlines(*m_ras, *m_sl, *m_ren);
+      m_ras->reset();
+      m_pending = false;
+    }
+  }
+
+ private:
+  text_run_renderer(const text_run_renderer&);
+  const text_run_renderer& operator=(const text_run_renderer&);
+
+  FontCacheManager* m_fman;
+  Rasterizer* m_ras;
+  Scanline* m_sl;
+  Renderer* m_ren;
+  bool m_snap_baseline;
+  trans_affine m_run_mtx;
+  trans_affine m_mtx;
+  curve_type m_curves;
+  conv_transform<curve_type> m_trans;
+  bool m_pending;
+  unsigned m_num_skipped;
+};
+
+//-------------------------------------------------------------layout_text
+// Walk len character codes starting from the pen position (*x, *y),
+// applying kerning, advances and the text_style spacing. Each glyph is
+// passed with its pen position to sink.add_glyph(glyph, code, x, y) and
+// sink.end_line() is called at every '\n' and at the end of the text.
+// The pen position is updated to the position following the last glyph.
+//
+// Glyphs are taken from glyphs.glyph(code), which is either the
+// font_cache_manager itself or a lookup table on top of it such as
+// ascii_glyph_table. A glyph is not used after the next lookup, so caches
+// may drop glyphs as they go.
+//
+template <class FontEngine, class GlyphSource, class CharT, class GlyphSink>
+void layout_text(FontEngine& feng, GlyphSource& glyphs, const CharT* text,
+                 unsigned len, double* x, double* y, const text_style& style,
+                 GlyphSink& sink) {
+  double line_step =
+      style.line_height != 0.0 ? style.line_height : 1.25 * feng.height();
+  if (!feng.flip_y()) line_step = -line_step;
+
+  double start_x = *x;
+  double pen_x = *x;
+  double pen_y = *y;
+  unsigned prev_index = 0;
+  bool has_prev = false;
+
+  for (unsigned i = 0; i < len; ++i) {
+    unsigned code = text_char_code(text[i]);
+    if (code == '\n') {
+      sink.end_line();
+      pen_x = start_x;
+      pen_y += line_step;
+      has_prev = false;
+      continue;
+    }
+
+    const glyph_cache* glyph = glyphs.glyph(code);
+    if (glyph == 0) continue;
+
+    if (style.kerning && has_prev) {
+      double dx = 0.0, dy = 0.0;
+      if (feng.add_kerning(prev_index, glyph->glyph_index, &dx, &dy)) {
+        pen_x += dx * style.width;
+        pen_y += dy;
+      }
+    }
+    prev_index = glyph->glyph_index;
+    has_prev = true;
+
+    sink.add_glyph(glyph, code, pen_x, pen_y);
+
+    pen_x += glyph->advance_x * style.width + style.interval;
+    pen_y += glyph->advance_y;
+  }
+  sink.end_line();
+
+  *x = pen_x;
+  *y = pen_y;
+}
+
+//-----------------------------------------------------------layout_glyphs
+// Pass num positioned glyphs to sink.add_glyph() with the origin of the
+// run at (x, y). sink.end_line() is called when the line changes and at
+// the end. The positions are final: no kerning, advance or text_style
+// spacing is applied. The glyph pointers must still be valid, see
+// glyph_cache_generation().
+//
+template <class GlyphSink>
+void layout_glyphs(const positioned_glyph* glyphs, unsigned num, double x,
+                   double y, GlyphSink& sink) {
+  unsigned line = 0;
+  for (unsigned i = 0; i < num; ++i) {
+    const positioned_glyph& pg = glyphs[i];
+    if (pg.line != line) {
+      sink.end_line();
+      line = pg.line;
+    }
+    if (pg.glyph) sink.add_glyph(pg.glyph, pg.code, x + pg.x, y + pg.y);
+  }
+  sink.end_line();
+}
+
+//-------------------------------------------------------------render_text
+// Render len character codes starting from the pen position (*x, *y),
+// which is updated to the position following the last glyph. A '\n'
+// moves the pen to the start of the next line. The outlines of all the
+// glyphs of a line are rendered with a single rasterizer sweep. Mono
+// glyphs are skipped, layout_text() with a text_run_renderer tells how
+// many with num_skipped().
+//
+template <class FontEngine, class FontCacheManager, class Rasterizer,
+          class Scanline, class Renderer, class CharT>
+void render_text(FontEngine& feng, FontCacheManager& fman, Rasterizer& ras,
+                 Scanline& sl, Renderer& ren, const CharT* text, unsigned len,
+                 double* x, double* y,
+                 const text_style& style = text_style()) {
+  text_run_renderer<FontCacheManager, Rasterizer, Scanline, Renderer> run(
+      fman, ras, sl, ren, style);
+  layout_text(feng, fman, text, len, x, y, style, run);
+}
+
+//------------------------------------------------------------------------
+template <class FontEngine, class FontCacheManager, class Rasterizer,
+          class Scanline, class Renderer>
+void render_text(FontEngine& feng, FontCacheManager& fman, Rasterizer& ras,
+                 Scanline& sl, Renderer& ren, const char* text, double* x,
+                 double* y, const text_style& style = text_style()) {
+  render_text(feng, fman, ras, sl, ren, text, unsigned(strlen(text)), x, y,
+              style);
+}
+
+//-----------------------------------------------------------render_glyphs
+// Render num glyphs looked up and positioned by the caller, for instance
+// from the glyph indices and offsets of a shaper, with the origin of the
+// run at (x, y). The width and slant of the style transform the outlines
+// as in render_text(), one rasterizer sweep is done per line.
+//
+template <class FontCacheManager, class Rasterizer, class Scanline,
+          class Renderer>
+void render_glyphs(FontCacheManager& fman, Rasterizer& ras, Scanline& sl,
+                   Renderer& ren, const positioned_glyph* glyphs,
+                   unsigned num, double x, double y,
+                   const text_style& style = text_style()) {
+  text_run_renderer<FontCacheManager, Rasterizer, Scanline, Renderer> run(
+      fman, ras, sl, ren, style);
+  layout_glyphs(glyphs, num, x, y, run);
+}
+
+}  // namespace agg
+
+#endif
@@ -0,0 +1,270 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_UTF8_INCLUDED
+#define AGG_FONT_UTF8_INCLUDED
+
+#include <string.h>
+
+#include "agg_array.h"
+#include "agg_font_metrics.h"
+#include "agg_font_text.h"
+
+#if !defined(AGG_FONT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define AGG_FONT_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace agg {
+
+//----------------------------------------------------------utf8_is_ascii
+// True if the text has no byte above 0x7F. Scans 16 bytes at a time.
+inline bool utf8_is_ascii(const char* text, unsigned len) {
+  const unsigned char* p = (const unsigned char*)text;
+  unsigned i = 0;
+#ifdef AGG_FONT_USE_SSE2
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+    if (_mm_movemask_epi8(v)) return false;
+  }
+#endif
+  for (; i + 4 <= len; i += 4) {
+    unsigned w;
+    memcpy(&w, p + i, 4);
+    if (w & 0x80808080u) return false;
+  }
+  for (; i < len; ++i) {
+    if (p[i] & 0x80) return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------utf8_decode
+// Decode len bytes of UTF-8 into codes, which must have room for len
+// values, and return the number of code points. Malformed sequences,
+// overlong forms and surrogates decode as U+FFFD.
+inline unsigned utf8_decode(const char* text, unsigned len, unsigned* codes) {
+  const unsigned char* p = (const unsigned char*)text;
+  const unsigned char* end = p + len;
+  unsigned n = 0;
+  while (p < end) {
+    unsigned c = *p++;
+    if (c < 0x80) {
+      codes[n++] = c;
+      continue;
+    }
+
+    unsigned extra, min;
+    if ((c & 0xE0) == 0xC0) {
+      extra = 1;
+      min = 0x80;
+      c &= 0x1F;
+    } else if ((c & 0xF0) == 0xE0) {
+      extra = 2;
+      min = 0x800;
+      c &= 0x0F;
+    } else if ((c & 0xF8) == 0xF0) {
+      extra = 3;
+      min = 0x10000;
+      c &= 0x07;
+    } else {
+      codes[n++] = 0xFFFD;
+      continue;
+    }
+
+    unsigned k = 0;
+    for (; k < extra && p < end && (*p & 0xC0) == 0x80; ++k) {
+      c = (c << 6) | (*p++ & 0x3F);
+    }
+    if (k < extra || c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+      c = 0xFFFD;
+    }
+    codes[n++] = c;
+  }
+  return n;
+}
+
+//------------------------------------------------------ascii_glyph_table
+// Direct-indexed tables of the glyphs of the 128 ASCII codes, one per
+// font signature for the last max_fonts fonts used, filled on demand from
+// the font_cache_manager. Other codes are passed through to the manager.
+// Switching the engine between fonts switches tables, so text alternating
+// between a few fonts does not refill them. All the tables are cleared
+// when the cache generation changes; call reset() after
+// font_cache_manager::reset_cache() as the cached glyphs are dropped.
+// The manager must keep the caches of the fonts in use, as it does with
+// no more fonts than its own max_fonts.
+//
+// The table is meant to live as long as the manager, next to it: the
+// render and measure functions below take it instead of the manager.
+//
+template <class FontEngine, class FontCacheManager>
+class ascii_glyph_table {
+ public:
+  typedef FontEngine font_engine_type;
+  typedef FontCacheManager font_cache_manager_type;
+  enum { max_fonts = 8 };
+
+  ~ascii_glyph_table() { reset(); }
+
+  ascii_glyph_table(FontEngine& feng, FontCacheManager& fman)
+      : m_feng(&feng),
+        m_fman(&fman),
+        m_change_stamp(-1),
+        m_generation(0),
+        m_num_tables(0),
+        m_cur(0),
+        m_clock(0) {
+    reset();
+  }
+
+  void reset() {
+    for (unsigned i = 0; i < m_num_tables; ++i) {
+      delete[] m_tables[i].signature;
+    }
+    m_num_tables = 0;
+    m_cur = 0;
+    m_change_stamp = -1;
+    m_generation = glyph_cache_generation(*m_fman);
+  }
+
+  const glyph_cache* glyph(unsigned code) {
+    if (m_generation != glyph_cache_generation(*m_fman)) reset();
+    if (m_change_stamp != m_feng->change_stamp()) select_font();
+    if (code < 128) {
+      const glyph_cache* gl = m_cur->glyphs[code];
+      if (gl == 0) gl = m_cur->glyphs[code] = m_fman->glyph(code);
+      return gl;
+    }
+    return m_fman->glyph(code);
+  }
+
+  FontEngine& engine() { return *m_feng; }
+  FontCacheManager& cache() { return *m_fman; }
+  unsigned num_fonts() const { return m_num_tables; }
+
+  // Scratch storage for decoded text
+  unsigned* codes(unsigned len) {
+    m_codes.capacity(len + 1);
+    return &m_codes[0];
+  }
+
+ private:
+  ascii_glyph_table(const ascii_glyph_table&);
+  const ascii_glyph_table& operator=(const ascii_glyph_table&);
+
+  struct font_table {
+    char* signature;
+    unsigned last_use;
+    const glyph_cache* glyphs[128];
+  };
+
+  // Table of the engine's font, the least recently used one is reused
+  // for a new font
+  void select_font() {
+    m_change_stamp = m_feng->change_stamp();
+    const char* signature = m_feng->font_signature();
+    if (signature == 0) signature = "";
+    font_table* t = 0;
+    for (unsigned i = 0; i < m_num_tables; ++i) {
+      if (strcmp(m_tables[i].signature, signature) == 0) {
+        t = &m_tables[i];
+        break;
+      }
+    }
+    if (t == 0) {
+      if (m_num_tables < max_fonts) {
+        t = &m_tables[m_num_tables++];
+      } else {
+        t = &m_tables[0];
+        for (unsigned i = 1; i < m_num_tables; ++i) {
+          if (m_tables[i].last_use < t->last_use) t = &m_tables[i];
+        }
+        delete[] t->signature;
+      }
+      t->signature = new char[strlen(signature) + 1];
+      strcpy(t->signature, signature);
+      memset(t->glyphs, 0, sizeof(t->glyphs));
+    }
+    t->last_use = ++m_clock;
+    m_cur = t;
+  }
+
+  FontEngine* m_feng;
+  FontCacheManager* m_fman;
+  int m_change_stamp;
+  unsigned m_generation;
+  font_table m_tables[max_fonts];
+  unsigned m_num_tables;
+  font_table* m_cur;
+  unsigned m_clock;
+  pod_vector<unsigned> m_codes;
+};
+
+//--------------------------------------------------------render_text_utf8
+// Render len bytes of UTF-8 text, see render_text(). Pure ASCII text is
+// used as it is, without decoding, and its glyphs are resolved through
+// the ASCII table.
+//
+template <class GlyphTable, class Rasterizer, class Scanline, class Renderer>
+void render_text_utf8(GlyphTable& table, Rasterizer& ras, Scanline& sl,
+                      Renderer& ren, const char* text, unsigned len,
+                      double* x, double* y,
+                      const text_style& style = text_style()) {
+  text_run_renderer<typename GlyphTable::font_cache_manager_type, Rasterizer,
+                    Scanline, Renderer>
+      run(table.cache(), ras, sl, ren, style);
+  if (utf8_is_ascii(text, len)) {
+    layout_text(table.engine(), table, text, len, x, y, style, run);
+  } else {
+    unsigned* codes = table.codes(len);
+    unsigned n = utf8_decode(text, len, codes);
+    layout_text(table.engine(), table, codes, n, x, y, style, run);
+  }
+}
+
+//-------------------------------------------------------render_text_utf32
+// Render len UTF-32 code points, see render_text().
+//
+template <class GlyphTable, class Rasterizer, class Scanline, class Renderer>
+void render_text_utf32(GlyphTable& table, Rasterizer& ras, Scanline& sl,
+                       Renderer& ren, const int32u* codes, unsigned len,
+                       double* x, double* y,
+                       const text_style& style = text_style()) {
+  text_run_renderer<typename GlyphTable::font_cache_manager_type, Rasterizer,
+                    Scanline, Renderer>
+      run(table.cache(), ras, sl, ren, style);
+  layout_text(table.engine(), table, codes, len, x, y, style, run);
+}
+
+//-------------------------------------------------------measure_text_utf8
+// Width of len bytes of UTF-8 text, see measure_text(). The table may be
+// built on a font_metrics_manager to measure without rasterizing.
+//
+template <class GlyphTable>
+double measure_text_utf8(GlyphTable& table, const char* text, unsigned len,
+                         const text_style& style = text_style()) {
+  if (utf8_is_ascii(text, len)) {
+    return measure_text(table.engine(), table, text, len, style);
+  }
+  unsigned* codes = table.codes(len);
+  unsigned n = utf8_decode(text, len, codes);
+  return measure_text(table.engine(), table, codes, n, style);
+}
+
+}  // namespace agg
+
+#endif
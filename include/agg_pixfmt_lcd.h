@@ -0,0 +1,719 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry (AGG) - Version 2.5
+// A high quality rendering engine for C++
+// Copyright (C) 2002-2006 Maxim Shemanarev
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://antigrain.com
+// 
+// AGG is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+// 
+// AGG is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with AGG; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, 
+// MA 02110-1301, USA.
+//----------------------------------------------------------------------------
+
+#ifndef AGG_PIXFMT_LCD_INCLUDED
+#define AGG_PIXFMT_LCD_INCLUDED
+
+#include <string.h>
+#include "agg_array.h"
+#include "agg_basics.h"
+#include "agg_color_rgba.h"
+#include "agg_gamma_lut.h"
+#include "agg_rendering_buffer.h"
+#include "agg_trans_affine.h"
+
+// The linear-light blender processes a whole span in 16-bit lanes. SSE2 is
+// used when the compiler targets it, define AGG_LCD_NO_SIMD to force the
+// portable loop (both give identical results).
+#if !defined(AGG_LCD_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define AGG_LCD_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace agg
+{
+ 
+
+    //=====================================================lcd_distribution_lut
+    class lcd_distribution_lut
+    {
+    public:
+        lcd_distribution_lut(double prim, double second, double tert)
+        {
+            double norm = 1.0 / (prim + second*2 + tert*2);
+            prim   *= norm;
+            second *= norm;
+            tert   *= norm;
+            for(unsigned i = 0; i < 256; i++)
+            {
+                unsigned b = (i << 8);
+                unsigned s = round(second * b);
+                unsigned t = round(tert   * b);
+                unsigned p = b - (2*s + 2*t);
+
+                m_data[3*i + 1] = s; /* secondary */
+                m_data[3*i + 2] = t; /* tertiary */
+                m_data[3*i    ] = p; /* primary */
+            }
+        }
+
+        unsigned convolution(const int8u* covers, int i0, int i_min, int i_max) const
+        {
+            unsigned sum = 0;
+            int k_min = (i0 >= i_min + 2 ? -2 : i_min - i0);
+            int k_max = (i0 <= i_max - 2 ?  2 : i_max - i0);
+            for (int k = k_min; k <= k_max; k++)
+            {
+                /* select the primary, secondary or tertiary channel */
+                int channel = abs(k) % 3;
+                int8u c = covers[i0 + k];
+                sum += m_data[3*c + channel];
+            }
+
+            return (sum + 128) >> 8;
+        }
+
+    private:
+        unsigned short m_data[256*3];
+    };
+
+
+    //=========================================================lcd_gamma_lut16
+    // Gamma table suitable for pixfmt_lcd_linear: dir() maps 8-bit
+    // values to 16-bit linear light and inv() maps them back.
+    typedef gamma_lut<int8u, int16u, 8, 16> lcd_gamma_lut16;
+
+    //===================================================lcd_blend_linear16
+    // Blend n linear 16-bit values: d = d + (s - d) * a / 65536, written
+    // as d - d*a + s*a so that a == 0 leaves the destination untouched.
+    // a == 65535 stands for full opacity and gives exactly s.
+    inline void lcd_blend_linear16(int16u* d, const int16u* s,
+                                   const int16u* a, unsigned n)
+    {
+        unsigned k = 0;
+#ifdef AGG_LCD_USE_SSE2
+        const __m128i full = _mm_set1_epi16(-1);
+        for (/* */; k + 8 <= n; k += 8)
+        {
+            __m128i va = _mm_loadu_si128((const __m128i*)(a + k));
+            __m128i vs = _mm_loadu_si128((const __m128i*)(s + k));
+            __m128i vd = _mm_loadu_si128((const __m128i*)(d + k));
+            __m128i opaque = _mm_cmpeq_epi16(va, full);
+            vd = _mm_sub_epi16(vd, _mm_mulhi_epu16(vd, va));
+            vd = _mm_add_epi16(vd, _mm_mulhi_epu16(vs, va));
+            vd = _mm_or_si128(_mm_and_si128(opaque, vs), _mm_andnot_si128(opaque, vd));
+            _mm_storeu_si128((__m128i*)(d + k), vd);
+        }
+#endif
+        for (/* */; k < n; k++)
+        {
+            unsigned dv = d[k];
+            dv -= (dv * a[k]) >> 16;
+            dv += (unsigned(s[k]) * a[k]) >> 16;
+            d[k] = (a[k] == 0xFFFF ? s[k] : int16u(dv));
+        }
+    }
+
+
+    //==============================================================lcd_layout
+    // Describes how the subpixels of the panel map to memory. Order is the
+    // byte order of a pixel (order_rgb, order_bgra, ...) and PixWidth its
+    // size in bytes. SubpixelOrder is the physical order of the stripes
+    // on the panel. With lcd_vertical the stripes are stacked from top to
+    // bottom, as on portrait-rotated panels: the pixfmt then exposes a
+    // transposed view of the buffer where each span runs down a column, so
+    // the rasterizer must receive coordinates with x and y swapped.
+    //
+    // subpixel_mtx() maps image coordinates to those of the pixfmt for
+    // either orientation: x is scaled by 3 for horizontal panels, and
+    // (x, y) becomes (3 * y, x) for vertical ones. Paths go through it
+    // with conv_transform, text with feng.transform(subpixel_mtx()), the
+    // pen position transformed the same way and text_style::width left
+    // at 1. The advances are then transformed too, so that the lines of
+    // vertical panels are stacked by the caller, one render_text() each.
+    enum lcd_subpixel_order_e
+    {
+        lcd_subpixel_rgb,
+        lcd_subpixel_bgr
+    };
+
+    enum lcd_orientation_e
+    {
+        lcd_horizontal,
+        lcd_vertical
+    };
+
+    template <class Order, unsigned PixWidth,
+              lcd_subpixel_order_e SubpixelOrder = lcd_subpixel_rgb,
+              lcd_orientation_e Orientation = lcd_horizontal>
+    struct lcd_layout
+    {
+        typedef Order order_type;
+        enum layout_e
+        {
+            pix_width = PixWidth,
+            vertical  = (Orientation == lcd_vertical),
+            bgr       = (SubpixelOrder == lcd_subpixel_bgr)
+        };
+
+        // Byte offsets, within a pixel, of the three subpixels.
+        static void offsets(unsigned* off)
+        {
+            off[0] = bgr ? Order::B : Order::R;
+            off[1] = Order::G;
+            off[2] = bgr ? Order::R : Order::B;
+        }
+
+        // Color components in the same order as the subpixels.
+        static void components(const rgba8& c, int8u* comp)
+        {
+            comp[0] = bgr ? c.b : c.r;
+            comp[1] = c.g;
+            comp[2] = bgr ? c.r : c.b;
+        }
+
+        // From image coordinates to the subpixel coordinates of the pixfmt
+        static trans_affine subpixel_mtx()
+        {
+            return vertical ? trans_affine(0.0, 1.0, 3.0, 0.0, 0.0, 0.0)
+                            : trans_affine(3.0, 0.0, 0.0, 1.0, 0.0, 0.0);
+        }
+    };
+
+    // Layouts are named after the byte order, then _bgr for BGR stripes,
+    // _v for vertical RGB stripes and _vbgr for vertical BGR ones.
+    typedef lcd_layout<order_rgb,  3> lcd_layout_rgb24;
+    typedef lcd_layout<order_bgr,  3> lcd_layout_bgr24;
+    typedef lcd_layout<order_rgba, 4> lcd_layout_rgba32;
+    typedef lcd_layout<order_bgra, 4> lcd_layout_bgra32;
+
+    typedef lcd_layout<order_rgb,  3, lcd_subpixel_bgr> lcd_layout_rgb24_bgr;
+    typedef lcd_layout<order_bgr,  3, lcd_subpixel_bgr> lcd_layout_bgr24_bgr;
+    typedef lcd_layout<order_rgba, 4, lcd_subpixel_bgr> lcd_layout_rgba32_bgr;
+    typedef lcd_layout<order_bgra, 4, lcd_subpixel_bgr> lcd_layout_bgra32_bgr;
+
+    typedef lcd_layout<order_rgb,  3, lcd_subpixel_rgb, lcd_vertical> lcd_layout_rgb24_v;
+    typedef lcd_layout<order_bgr,  3, lcd_subpixel_rgb, lcd_vertical> lcd_layout_bgr24_v;
+    typedef lcd_layout<order_rgba, 4, lcd_subpixel_rgb, lcd_vertical> lcd_layout_rgba32_v;
+    typedef lcd_layout<order_bgra, 4, lcd_subpixel_rgb, lcd_vertical> lcd_layout_bgra32_v;
+
+    typedef lcd_layout<order_rgb,  3, lcd_subpixel_bgr, lcd_vertical> lcd_layout_rgb24_vbgr;
+    typedef lcd_layout<order_bgr,  3, lcd_subpixel_bgr, lcd_vertical> lcd_layout_bgr24_vbgr;
+    typedef lcd_layout<order_rgba, 4, lcd_subpixel_bgr, lcd_vertical> lcd_layout_rgba32_vbgr;
+    typedef lcd_layout<order_bgra, 4, lcd_subpixel_bgr, lcd_vertical> lcd_layout_bgra32_vbgr;
+
+
+    //=========================================================pixfmt_lcd_base
+    // Geometry shared by the LCD pixel formats. The x coordinate is in
+    // subpixels, so width() is three times the number of pixels along the
+    // subpixel direction. The alpha byte of 32-bit layouts is left as is,
+    // subpixel rendering is meant for opaque surfaces.
+    template <class Layout>
+    class pixfmt_lcd_base
+    {
+    public:
+        typedef rgba8 color_type;
+        typedef rendering_buffer::row_data row_data;
+        typedef color_type::value_type value_type;
+        typedef color_type::calc_type calc_type;
+        typedef Layout layout_type;
+        typedef typename Layout::order_type order_type;
+
+        //--------------------------------------------------------------------
+        pixfmt_lcd_base(rendering_buffer& rb, const lcd_distribution_lut& lut)
+            : m_rbuf(&rb), m_lut(&lut)
+        {
+            Layout::offsets(m_offset);
+        }
+
+        //--------------------------------------------------------------------
+        unsigned width()  const {
+            return (Layout::vertical ? m_rbuf->height() : m_rbuf->width()) * 3;
+        }
+        unsigned height() const {
+            return Layout::vertical ? m_rbuf->width() : m_rbuf->height();
+        }
+
+
+        void copy_hline(int x, int y, unsigned len, const color_type& c)
+        {
+            int8u* p = pix_ptr(x / 3, y);
+            int step = pix_step();
+            for (int n = (x + len - 1) / 3 - x / 3 + 1; n > 0; p += step, n--)
+            {
+                p[order_type::R] = c.r;
+                p[order_type::G] = c.g;
+                p[order_type::B] = c.b;
+            }
+        }
+
+    protected:
+        //--------------------------------------------------------------------
+        int8u* pix_ptr(int px, int y)
+        {
+            return Layout::vertical ? m_rbuf->row_ptr(px) + y * Layout::pix_width
+                                    : m_rbuf->row_ptr(y) + px * Layout::pix_width;
+        }
+
+        int pix_step() const
+        {
+            return Layout::vertical ? m_rbuf->stride() : int(Layout::pix_width);
+        }
+
+        // Covers for blend_hline(), which is treated as a span of
+        // constant cover. Each call is filtered on its own, so pieces
+        // of a scanline_p8 span give whitened pixels where they meet:
+        // use renderer_scanline_lcd_solid, which joins them first.
+        const int8u* hline_covers(unsigned len, int8u cover)
+        {
+            if (m_hline_covers.size() < len)
+            {
+                m_hline_covers.resize(len);
+            }
+            memset(&m_hline_covers[0], cover, len);
+            return &m_hline_covers[0];
+        }
+
+        // Number of subpixels, starting from i and at most n, whose whole
+        // filter window lies inside a run of full covers. For those the
+        // convolution gives exactly cover_full and can be skipped.
+        static int full_cover_run(const int8u* covers, int i, int len, int n)
+        {
+            if (i < 2 || i + 2 >= len) return 0;
+            if ((covers[i - 2] & covers[i - 1] & covers[i] & covers[i + 1]) != cover_full) return 0;
+            int e = i + 2;
+            while (e < len && e < i + n + 2 && covers[e] == cover_full) e++;
+            return e - 2 - i;
+        }
+
+        // Range of subpixels, relative to x, touched by the filter
+        // when blending a span, clipped to the row.
+        bool filter_range(int x, unsigned len, int* cx, int* cx_max) const
+        {
+            int rowlen = width();
+            *cx = (x - 2 >= 0 ? -2 : -x);
+            *cx_max = (x + int(len) + 1 < rowlen ? int(len) + 1 : rowlen - 1 - x);
+            return *cx <= *cx_max;
+        }
+
+        rendering_buffer* m_rbuf;
+        const lcd_distribution_lut* m_lut;
+        unsigned m_offset[3];
+
+    private:
+        pixfmt_lcd_base(const pixfmt_lcd_base&);
+        const pixfmt_lcd_base& operator=(const pixfmt_lcd_base&);
+
+        pod_array<int8u> m_hline_covers;
+    };
+
+
+    //=============================================renderer_scanline_lcd_solid
+    // Solid scanline renderer for the LCD pixel formats. The filter of a
+    // subpixel reaches two subpixels on each side, so spans closer than
+    // that are joined in a single cover array, gaps filled with zero,
+    // and blended with one blend_solid_hspan() call. The output does not
+    // depend on how the scanline splits a row: scanline_u8 and
+    // scanline_p8 give the same result.
+    template <class BaseRenderer>
+    class renderer_scanline_lcd_solid
+    {
+    public:
+        typedef BaseRenderer base_ren_type;
+        typedef typename base_ren_type::color_type color_type;
+
+        //--------------------------------------------------------------------
+        renderer_scanline_lcd_solid() : m_ren(0) {}
+        explicit renderer_scanline_lcd_solid(base_ren_type& ren) : m_ren(&ren) {}
+        void attach(base_ren_type& ren)
+        {
+            m_ren = &ren;
+        }
+
+        //--------------------------------------------------------------------
+        void color(const color_type& c) { m_color = c; }
+        const color_type& color() const { return m_color; }
+
+        //--------------------------------------------------------------------
+        void prepare() {}
+
+        //--------------------------------------------------------------------
+        template <class Scanline> void render(const Scanline& sl)
+        {
+            int y = sl.y();
+            unsigned num_spans = sl.num_spans();
+            typename Scanline::const_iterator span = sl.begin();
+
+            // Spans come sorted by x: size the buffer for the whole row
+            int x_min = span->x;
+            int x_end = x_min;
+            for (unsigned n = num_spans; n > 0; n--, ++span)
+            {
+                x_end = span->x + (span->len < 0 ? -span->len : span->len);
+            }
+            if (m_covers.size() < unsigned(x_end - x_min))
+            {
+                m_covers.resize(x_end - x_min);
+            }
+
+            span = sl.begin();
+            int x1 = span->x;
+            int x2 = x1;
+            for (;;)
+            {
+                int x = span->x;
+                if (x - x2 > 4)
+                {
+                    m_ren->blend_solid_hspan(x1, y, x2 - x1, m_color,
+                                             &m_covers[x1 - x_min]);
+                    x1 = x;
+                }
+                else if (x > x2)
+                {
+                    memset(&m_covers[x2 - x_min], 0, x - x2);
+                }
+
+                cover_type* covers = &m_covers[x - x_min];
+                if (span->len < 0)
+                {
+                    memset(covers, *(span->covers), -span->len);
+                    x2 = x - span->len;
+                }
+                else
+                {
+                    memcpy(covers, span->covers, span->len);
+                    x2 = x + span->len;
+                }
+                if (--num_spans == 0) break;
+                ++span;
+            }
+            m_ren->blend_solid_hspan(x1, y, x2 - x1, m_color,
+                                     &m_covers[x1 - x_min]);
+        }
+
+    private:
+        base_ren_type* m_ren;
+        color_type m_color;
+        pod_array<cover_type> m_covers;
+    };
+
+
+    //==============================================================pixfmt_lcd
+    template <class Layout>
+    class pixfmt_lcd : public pixfmt_lcd_base<Layout>
+    {
+        typedef pixfmt_lcd_base<Layout> base_type;
+    public:
+        typedef typename base_type::color_type color_type;
+
+        //--------------------------------------------------------------------
+        pixfmt_lcd(rendering_buffer& rb, const lcd_distribution_lut& lut)
+            : base_type(rb, lut)
+        {
+        }
+
+        //--------------------------------------------------------------------
+        void blend_hline(int x, int y, unsigned len,
+                         const color_type& c, int8u cover)
+        {
+            blend_solid_hspan(x, y, len, c, base_type::hline_covers(len, cover));
+        }
+
+        //--------------------------------------------------------------------
+        void blend_solid_hspan(int x, int y,
+                               unsigned len,
+                               const color_type& c,
+                               const int8u* covers)
+        {
+            int cx, cx_max;
+            if (!base_type::filter_range(x, len, &cx, &cx_max)) return;
+
+            int i = (x + cx) % 3;
+
+            int8u rgb[3];
+            Layout::components(c, rgb);
+            int8u* p = base_type::pix_ptr((x + cx) / 3, y);
+            int step = base_type::pix_step();
+            const unsigned* off = base_type::m_offset;
+
+            while (cx <= cx_max)
+            {
+                int run = base_type::full_cover_run(covers, cx, len, cx_max - cx + 1);
+                if (run > 0)
+                {
+                    // Interior of a solid run: fill without filtering
+                    unsigned alpha = 256 * (c.a + 1);
+                    for (cx += run; run > 0; run--)
+                    {
+                        int8u* q = p + off[i];
+                        if (c.a == cover_full)
+                        {
+                            *q = rgb[i];
+                        }
+                        else
+                        {
+                            unsigned dst_col = rgb[i], src_col = (*q);
+                            *q = (int8u)((((dst_col - src_col) * alpha) + (src_col << 16)) >> 16);
+                        }
+
+                        if (++i == 3)
+                        {
+                            i = 0;
+                            p += step;
+                        }
+                    }
+                    continue;
+                }
+
+                unsigned c_conv = base_type::m_lut->convolution(covers, cx, 0, len - 1);
+                unsigned alpha = (c_conv + 1) * (c.a + 1);
+                int8u* q = p + off[i];
+                unsigned dst_col = rgb[i], src_col = (*q);
+                *q = (int8u)((((dst_col - src_col) * alpha) + (src_col << 16)) >> 16);
+
+                if (++i == 3)
+                {
+                    i = 0;
+                    p += step;
+                }
+                cx++;
+            }
+        }
+    };
+
+
+    //========================================================pixfmt_lcd_gamma
+    template <class Layout, class Gamma>
+    class pixfmt_lcd_gamma : public pixfmt_lcd_base<Layout>
+    {
+        typedef pixfmt_lcd_base<Layout> base_type;
+    public:
+        typedef typename base_type::color_type color_type;
+
+        //--------------------------------------------------------------------
+        pixfmt_lcd_gamma(rendering_buffer& rb, const lcd_distribution_lut& lut, const Gamma& gamma)
+            : base_type(rb, lut), m_gamma(gamma)
+        {
+        }
+
+        //--------------------------------------------------------------------
+        void blend_hline(int x, int y, unsigned len,
+                         const color_type& c, int8u cover)
+        {
+            blend_solid_hspan(x, y, len, c, base_type::hline_covers(len, cover));
+        }
+
+        //--------------------------------------------------------------------
+        void blend_solid_hspan(int x, int y,
+                               unsigned len,
+                               const color_type& c,
+                               const int8u* covers)
+        {
+            int cx, cx_max;
+            if (!base_type::filter_range(x, len, &cx, &cx_max)) return;
+
+            int i = (x + cx) % 3;
+
+            int8u rgb[3];
+            Layout::components(c, rgb);
+            int8u* p = base_type::pix_ptr((x + cx) / 3, y);
+            int step = base_type::pix_step();
+            const unsigned* off = base_type::m_offset;
+
+            while (cx <= cx_max)
+            {
+                int run = base_type::full_cover_run(covers, cx, len, cx_max - cx + 1);
+                if (run > 0)
+                {
+                    // Interior of a solid run: fill without filtering
+                    unsigned alpha = 256 * (c.a + 1);
+                    for (cx += run; run > 0; run--)
+                    {
+                        int8u* q = p + off[i];
+                        unsigned dst_col = m_gamma.dir(rgb[i]);
+                        if (c.a == cover_full)
+                        {
+                            *q = m_gamma.inv(dst_col);
+                        }
+                        else
+                        {
+                            unsigned src_col = m_gamma.dir(*q);
+                            *q = m_gamma.inv((((dst_col - src_col) * alpha) + (src_col << 16)) >> 16);
+                        }
+
+                        if (++i == 3)
+                        {
+                            i = 0;
+                            p += step;
+                        }
+                    }
+                    continue;
+                }
+
+                unsigned c_conv = base_type::m_lut->convolution(covers, cx, 0, len - 1);
+                unsigned alpha = (c_conv + 1) * (c.a + 1);
+                int8u* q = p + off[i];
+                unsigned dst_col = m_gamma.dir(rgb[i]), src_col = m_gamma.dir(*q);
+                *q = m_gamma.inv((((dst_col - src_col) * alpha) + (src_col << 16)) >> 16);
+
+                if (++i == 3)
+                {
+                    i = 0;
+                    p += step;
+                }
+                cx++;
+            }
+        }
+
+    private:
+        const Gamma& m_gamma;
+    };
+
+
+    //=======================================================pixfmt_lcd_linear
+    // Same as pixfmt_lcd_gamma but the blending is done in 16-bit linear
+    // light. The color of the text is converted once per span, the
+    // destination is converted in bulk into a scratch row, blended by
+    // lcd_blend_linear16 and converted back with the inverse table.
+    // Gamma must provide int16u dir(int8u) and int8u inv(int16u), see
+    // lcd_gamma_lut16.
+    template <class Layout, class Gamma>
+    class pixfmt_lcd_linear : public pixfmt_lcd_base<Layout>
+    {
+        typedef pixfmt_lcd_base<Layout> base_type;
+    public:
+        typedef typename base_type::color_type color_type;
+
+        //--------------------------------------------------------------------
+        pixfmt_lcd_linear(rendering_buffer& rb, const lcd_distribution_lut& lut, const Gamma& gamma)
+            : base_type(rb, lut), m_gamma(gamma)
+        {
+        }
+
+        //--------------------------------------------------------------------
+        void blend_hline(int x, int y, unsigned len,
+                         const color_type& c, int8u cover)
+        {
+            blend_solid_hspan(x, y, len, c, base_type::hline_covers(len, cover));
+        }
+
+        //--------------------------------------------------------------------
+        void blend_solid_hspan(int x, int y,
+                               unsigned len,
+                               const color_type& c,
+                               const int8u* covers)
+        {
+            int cx, cx_max;
+            if (!base_type::filter_range(x, len, &cx, &cx_max)) return;
+
+            unsigned n = cx_max - cx + 1;
+            if (m_scratch.size() < 3 * n)
+            {
+                m_scratch.resize(3 * n);
+            }
+            int16u* lin   = &m_scratch[0];
+            int16u* src   = lin + n;
+            int16u* alpha = src + n;
+
+            int8u comp[3];
+            Layout::components(c, comp);
+            int16u rgb[3] = { m_gamma.dir(comp[0]), m_gamma.dir(comp[1]), m_gamma.dir(comp[2]) };
+            int i0 = (x + cx) % 3;
+            int8u* p0 = base_type::pix_ptr((x + cx) / 3, y);
+            int step = base_type::pix_step();
+            const unsigned* off = base_type::m_offset;
+            unsigned k;
+            int i;
+            int8u* p;
+
+            // The interior of solid runs gets the full cover alpha without
+            // filtering, an opaque color then yields exactly rgb[i].
+            int16u alpha_full = int16u((cover_full * c.a * 66051u) >> 16);
+            for (k = 0; k < n; )
+            {
+                int run = base_type::full_cover_run(covers, cx + int(k), len, n - k);
+                if (run > 0)
+                {
+                    for (/* */; run > 0; run--)
+                    {
+                        alpha[k++] = alpha_full;
+                    }
+                    continue;
+                }
+                unsigned c_conv = base_type::m_lut->convolution(covers, cx + int(k), 0, len - 1);
+                alpha[k++] = int16u((c_conv * c.a * 66051u) >> 16);
+            }
+
+            for (k = 0, i = i0; k < n; k++)
+            {
+                src[k] = rgb[i];
+                if (++i == 3) i = 0;
+            }
+
+            for (k = 0, i = i0, p = p0; k < n; k++)
+            {
+                lin[k] = m_gamma.dir(p[off[i]]);
+                if (++i == 3)
+                {
+                    i = 0;
+                    p += step;
+                }
+            }
+
+            lcd_blend_linear16(lin, src, alpha, n);
+
+            for (k = 0, i = i0, p = p0; k < n; k++)
+            {
+                p[off[i]] = m_gamma.inv(lin[k]);
+                if (++i == 3)
+                {
+                    i = 0;
+                    p += step;
+                }
+            }
+        }
+
+    private:
+        pixfmt_lcd_linear(const pixfmt_lcd_linear&);
+        const pixfmt_lcd_linear& operator=(const pixfmt_lcd_linear&);
+
+        const Gamma& m_gamma;
+        pod_array<int16u> m_scratch;
+    };
+
+
+    //--------------------------------------------------------------------
+    typedef pixfmt_lcd<lcd_layout_bgr24>  pixfmt_bgr24_lcd;
+    typedef pixfmt_lcd<lcd_layout_rgba32> pixfmt_rgba32_lcd;
+    typedef pixfmt_lcd<lcd_layout_bgra32> pixfmt_bgra32_lcd;
+
+    typedef pixfmt_lcd<lcd_layout_rgb24_bgr>   pixfmt_rgb24_lcd_bgr;
+    typedef pixfmt_lcd<lcd_layout_bgr24_bgr>   pixfmt_bgr24_lcd_bgr;
+    typedef pixfmt_lcd<lcd_layout_rgba32_bgr>  pixfmt_rgba32_lcd_bgr;
+    typedef pixfmt_lcd<lcd_layout_bgra32_bgr>  pixfmt_bgra32_lcd_bgr;
+
+    typedef pixfmt_lcd<lcd_layout_rgb24_v>     pixfmt_rgb24_lcd_v;
+    typedef pixfmt_lcd<lcd_layout_bgr24_v>     pixfmt_bgr24_lcd_v;
+    typedef pixfmt_lcd<lcd_layout_rgba32_v>    pixfmt_rgba32_lcd_v;
+    typedef pixfmt_lcd<lcd_layout_bgra32_v>    pixfmt_bgra32_lcd_v;
+
+    typedef pixfmt_lcd<lcd_layout_rgb24_vbgr>  pixfmt_rgb24_lcd_vbgr;
+    typedef pixfmt_lcd<lcd_layout_bgr24_vbgr>  pixfmt_bgr24_lcd_vbgr;
+    typedef pixfmt_lcd<lcd_layout_rgba32_vbgr> pixfmt_rgba32_lcd_vbgr;
+    typedef pixfmt_lcd<lcd_layout_bgra32_vbgr> pixfmt_bgra32_lcd_vbgr;
+
+}
+
+#endif
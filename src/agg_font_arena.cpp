@@ -0,0 +1,244 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#include "agg_font_arena.h"
+
+namespace agg {
+
+//------------------------------------------------------------------------
+font_block_pool::font_block_pool(unsigned block_size,
+                                 unsigned max_free_blocks)
+    : m_block_size(block_size < sizeof(free_block)
+                       ? unsigned(sizeof(free_block))
+                       : block_size),
+      m_max_free_blocks(max_free_blocks),
+      m_free(0),
+      m_num_free(0),
+      m_bytes_in_use(0) {}
+
+//------------------------------------------------------------------------
+font_block_pool::~font_block_pool() { trim(); }
+
+//------------------------------------------------------------------------
+int8u* font_block_pool::allocate(unsigned size) {
+  size = actual_size(size);
+  m_bytes_in_use += size;
+  if (size == m_block_size && m_free) {
+    free_block* b = m_free;
+    m_free = b->next;
+    --m_num_free;
+    return (int8u*)b;
+  }
+  return pod_allocator<int8u>::allocate(size);
+}
+
+//------------------------------------------------------------------------
+void font_block_pool::deallocate(int8u* block, unsigned size) {
+  if (block == 0) return;
+  size = actual_size(size);
+  m_bytes_in_use -= size;
+  if (size == m_block_size && m_num_free < m_max_free_blocks) {
+    free_block* b = (free_block*)block;
+    b->next = m_free;
+    m_free = b;
+    ++m_num_free;
+    return;
+  }
+  pod_allocator<int8u>::deallocate(block, size);
+}
+
+//------------------------------------------------------------------------
+void font_block_pool::trim() {
+  while (m_free) {
+    free_block* b = m_free;
+    m_free = b->next;
+    pod_allocator<int8u>::deallocate((int8u*)b, m_block_size);
+  }
+  m_num_free = 0;
+}
+
+//------------------------------------------------------------------------
+int8u* font_arena::allocate(unsigned size, unsigned alignment) {
+  if (size == 0) return 0;
+  if (alignment == 0) alignment = 1;
+  for (;;) {
+    if (m_cur < m_blocks.size()) {
+      const block& b = m_blocks[m_cur];
+      unsigned align = unsigned((size_t)(b.data + m_pos) % alignment);
+      if (align) align = alignment - align;
+      if (m_pos + align + size <= b.size) {
+        int8u* ptr = b.data + m_pos + align;
+        m_pos += align + size;
+        m_bytes_used += size;
+        return ptr;
+      }
+      // Blocks kept by reset() are reused in order
+      if (m_cur + 1 < m_blocks.size()) {
+        ++m_cur;
+        m_pos = 0;
+        continue;
+      }
+    }
+    block b;
+    b.size = m_pool->actual_size(size + alignment - 1);
+    b.data = m_pool->allocate(b.size);
+    m_blocks.add(b);
+    m_cur = m_blocks.size() - 1;
+    m_pos = 0;
+  }
+}
+
+//------------------------------------------------------------------------
+void font_arena::reset() {
+  // Oversized blocks are returned, the standard ones kept for reuse
+  unsigned n = 0;
+  for (unsigned i = 0; i < m_blocks.size(); ++i) {
+    if (m_blocks[i].size == m_pool->block_size()) {
+      m_blocks[n++] = m_blocks[i];
+    } else {
+      m_pool->deallocate(m_blocks[i].data, m_blocks[i].size);
+    }
+  }
+  while (m_blocks.size() > n) m_blocks.remove_last();
+  m_cur = 0;
+  m_pos = 0;
+  m_bytes_used = 0;
+}
+
+//------------------------------------------------------------------------
+void font_arena::release() {
+  for (unsigned i = 0; i < m_blocks.size(); ++i) {
+    m_pool->deallocate(m_blocks[i].data, m_blocks[i].size);
+  }
+  m_blocks.remove_all();
+  m_cur = 0;
+  m_pos = 0;
+  m_bytes_used = 0;
+}
+
+//------------------------------------------------------------------------
+unsigned long font_arena::bytes_reserved() const {
+  unsigned long n = 0;
+  for (unsigned i = 0; i < m_blocks.size(); ++i) n += m_blocks[i].size;
+  return n;
+}
+
+//------------------------------------------------------------------------
+arena_font_cache::arena_font_cache(font_block_pool& pool,
+                                   const char* font_signature)
+    : m_arena(pool) {
+  unsigned len = unsigned(strlen(font_signature)) + 1;
+  m_signature = (char*)m_arena.allocate(len);
+  memcpy(m_signature, font_signature, len);
+  memset(m_glyphs, 0, sizeof(m_glyphs));
+  memset(m_astral, 0, sizeof(m_astral));
+}
+
+//------------------------------------------------------------------------
+const glyph_cache* arena_font_cache::find_glyph(unsigned glyph_code) const {
+  if (glyph_code > 0xFFFF) {
+    const astral_entry* e = m_astral[glyph_code % num_astral_buckets];
+    for (; e; e = e->next) {
+      if (e->code == glyph_code) return &e->glyph;
+    }
+    return 0;
+  }
+  glyph_cache** page = m_glyphs[glyph_code >> 8];
+  return page ? page[glyph_code & 0xFF] : 0;
+}
+
+//------------------------------------------------------------------------
+glyph_cache* arena_font_cache::cache_glyph(
+    unsigned glyph_code, unsigned glyph_index, unsigned data_size,
+    glyph_data_type data_type, const rect_i& bounds, double advance_x,
+    double advance_y) {
+  if (find_glyph(glyph_code)) return 0;  // Already cached
+
+  glyph_cache* glyph;
+  if (glyph_code > 0xFFFF) {
+    astral_entry* e = (astral_entry*)m_arena.allocate(sizeof(astral_entry),
+                                                      sizeof(double));
+    astral_entry*& head = m_astral[glyph_code % num_astral_buckets];
+    e->code = glyph_code;
+    e->next = head;
+    head = e;
+    glyph = &e->glyph;
+  } else {
+    glyph_cache**& page = m_glyphs[glyph_code >> 8];
+    if (page == 0) {
+      page = (glyph_cache**)m_arena.allocate(sizeof(glyph_cache*) * 256,
+                                             sizeof(glyph_cache*));
+      memset(page, 0, sizeof(glyph_cache*) * 256);
+    }
+    glyph = (glyph_cache*)m_arena.allocate(sizeof(glyph_cache),
+                                           sizeof(double));
+    page[glyph_code & 0xFF] = glyph;
+  }
+  glyph->glyph_index = glyph_index;
+  glyph->data = m_arena.allocate(data_size);
+  glyph->data_size = data_size;
+  glyph->data_type = data_type;
+  glyph->bounds = bounds;
+  glyph->advance_x = advance_x;
+  glyph->advance_y = advance_y;
+  return glyph;
+}
+
+//------------------------------------------------------------------------
+arena_font_cache_pool::arena_font_cache_pool(unsigned max_fonts,
+                                             unsigned block_size)
+    : m_blocks(block_size),
+      m_fonts(new arena_font_cache*[max_fonts ? max_fonts : 1]),
+      m_max_fonts(max_fonts ? max_fonts : 1),
+      m_num_fonts(0),
+      m_cur_font(0) {}
+
+//------------------------------------------------------------------------
+arena_font_cache_pool::~arena_font_cache_pool() {
+  for (unsigned i = 0; i < m_num_fonts; ++i) delete m_fonts[i];
+  delete[] m_fonts;
+}
+
+//------------------------------------------------------------------------
+void arena_font_cache_pool::font(const char* font_signature,
+                                 bool reset_cache) {
+  unsigned i;
+  for (i = 0; i < m_num_fonts; ++i) {
+    if (m_fonts[i]->font_is(font_signature)) break;
+  }
+  arena_font_cache* f;
+  if (i < m_num_fonts) {
+    f = m_fonts[i];
+    if (reset_cache) {
+      delete f;
+      f = new arena_font_cache(m_blocks, font_signature);
+    }
+    // Keep the fonts in order of use, the last one is the most recent
+    for (; i + 1 < m_num_fonts; ++i) m_fonts[i] = m_fonts[i + 1];
+  } else {
+    if (m_num_fonts >= m_max_fonts) {
+      delete m_fonts[0];
+      memmove(m_fonts, m_fonts + 1,
+              (m_max_fonts - 1) * sizeof(arena_font_cache*));
+      m_num_fonts = m_max_fonts - 1;
+    }
+    f = new arena_font_cache(m_blocks, font_signature);
+    ++m_num_fonts;
+  }
+  m_fonts[m_num_fonts - 1] = f;
+  m_cur_font = f;
+}
+
+}  // namespace agg
@@ -0,0 +1,114 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#include "agg_font_bands.h"
+#include "agg_font_threads.h"
+
+namespace agg {
+
+//------------------------------------------------------------------------
+struct band_pool_state {
+  font_mutex mutex;
+  font_condition work_cond;
+  font_condition done_cond;
+  font_band_func func;
+  void* data;
+  unsigned num_bands;
+  unsigned next_band;
+  unsigned bands_done;
+  bool quit;
+  unsigned num_threads;
+  font_thread* threads;
+
+  band_pool_state()
+      : func(0),
+        data(0),
+        num_bands(0),
+        next_band(0),
+        bands_done(0),
+        quit(false),
+        num_threads(0),
+        threads(0) {}
+};
+
+//------------------------------------------------------------------------
+// Draw bands until none is left to take, with the mutex held on entry and
+// on return
+static void band_pool_drain(band_pool_state& s) {
+  while (s.next_band < s.num_bands) {
+    unsigned band = s.next_band++;
+    s.mutex.unlock();
+    s.func(s.data, band);
+    s.mutex.lock();
+    if (++s.bands_done == s.num_bands) s.done_cond.broadcast();
+  }
+}
+
+//------------------------------------------------------------------------
+static void band_pool_thread(void* state) {
+  band_pool_state& s = *(band_pool_state*)state;
+  font_lock lock(s.mutex);
+  for (;;) {
+    while (s.next_band >= s.num_bands && !s.quit) s.work_cond.wait(s.mutex);
+    if (s.quit) return;
+    band_pool_drain(s);
+  }
+}
+
+//------------------------------------------------------------------------
+font_band_pool::font_band_pool(unsigned num_threads)
+    : m_state(new band_pool_state) {
+  m_state->threads = new font_thread[num_threads ? num_threads : 1];
+  for (unsigned i = 0; i < num_threads; ++i) {
+    if (!m_state->threads[i].start(band_pool_thread, m_state)) break;
+    ++m_state->num_threads;
+  }
+}
+
+//------------------------------------------------------------------------
+font_band_pool::~font_band_pool() {
+  {
+    font_lock lock(m_state->mutex);
+    m_state->quit = true;
+    m_state->work_cond.broadcast();
+  }
+  for (unsigned i = 0; i < m_state->num_threads; ++i) {
+    m_state->threads[i].join();
+  }
+  delete[] m_state->threads;
+  delete m_state;
+}
+
+//------------------------------------------------------------------------
+unsigned font_band_pool::num_threads() const { return m_state->num_threads; }
+
+//------------------------------------------------------------------------
+void font_band_pool::run(font_band_func func, void* data,
+                         unsigned num_bands) {
+  if (num_bands == 0) return;
+  font_lock lock(m_state->mutex);
+  m_state->func = func;
+  m_state->data = data;
+  m_state->num_bands = num_bands;
+  m_state->next_band = 0;
+  m_state->bands_done = 0;
+  if (m_state->num_threads) m_state->work_cond.broadcast();
+  band_pool_drain(*m_state);
+  while (m_state->bands_done < m_state->num_bands) {
+    m_state->done_cond.wait(m_state->mutex);
+  }
+}
+
+}  // namespace agg
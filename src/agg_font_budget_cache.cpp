@@ -0,0 +1,278 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#include "agg_font_budget_cache.h"
+#include <string.h>
+
+namespace agg {
+
+//------------------------------------------------------------------------
+struct glyph_budget_cache::font_entry {
+  font_entry* next;
+  char* signature;
+  unsigned num_glyphs;
+};
+
+//------------------------------------------------------------------------
+// The glyph data follows the entry in the same allocation
+struct glyph_budget_cache::entry {
+  glyph_cache glyph;
+  entry* bucket_next;
+  entry* lru_prev;
+  entry* lru_next;
+  font_entry* font;
+  unsigned code;
+  unsigned alloc_size;
+};
+
+//------------------------------------------------------------------------
+static inline unsigned font_entry_size(const char* signature) {
+  return unsigned(strlen(signature)) + 1;
+}
+
+//------------------------------------------------------------------------
+glyph_budget_cache::glyph_budget_cache(unsigned long max_bytes)
+    : m_buckets(0),
+      m_num_buckets(0),
+      m_lru_first(0),
+      m_lru_last(0),
+      m_fonts(0),
+      m_cur_font(0),
+      m_num_glyphs(0),
+      m_num_fonts(0),
+      m_max_bytes(max_bytes),
+      m_bytes_used(0),
+      m_evictions(0),
+      m_generation(0) {
+  rehash(256);
+}
+
+//------------------------------------------------------------------------
+glyph_budget_cache::~glyph_budget_cache() {
+  while (m_lru_first) remove(m_lru_first);
+  while (m_fonts) remove_font(m_fonts);
+  pod_allocator<entry*>::deallocate(m_buckets, m_num_buckets);
+}
+
+//------------------------------------------------------------------------
+void glyph_budget_cache::clear() {
+  while (m_lru_first) remove(m_lru_first);
+  font_entry* f = m_fonts;
+  while (f) {
+    font_entry* next = f->next;
+    if (f != m_cur_font) remove_font(f);
+    f = next;
+  }
+  ++m_generation;
+}
+
+//------------------------------------------------------------------------
+void glyph_budget_cache::font(const char* font_signature, bool reset_cache) {
+  font_entry* f = m_fonts;
+  for (; f; f = f->next) {
+    if (strcmp(f->signature, font_signature) == 0) break;
+  }
+  // A font left without glyphs is not kept around
+  if (m_cur_font && m_cur_font != f && m_cur_font->num_glyphs == 0) {
+    remove_font(m_cur_font);
+  }
+  if (f == 0) {
+    unsigned len = font_entry_size(font_signature);
+    f = new font_entry;
+    f->signature = pod_allocator<char>::allocate(len);
+    memcpy(f->signature, font_signature, len);
+    f->num_glyphs = 0;
+    f->next = m_fonts;
+    m_fonts = f;
+    ++m_num_fonts;
+    m_bytes_used += sizeof(font_entry) + len;
+  } else if (reset_cache) {
+    drop_glyphs(f);
+  }
+  m_cur_font = f;
+}
+
+//------------------------------------------------------------------------
+const char* glyph_budget_cache::font() const {
+  return m_cur_font ? m_cur_font->signature : 0;
+}
+
+//------------------------------------------------------------------------
+unsigned glyph_budget_cache::bucket(const font_entry* font,
+                                    unsigned glyph_code) const {
+  unsigned h = (glyph_code * 2654435761u) ^ unsigned(size_t(font) >> 4);
+  return (h ^ (h >> 15)) & (m_num_buckets - 1);
+}
+
+//------------------------------------------------------------------------
+void glyph_budget_cache::rehash(unsigned num_buckets) {
+  pod_allocator<entry*>::deallocate(m_buckets, m_num_buckets);
+  m_buckets = pod_allocator<entry*>::allocate(num_buckets);
+  m_num_buckets = num_buckets;
+  memset(m_buckets, 0, sizeof(entry*) * num_buckets);
+  for (entry* e = m_lru_first; e; e = e->lru_next) {
+    entry*& head = m_buckets[bucket(e->font, e->code)];
+    e->bucket_next = head;
+    head = e;
+  }
+}
+
+//------------------------------------------------------------------------
+const glyph_cache* glyph_budget_cache::find_glyph(unsigned glyph_code) {
+  if (m_cur_font == 0) return 0;
+  entry* e = m_buckets[bucket(m_cur_font, glyph_code)];
+  for (; e; e = e->bucket_next) {
+    if (e->code == glyph_code && e->font == m_cur_font) {
+      if (e != m_lru_first) {
+        unlink(e);
+        push_front(e);
+      }
+      return &e->glyph;
+    }
+  }
+  return 0;
+}
+
+//------------------------------------------------------------------------
+glyph_cache* glyph_budget_cache::cache_glyph(
+    unsigned glyph_code, unsigned glyph_index, unsigned data_size,
+    glyph_data_type data_type, const rect_i& bounds, double advance_x,
+    double advance_y) {
+  if (m_cur_font == 0) return 0;
+  if (find_glyph(glyph_code)) return 0;  // Already cached
+
+  unsigned alloc_size = unsigned(sizeof(entry)) + data_size;
+  shrink(alloc_size);
+
+  entry* e = (entry*)pod_allocator<int8u>::allocate(alloc_size);
+  e->glyph.glyph_index = glyph_index;
+  e->glyph.data = data_size ? (int8u*)(e + 1) : 0;
+  e->glyph.data_size = data_size;
+  e->glyph.data_type = data_type;
+  e->glyph.bounds = bounds;
+  e->glyph.advance_x = advance_x;
+  e->glyph.advance_y = advance_y;
+  e->font = m_cur_font;
+  e->code = glyph_code;
+  e->alloc_size = alloc_size;
+
+  if (m_num_glyphs >= m_num_buckets) rehash(m_num_buckets * 2);
+  entry*& head = m_buckets[bucket(m_cur_font, glyph_code)];
+  e->bucket_next = head;
+  head = e;
+  push_front(e);
+  ++m_num_glyphs;
+  ++m_cur_font->num_glyphs;
+  m_bytes_used += alloc_size;
+  return &e->glyph;
+}
+
+//------------------------------------------------------------------------
+bool glyph_budget_cache::remove_glyph(unsigned glyph_code) {
+  if (m_cur_font == 0) return false;
+  entry* e = m_buckets[bucket(m_cur_font, glyph_code)];
+  for (; e; e = e->bucket_next) {
+    if (e->code == glyph_code && e->font == m_cur_font) {
+      remove(e);
+      ++m_generation;
+      return true;
+    }
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------
+void glyph_budget_cache::max_bytes(unsigned long max_bytes) {
+  m_max_bytes = max_bytes;
+  shrink(0);
+}
+
+//------------------------------------------------------------------------
+// Evict until extra bytes fit in the budget, sparing the two most recent
+void glyph_budget_cache::shrink(unsigned long extra) {
+  bool evicted = false;
+  while (m_bytes_used + extra > m_max_bytes && m_num_glyphs > 2) {
+    entry* e = m_lru_last;
+    font_entry* f = e->font;
+    remove(e);
+    ++m_evictions;
+    evicted = true;
+    if (f->num_glyphs == 0 && f != m_cur_font) remove_font(f);
+  }
+  if (evicted) ++m_generation;
+}
+
+//------------------------------------------------------------------------
+void glyph_budget_cache::unlink(entry* e) {
+  if (e->lru_prev) {
+    e->lru_prev->lru_next = e->lru_next;
+  } else {
+    m_lru_first = e->lru_next;
+  }
+  if (e->lru_next) {
+    e->lru_next->lru_prev = e->lru_prev;
+  } else {
+    m_lru_last = e->lru_prev;
+  }
+}
+
+//------------------------------------------------------------------------
+void glyph_budget_cache::push_front(entry* e) {
+  e->lru_prev = 0;
+  e->lru_next = m_lru_first;
+  if (m_lru_first) {
+    m_lru_first->lru_prev = e;
+  } else {
+    m_lru_last = e;
+  }
+  m_lru_first = e;
+}
+
+//------------------------------------------------------------------------
+void glyph_budget_cache::remove(entry* e) {
+  entry** p = &m_buckets[bucket(e->font, e->code)];
+  while (*p != e) p = &(*p)->bucket_next;
+  *p = e->bucket_next;
+  unlink(e);
+  --m_num_glyphs;
+  --e->font->num_glyphs;
+  m_bytes_used -= e->alloc_size;
+  pod_allocator<int8u>::deallocate((int8u*)e, e->alloc_size);
+}
+
+//------------------------------------------------------------------------
+void glyph_budget_cache::remove_font(font_entry* font) {
+  font_entry** p = &m_fonts;
+  while (*p != font) p = &(*p)->next;
+  *p = font->next;
+  --m_num_fonts;
+  unsigned len = font_entry_size(font->signature);
+  m_bytes_used -= sizeof(font_entry) + len;
+  pod_allocator<char>::deallocate(font->signature, len);
+  delete font;
+}
+
+//------------------------------------------------------------------------
+void glyph_budget_cache::drop_glyphs(font_entry* font) {
+  entry* e = m_lru_first;
+  while (e && font->num_glyphs) {
+    entry* next = e->lru_next;
+    if (e->font == font) remove(e);
+    e = next;
+  }
+  ++m_generation;
+}
+
+}  // namespace agg
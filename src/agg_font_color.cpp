@@ -0,0 +1,150 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#include "agg_font_color.h"
+#include <stdio.h>
+
+namespace agg {
+
+//------------------------------------------------------------------------
+// Weights are in 1/4096 of a target pixel, so that the two passes of a
+// 255 channel stay within 32 bits
+static const unsigned color_weight_shift = 12;
+static const unsigned color_weight_one = 1 << color_weight_shift;
+
+struct color_tap {
+  int src;
+  unsigned weight;
+};
+
+// Texels overlapping each target pixel along one axis, those of pixel i
+// being taps[first[i]] to taps[first[i + 1]]
+static void color_axis_taps(int n, double offset, double scale, int m,
+                            pod_array<unsigned>& first,
+                            pod_bvector<color_tap>& taps) {
+  pod_array<int> edge(n + 1);
+  for (int j = 0; j <= n; ++j) {
+    edge[j] = int(floor((offset + j * scale) * color_weight_one + 0.5));
+  }
+  first.resize(m + 1);
+  taps.remove_all();
+  int j = 0;
+  for (int i = 0; i < m; ++i) {
+    first[i] = taps.size();
+    int lo = i * int(color_weight_one);
+    int hi = lo + int(color_weight_one);
+    while (j < n && edge[j + 1] <= lo) ++j;
+    for (int k = j; k < n && edge[k] < hi; ++k) {
+      int a = edge[k] > lo ? edge[k] : lo;
+      int b = edge[k + 1] < hi ? edge[k + 1] : hi;
+      if (b > a) {
+        color_tap t = {k, unsigned(b - a)};
+        taps.add(t);
+      }
+    }
+  }
+  first[m] = taps.size();
+}
+
+//------------------------------------------------------------------------
+void color_bitmap_resample(const int8u* src, int sw, int sh, double ox,
+                           double oy, double sx, double sy, int8u* dst,
+                           int dw, int dh) {
+  pod_array<unsigned> first_x, first_y;
+  pod_bvector<color_tap> taps_x, taps_y;
+  color_axis_taps(sw, ox, sx, dw, first_x, taps_x);
+  color_axis_taps(sh, oy, sy, dh, first_y, taps_y);
+
+  // Rows filtered across, then columns down
+  pod_array<unsigned> rows(sh * dw * 4);
+  for (int v = 0; v < sh; ++v) {
+    const int8u* s = src + v * sw * 4;
+    unsigned* r = &rows[v * dw * 4];
+    for (int i = 0; i < dw; ++i, r += 4) {
+      unsigned c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+      for (unsigned t = first_x[i]; t < first_x[i + 1]; ++t) {
+        const int8u* p = s + taps_x[t].src * 4;
+        unsigned w = taps_x[t].weight;
+        c0 += p[0] * w;
+        c1 += p[1] * w;
+        c2 += p[2] * w;
+        c3 += p[3] * w;
+      }
+      r[0] = c0;
+      r[1] = c1;
+      r[2] = c2;
+      r[3] = c3;
+    }
+  }
+
+  const unsigned shift = 2 * color_weight_shift;
+  const unsigned half = 1u << (shift - 1);
+  for (int k = 0; k < dh; ++k) {
+    int8u* d = dst + k * dw * 4;
+    for (int i = 0; i < dw; ++i, d += 4) {
+      unsigned c0 = half, c1 = half, c2 = half, c3 = half;
+      for (unsigned t = first_y[k]; t < first_y[k + 1]; ++t) {
+        const unsigned* r = &rows[(taps_y[t].src * dw + i) * 4];
+        unsigned w = taps_y[t].weight;
+        c0 += r[0] * w;
+        c1 += r[1] * w;
+        c2 += r[2] * w;
+        c3 += r[3] * w;
+      }
+      d[0] = int8u(c0 >> shift);
+      d[1] = int8u(c1 >> shift);
+      d[2] = int8u(c2 >> shift);
+      d[3] = int8u(c3 >> shift);
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+void color_bitmap_cache::font(const char* font_signature, double scale_x,
+                              double scale_y) {
+  unsigned len = unsigned(strlen(font_signature)) + 64;
+  if (m_key.size() < len) m_key.resize(len);
+  sprintf(&m_key[0], "%s:%.9g,%.9g", font_signature, scale_x, scale_y);
+  m_bitmaps.font(&m_key[0]);
+  m_scale_x = scale_x;
+  m_scale_y = scale_y;
+}
+
+//------------------------------------------------------------------------
+const glyph_cache* color_bitmap_cache::scaled(const glyph_cache* glyph) {
+  const glyph_cache* gl = m_bitmaps.find_glyph(glyph->glyph_index);
+  if (gl) return gl;
+
+  const rect_i& b = glyph->bounds;
+  double fx = b.x1 * m_scale_x;
+  double fy = b.y1 * m_scale_y;
+  int x1 = int(floor(fx));
+  int y1 = int(floor(fy));
+  int x2 = int(ceil(b.x2 * m_scale_x));
+  int y2 = int(ceil(b.y2 * m_scale_y));
+  if (x2 <= x1) x2 = x1 + 1;
+  if (y2 <= y1) y2 = y1 + 1;
+  glyph_cache* g = m_bitmaps.cache_glyph(
+      glyph->glyph_index, glyph->glyph_index, (x2 - x1) * (y2 - y1) * 4,
+      glyph_data_invalid, rect_i(x1, y1, x2, y2), glyph->advance_x,
+      glyph->advance_y);
+  if (g == 0) return 0;
+  color_bitmap_resample(glyph->data, b.x2 - b.x1, b.y2 - b.y1, fx - x1,
+                        fy - y1, m_scale_x, m_scale_y, g->data, x2 - x1,
+                        y2 - y1);
+  return g;
+}
+
+}  // namespace agg
@@ -0,0 +1,110 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#include "agg_font_fallback.h"
+
+#include <string.h>
+
+namespace agg {
+
+//------------------------------------------------------------------------
+void font_coverage::clear() {
+  memset(m_index, 0, sizeof(m_index));
+  m_pages.remove_all();
+  page empty;
+  memset(&empty, 0, sizeof(empty));
+  m_pages.add(empty);
+  m_num_codes = 0;
+}
+
+//------------------------------------------------------------------------
+void font_coverage::add(unsigned code) {
+  if (code >= max_code) return;
+  int16u& index = m_index[code >> page_shift];
+  if (index == 0) {
+    page p;
+    memset(&p, 0, sizeof(p));
+    index = int16u(m_pages.size());
+    m_pages.add(p);
+  }
+  int8u& bits = m_pages[index].bits[(code >> 3) & 31];
+  int8u mask = int8u(1 << (code & 7));
+  if ((bits & mask) == 0) {
+    bits |= mask;
+    ++m_num_codes;
+  }
+}
+
+//------------------------------------------------------------------------
+void font_coverage::build(const font_engine_freetype_base& feng) {
+  clear();
+  unsigned glyph_index;
+  unsigned code = feng.first_char(&glyph_index);
+  while (glyph_index) {
+    add(code);
+    code = feng.next_char(code, &glyph_index);
+  }
+}
+
+//------------------------------------------------------------------------
+font_fallback_chain::~font_fallback_chain() { remove_all(); }
+
+//------------------------------------------------------------------------
+font_fallback_chain::font_fallback_chain(glyph_rendering ren)
+    : m_rendering(ren) {}
+
+//------------------------------------------------------------------------
+bool font_fallback_chain::add(font_engine_freetype_base& feng,
+                              const char* font_name, unsigned face_index,
+                              const char* font_mem, long font_mem_size) {
+  face_entry* e = new face_entry;
+  e->name = new char[strlen(font_name) + 1];
+  strcpy(e->name, font_name);
+  e->face_index = face_index;
+  e->font_mem = font_mem;
+  e->font_mem_size = font_mem_size;
+
+  bool ok = feng.load_font(font_name, face_index, m_rendering, font_mem,
+                           font_mem_size);
+  if (ok) {
+    e->coverage.build(feng);
+    m_faces.add(e);
+  } else {
+    delete[] e->name;
+    delete e;
+  }
+  // A failed load leaves feng without a face
+  if (m_faces.size() > 1 || (!ok && m_faces.size())) select(feng, 0);
+  return ok;
+}
+
+//------------------------------------------------------------------------
+void font_fallback_chain::remove_all() {
+  for (unsigned i = 0; i < m_faces.size(); ++i) {
+    delete[] m_faces[i]->name;
+    delete m_faces[i];
+  }
+  m_faces.remove_all();
+}
+
+//------------------------------------------------------------------------
+bool font_fallback_chain::select(font_engine_freetype_base& feng,
+                                 unsigned i) const {
+  const face_entry* e = m_faces[i];
+  return feng.load_font(e->name, e->face_index, m_rendering, e->font_mem,
+                        e->font_mem_size);
+}
+
+}  // namespace agg
@@ -15,6 +15,11 @@
 
 #include "agg_font_freetype.h"
 #include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 #include "agg_bitset_iterator.h"
 #include "agg_renderer_scanline.h"
 
@@ -97,6 +102,17 @@ static unsigned calc_crc32(const unsigned char* buf, unsigned size) {
 //------------------------------------------------------------------------
 static inline int dbl_to_plain_fx(double d) { return int(d * 65536.0); }
 
+// Timing hooks around the stages of load_font() and prepare_glyph(),
+// reported to the timing callback. Removed unless AGG_FONT_TIMING is set.
+#ifdef AGG_FONT_TIMING
+#define AGG_FONT_TIMING_BEGIN(t) double t = timing_now()
+#define AGG_FONT_TIMING_END(t, stage) \
+  timing_end(stage, t, m_name, m_glyph_rendering)
+#else
+#define AGG_FONT_TIMING_BEGIN(t)
+#define AGG_FONT_TIMING_END(t, stage)
+#endif
+
 //------------------------------------------------------------------------
 static inline double int26p6_to_dbl(int p) { return double(p) / 64.0; }
 
@@ -423,14 +439,48 @@ void decompose_ft_bitmap_gray8(const FT_Bitmap& bitmap, int x, int y,
   }
 }
 
+//------------------------------------------------------------------------
+template bool decompose_ft_outline(const FT_Outline&, bool,
+                                   const trans_affine&,
+                                   path_storage_integer<int16, 6>&);
+template bool decompose_ft_outline(const FT_Outline&, bool,
+                                   const trans_affine&,
+                                   path_storage_integer<int32, 6>&);
+template void decompose_ft_bitmap_mono(const FT_Bitmap&, int, int, bool,
+                                       scanline_bin&, scanline_storage_bin&);
+template void decompose_ft_bitmap_gray8(const FT_Bitmap&, int, int, bool,
+                                        rasterizer_scanline_aa<>&,
+                                        scanline_u8&, scanline_storage_aa8&);
+
+//------------------------------------------------------------------------
+// Store the polygons of a stroke converter, flattened, in an integer path
+template <class VertexSource, class PathStorage>
+static void store_stroke(VertexSource& vs, PathStorage& path) {
+  typedef typename PathStorage::value_type value_type;
+  path.remove_all();
+  double x, y;
+  unsigned cmd;
+  vs.rewind(0);
+  while (!is_stop(cmd = vs.vertex(&x, &y))) {
+    value_type ix = value_type(dbl_to_int26p6(x));
+    value_type iy = value_type(dbl_to_int26p6(y));
+    if (is_move_to(cmd)) {
+      path.move_to(ix, iy);
+    } else if (is_vertex(cmd)) {
+      path.line_to(ix, iy);
+    } else if (is_end_poly(cmd) && is_closed(cmd)) {
+      path.close_polygon();
+    }
+  }
+}
+
 //------------------------------------------------------------------------
 font_engine_freetype_base::~font_engine_freetype_base() {
   unsigned i;
-  for (i = 0; i < m_num_faces; ++i) {
-    delete[] m_face_names[i];
-    FT_Done_Face(m_faces[i]);
-  }
+  for (i = 0; i < m_num_faces; ++i) done_face(i);
   delete[] m_face_names;
+  delete[] m_face_indices;
+  delete[] m_face_vars;
   delete[] m_faces;
   delete[] m_signature;
   if (m_library_initialized) FT_Done_FreeType(m_library);
@@ -446,18 +496,26 @@ font_engine_freetype_base::font_engine_freetype_base(bool flag32,
       m_name_len(256 - 16 - 1),
       m_face_index(0),
       m_char_map(FT_ENCODING_NONE),
-      m_signature(new char[256 + 256 - 16]),
+      m_signature(new char[256 + 512 - 16]),
       m_height(0),
       m_width(0),
-      m_hinting(true),
+      m_hinting(font_hinting_autohint),
+      m_embolden(0.0),
+      m_oblique(0.0),
+      m_stroke_width(0.0),
+      m_stroke_join(round_join),
+      m_stroke_miter_limit(4.0),
       m_flip_y(false),
       m_library_initialized(false),
       m_library(0),
       m_faces(new FT_Face[max_faces]),
       m_face_names(new char*[max_faces]),
+      m_face_indices(new unsigned[max_faces]),
+      m_face_vars(new face_variation*[max_faces]),
       m_num_faces(0),
       m_max_faces(max_faces),
       m_cur_face(0),
+      m_cur_vars(0),
       m_resolution(0),
       m_glyph_rendering(glyph_ren_native_gray8),
       m_glyph_index(0),
@@ -471,13 +529,22 @@ font_engine_freetype_base::font_engine_freetype_base(bool flag32,
       m_path32(),
       m_curves16(m_path16),
       m_curves32(m_path32),
+      m_stroke16(m_curves16),
+      m_stroke32(m_curves32),
       m_scanline_aa(),
       m_scanline_bin(),
       m_scanlines_aa(),
       m_scanlines_bin(),
-      m_rasterizer() {
+      m_rasterizer(),
+      m_sdf_height(64.0),
+      m_sdf_spread(8.0),
+      m_color_strike(0.0),
+      m_timing_callback(0),
+      m_timing_data(0) {
   m_curves16.approximation_scale(4.0);
   m_curves32.approximation_scale(4.0);
+  m_stroke16.approximation_scale(4.0);
+  m_stroke32.approximation_scale(4.0);
   m_last_error = FT_Init_FreeType(&m_library);
   if (m_last_error == 0) m_library_initialized = true;
 }
@@ -489,14 +556,26 @@ void font_engine_freetype_base::resolution(unsigned dpi) {
 }
 
 //------------------------------------------------------------------------
-int font_engine_freetype_base::find_face(const char* face_name) const {
+int font_engine_freetype_base::find_face(const char* face_name,
+                                         unsigned face_index) const {
   unsigned i;
   for (i = 0; i < m_num_faces; ++i) {
-    if (strcmp(face_name, m_face_names[i]) == 0) return i;
+    if (m_face_indices[i] == face_index &&
+        strcmp(face_name, m_face_names[i]) == 0) {
+      return i;
+    }
   }
   return -1;
 }
 
+//------------------------------------------------------------------------
+void font_engine_freetype_base::done_face(unsigned i) {
+  delete[] m_face_names[i];
+  if (m_face_vars[i]->mm) FT_Done_MM_Var(m_library, m_face_vars[i]->mm);
+  delete m_face_vars[i];
+  FT_Done_Face(m_faces[i]);
+}
+
 //------------------------------------------------------------------------
 double font_engine_freetype_base::ascender() const {
   if (m_cur_face) {
@@ -505,6 +584,27 @@ double font_engine_freetype_base::ascender() const {
   return 0.0;
 }
 
+//------------------------------------------------------------------------
+unsigned font_engine_freetype_base::units_per_em() const {
+  return m_cur_face ? m_cur_face->units_per_EM : 0;
+}
+
+//------------------------------------------------------------------------
+trans_affine font_engine_freetype_base::units_matrix() const {
+  if (m_cur_face == 0 || m_cur_face->units_per_EM == 0) {
+    return trans_affine_scaling(0.0);
+  }
+  // The em size as set by update_char_size(), a zero width is the height
+  double em_y = height();
+  double em_x = m_width ? width() : em_y;
+  if (m_resolution) {
+    em_x *= m_resolution / 72.0;
+    em_y *= m_resolution / 72.0;
+  }
+  return trans_affine_scaling(em_x / m_cur_face->units_per_EM,
+                              em_y / m_cur_face->units_per_EM);
+}
+
 //------------------------------------------------------------------------
 double font_engine_freetype_base::descender() const {
   if (m_cur_face) {
@@ -524,20 +624,30 @@ bool font_engine_freetype_base::load_font(const char* font_name,
   if (m_library_initialized) {
     m_last_error = 0;
 
-    int idx = find_face(font_name);
+    int idx = find_face(font_name, face_index);
     if (idx >= 0) {
       m_cur_face = m_faces[idx];
       m_name = m_face_names[idx];
+      m_face_index = m_face_indices[idx];
+      m_cur_vars = m_face_vars[idx];
+      ++m_stats.load_font_hits;
     } else {
       if (m_num_faces >= m_max_faces) {
-        delete[] m_face_names[0];
-        FT_Done_Face(m_faces[0]);
-        memcpy(m_faces, m_faces + 1, (m_max_faces - 1) * sizeof(FT_Face));
-        memcpy(m_face_names, m_face_names + 1,
-               (m_max_faces - 1) * sizeof(char*));
+        ++m_stats.faces_evicted;
+        done_face(0);
+        memmove(m_faces, m_faces + 1, (m_max_faces - 1) * sizeof(FT_Face));
+        memmove(m_face_names, m_face_names + 1,
+                (m_max_faces - 1) * sizeof(char*));
+        memmove(m_face_indices, m_face_indices + 1,
+                (m_max_faces - 1) * sizeof(unsigned));
+        memmove(m_face_vars, m_face_vars + 1,
+                (m_max_faces - 1) * sizeof(face_variation*));
         m_num_faces = m_max_faces - 1;
       }
 
+#ifdef AGG_FONT_TIMING
+      double t_open = timing_now();
+#endif
       if (font_mem && font_mem_size) {
         m_last_error = FT_New_Memory_Face(m_library, (const FT_Byte*)font_mem,
                                           font_mem_size, face_index,
@@ -546,23 +656,47 @@ bool font_engine_freetype_base::load_font(const char* font_name,
         m_last_error = FT_New_Face(m_library, font_name, face_index,
                                    &m_faces[m_num_faces]);
       }
+#ifdef AGG_FONT_TIMING
+      timing_end(font_timing_open_face, t_open, font_name, ren_type);
+#endif
 
       if (m_last_error == 0) {
         m_face_names[m_num_faces] = new char[strlen(font_name) + 1];
         strcpy(m_face_names[m_num_faces], font_name);
+        m_face_indices[m_num_faces] = face_index;
         m_cur_face = m_faces[m_num_faces];
         m_name = m_face_names[m_num_faces];
+        m_face_index = face_index;
+        m_cur_vars = new face_variation;
+        m_cur_vars->mm = 0;
+        m_cur_vars->num_coords = 0;
+        m_cur_vars->sized = false;
+        if (FT_HAS_MULTIPLE_MASTERS(m_cur_face) &&
+            FT_Get_MM_Var(m_cur_face, &m_cur_vars->mm) != 0) {
+          m_cur_vars->mm = 0;
+        }
+        m_face_vars[m_num_faces] = m_cur_vars;
         ++m_num_faces;
+        ++m_stats.faces_opened;
       } else {
+        ++m_stats.load_errors;
         m_face_names[m_num_faces] = 0;
         m_cur_face = 0;
         m_name = 0;
+        m_cur_vars = 0;
       }
     }
 
     if (m_last_error == 0) {
       ret = true;
 
+      if (ren_type == glyph_ren_sdf || ren_type == glyph_ren_outline_units) {
+        m_glyph_rendering =
+            FT_IS_SCALABLE(m_cur_face) ? ren_type : glyph_ren_native_gray8;
+      } else if (ren_type == glyph_ren_color) {
+        m_glyph_rendering =
+            FT_HAS_COLOR(m_cur_face) ? ren_type : glyph_ren_native_gray8;
+      }
       switch (ren_type) {
         case glyph_ren_native_mono:
           m_glyph_rendering = glyph_ren_native_mono;
@@ -596,7 +730,9 @@ bool font_engine_freetype_base::load_font(const char* font_name,
           }
           break;
       }
-      update_signature();
+      // Sets the signature too; the face may have been opened at another
+      // size, or at the reference size of glyph_ren_sdf
+      update_char_size();
     }
   }
   return ret;
@@ -619,6 +755,23 @@ unsigned font_engine_freetype_base::num_faces() const {
   return 0;
 }
 
+//------------------------------------------------------------------------
+unsigned font_engine_freetype_base::first_char(unsigned* glyph_index) const {
+  FT_UInt index = 0;
+  FT_ULong code = m_cur_face ? FT_Get_First_Char(m_cur_face, &index) : 0;
+  *glyph_index = index;
+  return unsigned(code);
+}
+
+//------------------------------------------------------------------------
+unsigned font_engine_freetype_base::next_char(unsigned code,
+                                              unsigned* glyph_index) const {
+  FT_UInt index = 0;
+  FT_ULong next = m_cur_face ? FT_Get_Next_Char(m_cur_face, code, &index) : 0;
+  *glyph_index = index;
+  return unsigned(next);
+}
+
 //------------------------------------------------------------------------
 bool font_engine_freetype_base::char_map(FT_Encoding char_map) {
   if (m_cur_face) {
@@ -652,13 +805,168 @@ bool font_engine_freetype_base::width(double w) {
 }
 
 //------------------------------------------------------------------------
-void font_engine_freetype_base::hinting(bool h) {
+bool font_engine_freetype_base::sdf_size(double height, double spread) {
+  m_sdf_height = height;
+  m_sdf_spread = spread > 0.0 ? spread : height / 8.0;
+  if (m_cur_face) {
+    update_char_size();
+    return true;
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------
+unsigned font_engine_freetype_base::num_axes() const {
+  if (m_cur_vars && m_cur_vars->mm) return m_cur_vars->mm->num_axis;
+  return 0;
+}
+
+//------------------------------------------------------------------------
+bool font_engine_freetype_base::axis_info(unsigned i, font_axis* axis) const {
+  if (i >= num_axes()) return false;
+  const FT_Var_Axis& a = m_cur_vars->mm->axis[i];
+  axis->tag = a.tag;
+  axis->minimum = a.minimum / 65536.0;
+  axis->def = a.def / 65536.0;
+  axis->maximum = a.maximum / 65536.0;
+  return true;
+}
+
+//------------------------------------------------------------------------
+double font_engine_freetype_base::axis(FT_ULong tag) const {
+  unsigned n = num_axes();
+  if (n > font_axis::max_axes) n = font_axis::max_axes;
+  FT_Fixed coords[font_axis::max_axes];
+  if (n == 0 || FT_Get_Var_Design_Coordinates(m_cur_face, n, coords) != 0) {
+    return 0.0;
+  }
+  for (unsigned i = 0; i < n; ++i) {
+    if (m_cur_vars->mm->axis[i].tag == tag) return coords[i] / 65536.0;
+  }
+  return 0.0;
+}
+
+//------------------------------------------------------------------------
+unsigned font_engine_freetype_base::axes(double* coords) const {
+  if (m_cur_vars == 0) return 0;
+  for (unsigned i = 0; i < m_cur_vars->num_coords; ++i) {
+    coords[i] = m_cur_vars->coords[i] / 65536.0;
+  }
+  return m_cur_vars->num_coords;
+}
+
+//------------------------------------------------------------------------
+bool font_engine_freetype_base::axis(FT_ULong tag, double value) {
+  unsigned n = num_axes();
+  if (n > font_axis::max_axes) n = font_axis::max_axes;
+  FT_Fixed coords[font_axis::max_axes];
+  if (n == 0) {
+    m_last_error = FT_Err_Invalid_Argument;
+    return false;
+  }
+  // The other axes keep the values of the current instance
+  m_last_error = FT_Get_Var_Design_Coordinates(m_cur_face, n, coords);
+  if (m_last_error != 0) return false;
+  for (unsigned i = 0; i < n; ++i) {
+    if (m_cur_vars->mm->axis[i].tag == tag) {
+      coords[i] = FT_Fixed(floor(value * 65536.0 + 0.5));
+      return set_axes(coords, n);
+    }
+  }
+  m_last_error = FT_Err_Invalid_Argument;
+  return false;
+}
+
+//------------------------------------------------------------------------
+bool font_engine_freetype_base::axes(const double* coords, unsigned num) {
+  unsigned n = num_axes();
+  if (n == 0) {
+    m_last_error = FT_Err_Invalid_Argument;
+    return false;
+  }
+  if (coords == 0) num = 0;
+  if (num > n) num = n;
+  if (num > font_axis::max_axes) num = font_axis::max_axes;
+  FT_Fixed fx[font_axis::max_axes];
+  for (unsigned i = 0; i < num; ++i) {
+    fx[i] = FT_Fixed(floor(coords[i] * 65536.0 + 0.5));
+  }
+  return set_axes(fx, num);
+}
+
+//------------------------------------------------------------------------
+// Make coords the instance of the current face, nothing to do when it is
+// already. No coordinates select the instance the face was opened with,
+// the default one or that of the named instance in its face_index.
+bool font_engine_freetype_base::set_axes(const FT_Fixed* coords,
+                                         unsigned num) {
+  if (num == m_cur_vars->num_coords &&
+      memcmp(coords, m_cur_vars->coords, num * sizeof(FT_Fixed)) == 0) {
+    return true;
+  }
+  if (num) {
+    m_last_error = FT_Set_Var_Design_Coordinates(m_cur_face, num,
+                                                 (FT_Fixed*)coords);
+  } else {
+    m_last_error = FT_Set_Named_Instance(m_cur_face, m_face_index >> 16);
+  }
+  if (m_last_error != 0) return false;
+  memcpy(m_cur_vars->coords, coords, num * sizeof(FT_Fixed));
+  m_cur_vars->num_coords = num;
+  // The size metrics vary with the instance
+  m_cur_vars->sized = false;
+  update_char_size();
+  return true;
+}
+
+//------------------------------------------------------------------------
+void font_engine_freetype_base::hinting(font_hinting_e h) {
   m_hinting = h;
   if (m_cur_face) {
     update_signature();
   }
 }
 
+//------------------------------------------------------------------------
+void font_engine_freetype_base::embolden(double strength) {
+  m_embolden = strength;
+  if (m_cur_face) {
+    update_signature();
+  }
+}
+
+//------------------------------------------------------------------------
+void font_engine_freetype_base::oblique(double slant) {
+  m_oblique = slant;
+  if (m_cur_face) {
+    update_signature();
+  }
+}
+
+//------------------------------------------------------------------------
+void font_engine_freetype_base::stroke(double width, line_join_e join,
+                                       double miter_limit) {
+  m_stroke_width = width > 0.0 ? width : 0.0;
+  m_stroke_join = join;
+  m_stroke_miter_limit = miter_limit;
+  m_stroke16.width(m_stroke_width);
+  m_stroke16.line_join(join);
+  m_stroke16.miter_limit(miter_limit);
+  m_stroke32.width(m_stroke_width);
+  m_stroke32.line_join(join);
+  m_stroke32.miter_limit(miter_limit);
+  if (m_cur_face) {
+    update_signature();
+  }
+}
+
+//------------------------------------------------------------------------
+bool font_engine_freetype_base::stroked() const {
+  return m_stroke_width > 0.0 && (m_glyph_rendering == glyph_ren_outline ||
+                                  m_glyph_rendering == glyph_ren_agg_mono ||
+                                  m_glyph_rendering == glyph_ren_agg_gray8);
+}
+
 //------------------------------------------------------------------------
 void font_engine_freetype_base::flip_y(bool f) {
   m_flip_y = f;
@@ -681,7 +989,7 @@ void font_engine_freetype_base::update_signature() {
     unsigned name_len = strlen(m_name);
     if (name_len > m_name_len) {
       delete[] m_signature;
-      m_signature = new char[name_len + 32 + 256];
+      m_signature = new char[name_len + 32 + 512];
       m_name_len = name_len + 32 - 1;
     }
 
@@ -697,9 +1005,28 @@ void font_engine_freetype_base::update_signature() {
       gamma_hash = calc_crc32(gamma_table, sizeof(gamma_table));
     }
 
+    // Distance fields are made at the reference size, unhinted, whatever
+    // size they are drawn at, outlines in font units at no size at all
+    unsigned resolution = m_resolution;
+    unsigned height = m_height;
+    unsigned width = m_width;
+    font_hinting_e hinting = m_hinting;
+    if (m_glyph_rendering == glyph_ren_sdf) {
+      height = unsigned(m_sdf_height * 64.0);
+      width = 0;
+      hinting = font_hinting_none;
+    } else if (m_glyph_rendering == glyph_ren_outline_units) {
+      resolution = height = width = 0;
+      hinting = font_hinting_none;
+    } else if (m_color_strike > 0.0) {
+      // Any size drawn from the same strike
+      resolution = width = 0;
+      height = unsigned(m_color_strike * 64.0);
+    }
+
     sprintf(m_signature, "%s,%u,%d,%d,%d:%dx%d,%d,%d,%08X", m_name, m_char_map,
-            m_face_index, int(m_glyph_rendering), m_resolution, m_height,
-            m_width, int(m_hinting), int(m_flip_y), gamma_hash);
+            m_face_index, int(m_glyph_rendering), resolution, height, width,
+            int(hinting), int(m_flip_y), gamma_hash);
     if (m_glyph_rendering == glyph_ren_outline ||
         m_glyph_rendering == glyph_ren_agg_mono ||
         m_glyph_rendering == glyph_ren_agg_gray8) {
@@ -712,183 +1039,602 @@ void font_engine_freetype_base::update_signature() {
               dbl_to_plain_fx(mtx[5]));
       strcat(m_signature, buf);
     }
+    if (m_glyph_rendering == glyph_ren_sdf) {
+      char buf[32];
+      sprintf(buf, ",sdf%08X", dbl_to_plain_fx(m_sdf_spread));
+      strcat(m_signature, buf);
+    }
+    if (stroked()) {
+      char buf[64];
+      sprintf(buf, ",s%08X,%d,%08X", dbl_to_plain_fx(m_stroke_width),
+              int(m_stroke_join), dbl_to_plain_fx(m_stroke_miter_limit));
+      strcat(m_signature, buf);
+    }
+    if (m_embolden != 0.0 || m_oblique != 0.0) {
+      char buf[64];
+      sprintf(buf, ",b%ld,o%08X", long(embolden_strength()),
+              dbl_to_plain_fx(m_oblique));
+      strcat(m_signature, buf);
+    }
+    if (m_cur_vars && m_cur_vars->num_coords) {
+      char buf[16];
+      for (unsigned i = 0; i < m_cur_vars->num_coords; ++i) {
+        sprintf(buf, i ? ",%08X" : ",v%08X",
+                unsigned(m_cur_vars->coords[i]));
+        strcat(m_signature, buf);
+      }
+    }
     ++m_change_stamp;
+    ++m_stats.signature_updates;
   }
 }
 
 //------------------------------------------------------------------------
+// Set the size on the face unless it already has it, as it does when
+// load_font() switches back to a face
 void font_engine_freetype_base::update_char_size() {
   if (m_cur_face) {
-    if (m_resolution) {
+    unsigned height = m_height;
+    unsigned width = m_width;
+    if (m_glyph_rendering == glyph_ren_sdf) {
+      height = unsigned(m_sdf_height * 64.0);
+      width = 0;
+    }
+    bool strike = m_glyph_rendering == glyph_ren_color &&
+                  !FT_IS_SCALABLE(m_cur_face) &&
+                  m_cur_face->num_fixed_sizes > 0;
+    face_variation& v = *m_cur_vars;
+    if (v.sized && v.size_strike == strike && v.size_width == width &&
+        v.size_height == height && v.size_resolution == m_resolution) {
+      m_color_strike = v.color_strike;
+      update_signature();
+      return;
+    }
+
+    AGG_FONT_TIMING_BEGIN(t_size);
+    m_color_strike = 0.0;
+    if (strike) {
+      select_color_strike();
+    } else if (m_resolution) {
       FT_Set_Char_Size(m_cur_face,
-                       m_width,        // char_width in 1/64th of points
-                       m_height,       // char_height in 1/64th of points
+                       width,          // char_width in 1/64th of points
+                       height,         // char_height in 1/64th of points
                        m_resolution,   // horizontal device resolution
                        m_resolution);  // vertical device resolution
     } else {
       FT_Set_Pixel_Sizes(m_cur_face,
-                         m_width >> 6,    // pixel_width
-                         m_height >> 6);  // pixel_height
+                         width >> 6,    // pixel_width
+                         height >> 6);  // pixel_height
     }
+    AGG_FONT_TIMING_END(t_size, font_timing_set_size);
+    ++m_stats.size_changes;
+    v.sized = true;
+    v.size_strike = strike;
+    v.size_width = width;
+    v.size_height = height;
+    v.size_resolution = m_resolution;
+    v.color_strike = m_color_strike;
     update_signature();
   }
 }
 
+//------------------------------------------------------------------------
+// Bitmap color fonts only have fixed sizes: select the smallest strike
+// not smaller than height(), or the largest, to be scaled when drawn.
+void font_engine_freetype_base::select_color_strike() {
+  double px = height();
+  if (m_resolution) px *= m_resolution / 72.0;
+  int best = -1;
+  for (int i = 0; i < m_cur_face->num_fixed_sizes; ++i) {
+    double size = m_cur_face->available_sizes[i].y_ppem / 64.0;
+    if (best < 0) {
+      best = i;
+      continue;
+    }
+    // Larger while the best is too small, else smaller but large enough
+    double best_size = m_cur_face->available_sizes[best].y_ppem / 64.0;
+    bool better = best_size < px ? size > best_size
+                                 : size >= px && size < best_size;
+    if (better) best = i;
+  }
+  m_last_error = FT_Select_Size(m_cur_face, best);
+  if (m_last_error == 0) {
+    m_color_strike = m_cur_face->available_sizes[best].y_ppem / 64.0;
+  }
+}
+
+//------------------------------------------------------------------------
+double font_engine_freetype_base::color_scale() const {
+  if (m_color_strike <= 0.0) return 1.0;
+  double px = height();
+  if (m_resolution) px *= m_resolution / 72.0;
+  return px / m_color_strike;
+}
+
+//------------------------------------------------------------------------
+FT_Int32 font_engine_freetype_base::load_flags() const {
+  // Distance fields and font units outlines are scaled when drawn, hints
+  // for the size they are made at would not fit
+  if (m_glyph_rendering == glyph_ren_sdf) {
+    return FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP;
+  }
+  if (m_glyph_rendering == glyph_ren_outline_units) {
+    return FT_LOAD_NO_SCALE | FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP;
+  }
+  FT_Int32 flags = FT_LOAD_NO_HINTING;
+  switch (m_hinting) {
+    case font_hinting_light:
+      flags = FT_LOAD_TARGET_LIGHT;
+      break;
+    case font_hinting_native:
+      flags = FT_LOAD_DEFAULT;
+      break;
+    case font_hinting_autohint:
+      flags = FT_LOAD_FORCE_AUTOHINT;
+      break;
+    default:
+      break;
+  }
+  if (m_glyph_rendering == glyph_ren_color) {
+    // Color glyphs are bitmaps, they are not given synthetic styles
+    flags |= FT_LOAD_COLOR;
+  } else if (m_embolden != 0.0 || m_oblique != 0.0) {
+    // Synthetic styles need the outline, not an embedded bitmap
+    flags |= FT_LOAD_NO_BITMAP;
+  }
+  return flags;
+}
+
+//------------------------------------------------------------------------
+// embolden() strength in the units of the loaded outline: 26.6 pixels
+// at the size the glyphs are made at, or font units.
+FT_Pos font_engine_freetype_base::embolden_strength() const {
+  double strength = m_embolden * 64.0;
+  if (m_glyph_rendering == glyph_ren_outline_units) {
+    double sx = units_matrix().sx;
+    strength = sx > 0.0 ? m_embolden / sx : 0.0;
+  } else if (m_glyph_rendering == glyph_ren_sdf && m_height) {
+    strength *= m_sdf_height / height();
+  }
+  return FT_Pos(floor(strength + 0.5));
+}
+
+//------------------------------------------------------------------------
+// Apply embolden() and oblique() to the outline in the slot, updating
+// its advance and metrics as FT_GlyphSlot_Embolden() does.
+void font_engine_freetype_base::synthesize_style() {
+  FT_GlyphSlot slot = m_cur_face->glyph;
+  if (slot->format != FT_GLYPH_FORMAT_OUTLINE) return;
+  if (m_embolden == 0.0 && m_oblique == 0.0) return;
+
+  FT_Pos strength = embolden_strength();
+  if (strength) {
+    FT_Outline_EmboldenXY(&slot->outline, strength, 0);
+    slot->advance.x += strength;
+    slot->linearHoriAdvance += strength << 10;
+    slot->metrics.horiAdvance += strength;
+  }
+  if (m_oblique != 0.0) {
+    FT_Matrix shear;
+    shear.xx = 0x10000L;
+    shear.xy = FT_Fixed(floor(m_oblique * 65536.0 + 0.5));
+    shear.yx = 0;
+    shear.yy = 0x10000L;
+    FT_Outline_Transform(&slot->outline, &shear);
+  }
+  FT_BBox cbox;
+  FT_Outline_Get_CBox(&slot->outline, &cbox);
+  slot->metrics.horiBearingX = cbox.xMin;
+  slot->metrics.horiBearingY = cbox.yMax;
+  slot->metrics.width = cbox.xMax - cbox.xMin;
+  slot->metrics.height = cbox.yMax - cbox.yMin;
+}
+
+//------------------------------------------------------------------------
+// Advance of the glyph in the slot. With light hinting the horizontal
+// advance is the unhinted one, not rounded to whole pixels.
+void font_engine_freetype_base::update_advance() {
+  const FT_GlyphSlot slot = m_cur_face->glyph;
+  if (m_hinting == font_hinting_light) {
+    m_advance_x = slot->linearHoriAdvance / 65536.0;
+  } else {
+    m_advance_x = int26p6_to_dbl(slot->advance.x);
+  }
+  m_advance_y = int26p6_to_dbl(slot->advance.y);
+}
+
 //------------------------------------------------------------------------
 bool font_engine_freetype_base::prepare_glyph(unsigned glyph_code) {
   m_glyph_index = FT_Get_Char_Index(m_cur_face, glyph_code);
-  // For hinting FT_LOAD_DEFAULT could be used but it gives severe
-  // visual artefacts when scaling fonts x100 along X like
-  // done by AGG.
-  m_last_error =
-      FT_Load_Glyph(m_cur_face, m_glyph_index,
-                    m_hinting ? FT_LOAD_FORCE_AUTOHINT : FT_LOAD_NO_HINTING);
-  if (m_last_error == 0) {
-    switch (m_glyph_rendering) {
-      case glyph_ren_native_mono:
-        m_last_error = FT_Render_Glyph(m_cur_face->glyph, FT_RENDER_MODE_MONO);
-        if (m_last_error == 0) {
-          decompose_ft_bitmap_mono(m_cur_face->glyph->bitmap,
-                                   m_cur_face->glyph->bitmap_left,
-                                   m_flip_y ? -m_cur_face->glyph->bitmap_top
-                                            : m_cur_face->glyph->bitmap_top,
-                                   m_flip_y, m_scanline_bin, m_scanlines_bin);
-          m_bounds.x1 = m_scanlines_bin.min_x();
-          m_bounds.y1 = m_scanlines_bin.min_y();
-          m_bounds.x2 = m_scanlines_bin.max_x() + 1;
-          m_bounds.y2 = m_scanlines_bin.max_y() + 1;
-          m_data_size = m_scanlines_bin.byte_size();
-          m_data_type = glyph_data_mono;
-          m_advance_x = int26p6_to_dbl(m_cur_face->glyph->advance.x);
-          m_advance_y = int26p6_to_dbl(m_cur_face->glyph->advance.y);
-          return true;
-        }
-        break;
+  AGG_FONT_TIMING_BEGIN(t_load);
+  m_last_error = FT_Load_Glyph(m_cur_face, m_glyph_index, load_flags());
+  AGG_FONT_TIMING_END(t_load, font_timing_load_glyph);
+  if (m_last_error != 0) {
+    ++m_stats.load_errors;
+    return false;
+  }
+  synthesize_style();
+  if (!render_glyph()) {
+    ++m_stats.render_errors;
+    return false;
+  }
+  ++m_stats.glyphs_prepared[m_glyph_rendering];
+  m_stats.bytes_prepared += m_data_size;
+  return true;
+}
 
-      case glyph_ren_native_gray8:
-        m_last_error =
-            FT_Render_Glyph(m_cur_face->glyph, FT_RENDER_MODE_NORMAL);
-        if (m_last_error == 0) {
-          decompose_ft_bitmap_gray8(
-              m_cur_face->glyph->bitmap, m_cur_face->glyph->bitmap_left,
-              m_flip_y ? -m_cur_face->glyph->bitmap_top
-                       : m_cur_face->glyph->bitmap_top,
-              m_flip_y, m_rasterizer, m_scanline_aa, m_scanlines_aa);
-          m_bounds.x1 = m_scanlines_aa.min_x();
-          m_bounds.y1 = m_scanlines_aa.min_y();
-          m_bounds.x2 = m_scanlines_aa.max_x() + 1;
-          m_bounds.y2 = m_scanlines_aa.max_y() + 1;
-          m_data_size = m_scanlines_aa.byte_size();
-          m_data_type = glyph_data_gray8;
-          m_advance_x = int26p6_to_dbl(m_cur_face->glyph->advance.x);
-          m_advance_y = int26p6_to_dbl(m_cur_face->glyph->advance.y);
-          return true;
-        }
-        break;
+//------------------------------------------------------------------------
+// Convert the glyph loaded in the current face's slot to the cached form
+bool font_engine_freetype_base::render_glyph() {
+  if (m_glyph_rendering == glyph_ren_sdf) return render_sdf_glyph();
+  if (m_glyph_rendering == glyph_ren_outline_units) {
+    return render_units_glyph();
+  }
+  if (m_glyph_rendering == glyph_ren_color) return render_color_glyph();
+  switch (m_glyph_rendering) {
+    case glyph_ren_native_mono: {
+      AGG_FONT_TIMING_BEGIN(t_render);
+      m_last_error = FT_Render_Glyph(m_cur_face->glyph, FT_RENDER_MODE_MONO);
+      AGG_FONT_TIMING_END(t_render, font_timing_render_bitmap);
+      if (m_last_error == 0) {
+        AGG_FONT_TIMING_BEGIN(t_decompose);
+        decompose_ft_bitmap_mono(m_cur_face->glyph->bitmap,
+                                 m_cur_face->glyph->bitmap_left,
+                                 m_flip_y ? -m_cur_face->glyph->bitmap_top
+                                          : m_cur_face->glyph->bitmap_top,
+                                 m_flip_y, m_scanline_bin, m_scanlines_bin);
+        AGG_FONT_TIMING_END(t_decompose, font_timing_decompose);
+        m_bounds.x1 = m_scanlines_bin.min_x();
+        m_bounds.y1 = m_scanlines_bin.min_y();
+        m_bounds.x2 = m_scanlines_bin.max_x() + 1;
+        m_bounds.y2 = m_scanlines_bin.max_y() + 1;
+        m_data_size = m_scanlines_bin.byte_size();
+        m_data_type = glyph_data_mono;
+        update_advance();
+        return true;
+      }
+    } break;
 
-      case glyph_ren_outline:
-        if (m_last_error == 0) {
-          if (m_flag32) {
-            m_path32.remove_all();
-            if (decompose_ft_outline(m_cur_face->glyph->outline, m_flip_y,
-                                     m_affine, m_path32)) {
-              rect_d bnd = m_path32.bounding_rect();
-              m_data_size = m_path32.byte_size();
-              m_data_type = glyph_data_outline;
-              m_bounds.x1 = int(floor(bnd.x1));
-              m_bounds.y1 = int(floor(bnd.y1));
-              m_bounds.x2 = int(ceil(bnd.x2));
-              m_bounds.y2 = int(ceil(bnd.y2));
-              m_advance_x = int26p6_to_dbl(m_cur_face->glyph->advance.x);
-              m_advance_y = int26p6_to_dbl(m_cur_face->glyph->advance.y);
-              m_affine.transform(&m_advance_x, &m_advance_y);
-              return true;
-            }
-          } else {
-            m_path16.remove_all();
-            if (decompose_ft_outline(m_cur_face->glyph->outline, m_flip_y,
-                                     m_affine, m_path16)) {
-              rect_d bnd = m_path16.bounding_rect();
-              m_data_size = m_path16.byte_size();
-              m_data_type = glyph_data_outline;
-              m_bounds.x1 = int(floor(bnd.x1));
-              m_bounds.y1 = int(floor(bnd.y1));
-              m_bounds.x2 = int(ceil(bnd.x2));
-              m_bounds.y2 = int(ceil(bnd.y2));
-              m_advance_x = int26p6_to_dbl(m_cur_face->glyph->advance.x);
-              m_advance_y = int26p6_to_dbl(m_cur_face->glyph->advance.y);
-              m_affine.transform(&m_advance_x, &m_advance_y);
-              return true;
-            }
-          }
+    case glyph_ren_native_gray8: {
+      AGG_FONT_TIMING_BEGIN(t_render);
+      m_last_error = FT_Render_Glyph(m_cur_face->glyph, FT_RENDER_MODE_NORMAL);
+      AGG_FONT_TIMING_END(t_render, font_timing_render_bitmap);
+      if (m_last_error == 0) {
+        AGG_FONT_TIMING_BEGIN(t_decompose);
+        decompose_ft_bitmap_gray8(
+            m_cur_face->glyph->bitmap, m_cur_face->glyph->bitmap_left,
+            m_flip_y ? -m_cur_face->glyph->bitmap_top
+                     : m_cur_face->glyph->bitmap_top,
+            m_flip_y, m_rasterizer, m_scanline_aa, m_scanlines_aa);
+        AGG_FONT_TIMING_END(t_decompose, font_timing_decompose);
+        m_bounds.x1 = m_scanlines_aa.min_x();
+        m_bounds.y1 = m_scanlines_aa.min_y();
+        m_bounds.x2 = m_scanlines_aa.max_x() + 1;
+        m_bounds.y2 = m_scanlines_aa.max_y() + 1;
+        m_data_size = m_scanlines_aa.byte_size();
+        m_data_type = glyph_data_gray8;
+        update_advance();
+        return true;
+      }
+    } break;
+
+    case glyph_ren_outline: {
+      AGG_FONT_TIMING_BEGIN(t_decompose);
+      rect_d bnd;
+      if (m_flag32) {
+        m_path32.remove_all();
+        if (!decompose_ft_outline(m_cur_face->glyph->outline, m_flip_y,
+                                  m_affine, m_path32)) {
+          return false;
         }
-        return false;
-
-      case glyph_ren_agg_mono:
-        if (m_last_error == 0) {
-          m_rasterizer.reset();
-          if (m_flag32) {
-            m_path32.remove_all();
-            decompose_ft_outline(m_cur_face->glyph->outline, m_flip_y, m_affine,
-                                 m_path32);
-            m_rasterizer.add_path(m_curves32);
-          } else {
-            m_path16.remove_all();
-            decompose_ft_outline(m_cur_face->glyph->outline, m_flip_y, m_affine,
-                                 m_path16);
-            m_rasterizer.add_path(m_curves16);
-          }
-          m_scanlines_bin.prepare();  // Remove all
-          render_scanlines(m_rasterizer, m_scanline_bin, m_scanlines_bin);
-          m_bounds.x1 = m_scanlines_bin.min_x();
-          m_bounds.y1 = m_scanlines_bin.min_y();
-          m_bounds.x2 = m_scanlines_bin.max_x() + 1;
-          m_bounds.y2 = m_scanlines_bin.max_y() + 1;
-          m_data_size = m_scanlines_bin.byte_size();
-          m_data_type = glyph_data_mono;
-          m_advance_x = int26p6_to_dbl(m_cur_face->glyph->advance.x);
-          m_advance_y = int26p6_to_dbl(m_cur_face->glyph->advance.y);
-          m_affine.transform(&m_advance_x, &m_advance_y);
-          return true;
+        if (stroked()) {
+          store_stroke(m_stroke32, m_stroked32);
+          bnd = m_stroked32.bounding_rect();
+          m_data_size = m_stroked32.byte_size();
+        } else {
+          bnd = m_path32.bounding_rect();
+          m_data_size = m_path32.byte_size();
+        }
+      } else {
+        m_path16.remove_all();
+        if (!decompose_ft_outline(m_cur_face->glyph->outline, m_flip_y,
+                                  m_affine, m_path16)) {
+          return false;
         }
-        return false;
+        if (stroked()) {
+          store_stroke(m_stroke16, m_stroked16);
+          bnd = m_stroked16.bounding_rect();
+          m_data_size = m_stroked16.byte_size();
+        } else {
+          bnd = m_path16.bounding_rect();
+          m_data_size = m_path16.byte_size();
+        }
+      }
+      AGG_FONT_TIMING_END(t_decompose, font_timing_decompose);
+      m_data_type = glyph_data_outline;
+      m_bounds.x1 = int(floor(bnd.x1));
+      m_bounds.y1 = int(floor(bnd.y1));
+      m_bounds.x2 = int(ceil(bnd.x2));
+      m_bounds.y2 = int(ceil(bnd.y2));
+      update_advance();
+      m_affine.transform(&m_advance_x, &m_advance_y);
+      return true;
+    }
 
-      case glyph_ren_agg_gray8:
-        if (m_last_error == 0) {
-          m_rasterizer.reset();
-          if (m_flag32) {
-            m_path32.remove_all();
-            decompose_ft_outline(m_cur_face->glyph->outline, m_flip_y, m_affine,
-                                 m_path32);
-            m_rasterizer.add_path(m_curves32);
-          } else {
-            m_path16.remove_all();
-            decompose_ft_outline(m_cur_face->glyph->outline, m_flip_y, m_affine,
-                                 m_path16);
-            m_rasterizer.add_path(m_curves16);
-          }
-          m_scanlines_aa.prepare();  // Remove all
-          render_scanlines(m_rasterizer, m_scanline_aa, m_scanlines_aa);
-          m_bounds.x1 = m_scanlines_aa.min_x();
-          m_bounds.y1 = m_scanlines_aa.min_y();
-          m_bounds.x2 = m_scanlines_aa.max_x() + 1;
-          m_bounds.y2 = m_scanlines_aa.max_y() + 1;
-          m_data_size = m_scanlines_aa.byte_size();
-          m_data_type = glyph_data_gray8;
-          m_advance_x = int26p6_to_dbl(m_cur_face->glyph->advance.x);
-          m_advance_y = int26p6_to_dbl(m_cur_face->glyph->advance.y);
-          m_affine.transform(&m_advance_x, &m_advance_y);
-          return true;
+    case glyph_ren_agg_mono:
+    case glyph_ren_agg_gray8: {
+      AGG_FONT_TIMING_BEGIN(t_decompose);
+      if (m_flag32) {
+        m_path32.remove_all();
+        decompose_ft_outline(m_cur_face->glyph->outline, m_flip_y, m_affine,
+                             m_path32);
+      } else {
+        m_path16.remove_all();
+        decompose_ft_outline(m_cur_face->glyph->outline, m_flip_y, m_affine,
+                             m_path16);
+      }
+      AGG_FONT_TIMING_END(t_decompose, font_timing_decompose);
+
+      AGG_FONT_TIMING_BEGIN(t_rasterize);
+      m_rasterizer.reset();
+      if (stroked()) {
+        if (m_flag32) {
+          m_rasterizer.add_path(m_stroke32);
+        } else {
+          m_rasterizer.add_path(m_stroke16);
         }
-        return false;
+      } else if (m_flag32) {
+        m_rasterizer.add_path(m_curves32);
+      } else {
+        m_rasterizer.add_path(m_curves16);
+      }
+      if (m_glyph_rendering == glyph_ren_agg_mono) {
+        m_scanlines_bin.prepare();  // Remove all
+        render_scanlines(m_rasterizer, m_scanline_bin, m_scanlines_bin);
+        m_bounds.x1 = m_scanlines_bin.min_x();
+        m_bounds.y1 = m_scanlines_bin.min_y();
+        m_bounds.x2 = m_scanlines_bin.max_x() + 1;
+        m_bounds.y2 = m_scanlines_bin.max_y() + 1;
+        m_data_size = m_scanlines_bin.byte_size();
+        m_data_type = glyph_data_mono;
+      } else {
+        m_scanlines_aa.prepare();  // Remove all
+        render_scanlines(m_rasterizer, m_scanline_aa, m_scanlines_aa);
+        m_bounds.x1 = m_scanlines_aa.min_x();
+        m_bounds.y1 = m_scanlines_aa.min_y();
+        m_bounds.x2 = m_scanlines_aa.max_x() + 1;
+        m_bounds.y2 = m_scanlines_aa.max_y() + 1;
+        m_data_size = m_scanlines_aa.byte_size();
+        m_data_type = glyph_data_gray8;
+      }
+      AGG_FONT_TIMING_END(t_rasterize, font_timing_rasterize);
+      update_advance();
+      m_affine.transform(&m_advance_x, &m_advance_y);
+      return true;
     }
   }
   return false;
 }
 
+//------------------------------------------------------------------------
+// Distance field of the outline at the reference size. The outline is
+// decomposed as for glyph_ren_outline, untransformed, and flattened.
+bool font_engine_freetype_base::render_sdf_glyph() {
+  AGG_FONT_TIMING_BEGIN(t_decompose);
+  m_path32.remove_all();
+  if (!decompose_ft_outline(m_cur_face->glyph->outline, m_flip_y,
+                            trans_affine(), m_path32)) {
+    return false;
+  }
+  AGG_FONT_TIMING_END(t_decompose, font_timing_decompose);
+
+  AGG_FONT_TIMING_BEGIN(t_rasterize);
+  m_sdf.reset();
+  m_sdf.add_path(m_curves32);
+  m_bounds = m_sdf.bounds(m_sdf_spread);
+  m_data_size = 0;
+  if (m_bounds.x1 < m_bounds.x2) {
+    m_data_size = unsigned(m_bounds.x2 - m_bounds.x1) *
+                  unsigned(m_bounds.y2 - m_bounds.y1);
+    m_sdf_data.allocate(m_data_size);
+    m_sdf.build(&m_sdf_data[0], m_bounds, m_sdf_spread);
+  }
+  AGG_FONT_TIMING_END(t_rasterize, font_timing_rasterize);
+  m_data_type = glyph_data_invalid;
+  update_advance();
+  return true;
+}
+
+//------------------------------------------------------------------------
+// Unscaled outline, loaded with FT_LOAD_NO_SCALE. Its points are font
+// units, taken as 26.6 values by decompose_ft_outline(), so the bounds
+// and the advances are scaled back to font units.
+bool font_engine_freetype_base::render_units_glyph() {
+  AGG_FONT_TIMING_BEGIN(t_decompose);
+  rect_d bnd;
+  if (m_flag32) {
+    m_path32.remove_all();
+    if (!decompose_ft_outline(m_cur_face->glyph->outline, m_flip_y,
+                              trans_affine(), m_path32)) {
+      return false;
+    }
+    bnd = m_path32.bounding_rect();
+    m_data_size = m_path32.byte_size();
+  } else {
+    m_path16.remove_all();
+    if (!decompose_ft_outline(m_cur_face->glyph->outline, m_flip_y,
+                              trans_affine(), m_path16)) {
+      return false;
+    }
+    bnd = m_path16.bounding_rect();
+    m_data_size = m_path16.byte_size();
+  }
+  AGG_FONT_TIMING_END(t_decompose, font_timing_decompose);
+  m_data_type = glyph_data_outline;
+  m_bounds.x1 = int(floor(bnd.x1 * outline_units_scale));
+  m_bounds.y1 = int(floor(bnd.y1 * outline_units_scale));
+  m_bounds.x2 = int(ceil(bnd.x2 * outline_units_scale));
+  m_bounds.y2 = int(ceil(bnd.y2 * outline_units_scale));
+  m_advance_x = m_cur_face->glyph->advance.x;
+  m_advance_y = m_cur_face->glyph->advance.y;
+  return true;
+}
+
+//------------------------------------------------------------------------
+// Glyph loaded with FT_LOAD_COLOR. Color bitmaps, embedded or rendered
+// from color layers, are copied as they are, premultiplied BGRA, with
+// the rows in order of increasing y; other glyphs are rendered as for
+// glyph_ren_native_gray8.
+bool font_engine_freetype_base::render_color_glyph() {
+  FT_GlyphSlot slot = m_cur_face->glyph;
+  if (slot->format != FT_GLYPH_FORMAT_BITMAP) {
+    AGG_FONT_TIMING_BEGIN(t_render);
+    m_last_error = FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
+    AGG_FONT_TIMING_END(t_render, font_timing_render_bitmap);
+    if (m_last_error != 0) return false;
+  }
+  const FT_Bitmap& bitmap = slot->bitmap;
+  int top = m_flip_y ? -slot->bitmap_top : slot->bitmap_top;
+
+  AGG_FONT_TIMING_BEGIN(t_decompose);
+  if (bitmap.pixel_mode == FT_PIXEL_MODE_BGRA) {
+    unsigned w = bitmap.width;
+    unsigned h = bitmap.rows;
+    m_bounds.x1 = slot->bitmap_left;
+    m_bounds.x2 = slot->bitmap_left + int(w);
+    m_bounds.y1 = m_flip_y ? top : top - int(h);
+    m_bounds.y2 = m_bounds.y1 + int(h);
+    m_data_size = w * h * 4;
+    if (m_data_size) {
+      m_color_data.allocate(m_data_size);
+      for (unsigned i = 0; i < h; ++i) {
+        unsigned row = m_flip_y ? i : h - 1 - i;
+        memcpy(&m_color_data[i * w * 4], bitmap.buffer + row * bitmap.pitch,
+               w * 4);
+      }
+    }
+    m_data_type = glyph_data_invalid;
+  } else if (bitmap.pixel_mode == FT_PIXEL_MODE_GRAY) {
+    decompose_ft_bitmap_gray8(bitmap, slot->bitmap_left, top, m_flip_y,
+                              m_rasterizer, m_scanline_aa, m_scanlines_aa);
+    m_bounds.x1 = m_scanlines_aa.min_x();
+    m_bounds.y1 = m_scanlines_aa.min_y();
+    m_bounds.x2 = m_scanlines_aa.max_x() + 1;
+    m_bounds.y2 = m_scanlines_aa.max_y() + 1;
+    m_data_size = m_scanlines_aa.byte_size();
+    m_data_type = glyph_data_gray8;
+  } else {
+    return false;
+  }
+  AGG_FONT_TIMING_END(t_decompose, font_timing_decompose);
+  update_advance();
+  return true;
+}
+
+//------------------------------------------------------------------------
+bool font_engine_freetype_base::prepare_glyph_metrics(unsigned glyph_code,
+                                                      bool advance_only) {
+  m_glyph_index = FT_Get_Char_Index(m_cur_face, glyph_code);
+  bool transformed = m_glyph_rendering == glyph_ren_outline ||
+                     m_glyph_rendering == glyph_ren_agg_mono ||
+                     m_glyph_rendering == glyph_ren_agg_gray8;
+  // Outline modes never use embedded bitmaps, so skip loading them; the
+  // native modes keep them to report the metrics prepare_glyph() would.
+  FT_Int32 flags = load_flags();
+  if (transformed) flags |= FT_LOAD_NO_BITMAP;
+  bool units = m_glyph_rendering == glyph_ren_outline_units;
+  m_data_size = 0;
+  m_data_type = glyph_data_invalid;
+
+  if (advance_only) {
+    // The unhinted advance of light hinting is the one of no hinting
+    bool light = m_hinting == font_hinting_light && !units &&
+                 m_glyph_rendering != glyph_ren_sdf;
+    if (light) flags = FT_LOAD_NO_HINTING;
+    FT_Fixed advance;
+    m_last_error = FT_Get_Advance(m_cur_face, m_glyph_index,
+                                  flags | FT_LOAD_ADVANCE_ONLY, &advance);
+    if (m_last_error != 0) {
+      ++m_stats.load_errors;
+      return false;
+    }
+    m_bounds = rect_i(1, 1, 0, 0);
+    // 16.16 advance, rounded to 26.6 like the one of a loaded glyph,
+    // unless unscaled or unhinted
+    if (units) {
+      m_advance_x = double(advance);
+    } else if (light) {
+      m_advance_x = advance / 65536.0;
+    } else {
+      m_advance_x = int26p6_to_dbl(int((advance + 512) >> 10));
+    }
+    // As widened by synthesize_style()
+    if (m_embolden != 0.0 && FT_IS_SCALABLE(m_cur_face)) {
+      FT_Pos strength = embolden_strength();
+      m_advance_x += units ? double(strength) : int26p6_to_dbl(strength);
+    }
+    m_advance_y = 0.0;
+    if (transformed) m_affine.transform(&m_advance_x, &m_advance_y);
+    ++m_stats.metrics_prepared;
+    return true;
+  }
+
+  m_last_error = FT_Load_Glyph(m_cur_face, m_glyph_index, flags);
+  if (m_last_error != 0) {
+    ++m_stats.load_errors;
+    return false;
+  }
+  synthesize_style();
+
+  const FT_Glyph_Metrics& gm = m_cur_face->glyph->metrics;
+  double x[4], y[4];
+  x[0] = x[3] = int26p6_to_dbl(gm.horiBearingX);
+  x[1] = x[2] = int26p6_to_dbl(gm.horiBearingX + gm.width);
+  y[0] = y[1] = int26p6_to_dbl(gm.horiBearingY - gm.height);
+  y[2] = y[3] = int26p6_to_dbl(gm.horiBearingY);
+  rect_d bnd(1e30, 1e30, -1e30, -1e30);
+  for (unsigned i = 0; i < 4; ++i) {
+    if (m_flip_y) y[i] = -y[i];
+    if (transformed) m_affine.transform(&x[i], &y[i]);
+    if (units) {
+      x[i] *= outline_units_scale;
+      y[i] *= outline_units_scale;
+    }
+    if (x[i] < bnd.x1) bnd.x1 = x[i];
+    if (y[i] < bnd.y1) bnd.y1 = y[i];
+    if (x[i] > bnd.x2) bnd.x2 = x[i];
+    if (y[i] > bnd.y2) bnd.y2 = y[i];
+  }
+  if (stroked()) {
+    // The stroke reaches half its width out, or up to the miter limit
+    double d = m_stroke_width * 0.5;
+    if (m_stroke_join != round_join && m_stroke_join != bevel_join) {
+      d *= m_stroke_miter_limit;
+    }
+    bnd.x1 -= d;
+    bnd.y1 -= d;
+    bnd.x2 += d;
+    bnd.y2 += d;
+  }
+  m_bounds.x1 = int(floor(bnd.x1));
+  m_bounds.y1 = int(floor(bnd.y1));
+  m_bounds.x2 = int(ceil(bnd.x2));
+  m_bounds.y2 = int(ceil(bnd.y2));
+  if (units) {
+    m_advance_x = m_cur_face->glyph->advance.x;
+    m_advance_y = m_cur_face->glyph->advance.y;
+  } else {
+    update_advance();
+  }
+  if (transformed) m_affine.transform(&m_advance_x, &m_advance_y);
+  ++m_stats.metrics_prepared;
+  return true;
+}
+
 //------------------------------------------------------------------------
 void font_engine_freetype_base::write_glyph_to(int8u* data) const {
   if (data && m_data_size) {
+    AGG_FONT_TIMING_BEGIN(t_serialize);
     switch (m_data_type) {
       default:
         return;
@@ -899,15 +1645,55 @@ void font_engine_freetype_base::write_glyph_to(int8u* data) const {
         m_scanlines_aa.serialize(data);
         break;
       case glyph_data_outline:
-        if (m_flag32) {
+        if (stroked()) {
+          if (m_flag32) {
+            m_stroked32.serialize(data);
+          } else {
+            m_stroked16.serialize(data);
+          }
+        } else if (m_flag32) {
           m_path32.serialize(data);
         } else {
           m_path16.serialize(data);
         }
         break;
       case glyph_data_invalid:
+        // Only distance fields and color glyphs have data without a data
+        // type
+        if (m_glyph_rendering == glyph_ren_sdf) {
+          memcpy(data, &m_sdf_data[0], m_data_size);
+        } else if (m_glyph_rendering == glyph_ren_color) {
+          memcpy(data, &m_color_data[0], m_data_size);
+        }
         break;
     }
+    AGG_FONT_TIMING_END(t_serialize, font_timing_serialize);
+  }
+}
+
+//------------------------------------------------------------------------
+double font_engine_freetype_base::timing_now() const {
+  if (m_timing_callback == 0) return 0.0;
+#ifdef _WIN32
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return double(count.QuadPart) / double(freq.QuadPart);
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return double(ts.tv_sec) + double(ts.tv_nsec) * 1e-9;
+#endif
+}
+
+//------------------------------------------------------------------------
+void font_engine_freetype_base::timing_end(font_timing_stage_e stage,
+                                           double start,
+                                           const char* font_name,
+                                           glyph_rendering ren) const {
+  if (m_timing_callback) {
+    m_timing_callback(m_timing_data, stage, font_name, ren,
+                      timing_now() - start);
   }
 }
 
@@ -916,6 +1702,14 @@ bool font_engine_freetype_base::add_kerning(unsigned first, unsigned second,
                                             double* x, double* y) {
   if (m_cur_face && first && second && FT_HAS_KERNING(m_cur_face)) {
     FT_Vector delta;
+    ++m_stats.kerning_lookups;
+    // Font units, unscaled, for glyph_ren_outline_units
+    if (m_glyph_rendering == glyph_ren_outline_units) {
+      FT_Get_Kerning(m_cur_face, first, second, FT_KERNING_UNSCALED, &delta);
+      *x += delta.x;
+      *y += delta.y;
+      return true;
+    }
     FT_Get_Kerning(m_cur_face, first, second, FT_KERNING_DEFAULT, &delta);
     double dx = int26p6_to_dbl(delta.x);
     double dy = int26p6_to_dbl(delta.y);
@@ -0,0 +1,371 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#include "agg_font_glyph_file.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace agg {
+
+static const char glyph_file_magic[8] = {'A', 'G', 'G', 'G',
+                                         'L', 'Y', 'P', 'H'};
+
+//------------------------------------------------------------------------
+static inline int32u fnv1a(int32u h, const void* data, unsigned size) {
+  const int8u* p = (const int8u*)data;
+  for (unsigned i = 0; i < size; ++i) {
+    h = (h ^ p[i]) * 16777619u;
+  }
+  return h;
+}
+
+//------------------------------------------------------------------------
+int32u font_data_hash(const void* data, unsigned size) {
+  return fnv1a(2166136261u, data, size);
+}
+
+//------------------------------------------------------------------------
+int32u font_file_hash(const char* file_name) {
+  FILE* fd = fopen(file_name, "rb");
+  if (fd == 0) return 0;
+  int32u h = 2166136261u;
+  int8u buf[16384];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), fd)) > 0) {
+    h = fnv1a(h, buf, unsigned(n));
+  }
+  fclose(fd);
+  return h;
+}
+
+//------------------------------------------------------------------------
+static inline unsigned align8(unsigned n) { return (n + 7) & ~7u; }
+
+//------------------------------------------------------------------------
+glyph_file::glyph_file()
+    : m_data(0),
+      m_size(0),
+      m_mapping(0),
+      m_num_fonts(0),
+      m_fonts(0),
+      m_glyphs(0) {}
+
+//------------------------------------------------------------------------
+glyph_file::~glyph_file() { close(); }
+
+//------------------------------------------------------------------------
+bool glyph_file::open(const char* file_name) {
+  close();
+#ifdef _WIN32
+  HANDLE fd = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, 0,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+  if (fd == INVALID_HANDLE_VALUE) return false;
+  DWORD size = GetFileSize(fd, 0);
+  HANDLE mapping = 0;
+  if (size != INVALID_FILE_SIZE && size >= sizeof(glyph_file_header)) {
+    mapping = CreateFileMappingA(fd, 0, PAGE_READONLY, 0, 0, 0);
+  }
+  CloseHandle(fd);
+  if (mapping == 0) return false;
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == 0) {
+    CloseHandle(mapping);
+    return false;
+  }
+  m_mapping = mapping;
+#else
+  int fd = ::open(file_name, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  void* data = MAP_FAILED;
+  off_t size = 0;
+  if (fstat(fd, &st) == 0 && st.st_size >= off_t(sizeof(glyph_file_header)) &&
+      st.st_size < 0x7FFFFFFF) {
+    size = st.st_size;
+    data = mmap(0, size_t(size), PROT_READ, MAP_SHARED, fd, 0);
+  }
+  ::close(fd);
+  if (data == MAP_FAILED) return false;
+#endif
+  m_data = (const int8u*)data;
+  m_size = unsigned(size);
+  if (!check_header()) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------
+void glyph_file::close() {
+  if (m_glyphs) {
+    for (unsigned i = 0; i < m_num_fonts; ++i) delete[] m_glyphs[i];
+    delete[] m_glyphs;
+    m_glyphs = 0;
+  }
+  if (m_data) {
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle((HANDLE)m_mapping);
+#else
+    munmap((void*)m_data, m_size);
+#endif
+  }
+  m_data = 0;
+  m_size = 0;
+  m_mapping = 0;
+  m_num_fonts = 0;
+  m_fonts = 0;
+}
+
+//------------------------------------------------------------------------
+bool glyph_file::check_header() {
+  const glyph_file_header* hdr = (const glyph_file_header*)m_data;
+  if (memcmp(hdr->magic, glyph_file_magic, sizeof(hdr->magic)) != 0 ||
+      hdr->version != glyph_file_version ||
+      hdr->byte_order != glyph_file_byte_order || hdr->fonts_offset & 7) {
+    return false;
+  }
+  unsigned max_fonts = (m_size - sizeof(glyph_file_header)) /
+                       sizeof(glyph_file_font);
+  if (hdr->num_fonts > max_fonts ||
+      hdr->fonts_offset > m_size - hdr->num_fonts * sizeof(glyph_file_font)) {
+    return false;
+  }
+  m_fonts = (const glyph_file_font*)(m_data + hdr->fonts_offset);
+  for (unsigned i = 0; i < hdr->num_fonts; ++i) {
+    // The signature has to be zero terminated within the file
+    unsigned ofs = m_fonts[i].signature_offset;
+    if (ofs >= m_size || memchr(m_data + ofs, 0, m_size - ofs) == 0) {
+      return false;
+    }
+  }
+  m_num_fonts = hdr->num_fonts;
+  m_glyphs = new glyph_cache*[m_num_fonts];
+  memset(m_glyphs, 0, sizeof(glyph_cache*) * m_num_fonts);
+  return true;
+}
+
+//------------------------------------------------------------------------
+const char* glyph_file::font_signature(unsigned font) const {
+  return (const char*)m_data + m_fonts[font].signature_offset;
+}
+
+//------------------------------------------------------------------------
+int32u glyph_file::font_hash(unsigned font) const {
+  return m_fonts[font].font_hash;
+}
+
+//------------------------------------------------------------------------
+int glyph_file::find_font(const char* signature, int32u font_hash,
+                          unsigned vertex_size) const {
+  for (unsigned i = 0; i < m_num_fonts; ++i) {
+    if (m_fonts[i].font_hash == font_hash &&
+        m_fonts[i].vertex_size == vertex_size &&
+        strcmp(font_signature(i), signature) == 0) {
+      return int(i);
+    }
+  }
+  return -1;
+}
+
+//------------------------------------------------------------------------
+bool glyph_file::load_font(unsigned font) {
+  const glyph_file_font& f = m_fonts[font];
+  unsigned max_glyphs = m_size / sizeof(glyph_file_glyph);
+  if (f.num_glyphs == 0 || f.num_glyphs > max_glyphs || f.glyphs_offset & 7 ||
+      f.glyphs_offset > m_size - f.num_glyphs * sizeof(glyph_file_glyph)) {
+    return false;
+  }
+  const glyph_file_glyph* src =
+      (const glyph_file_glyph*)(m_data + f.glyphs_offset);
+  for (unsigned i = 0; i < f.num_glyphs; ++i) {
+    if (src[i].data_offset > m_size ||
+        src[i].data_size > m_size - src[i].data_offset ||
+        src[i].data_type > glyph_data_outline ||
+        (i && src[i].code <= src[i - 1].code)) {
+      return false;
+    }
+  }
+  glyph_cache* glyphs = new glyph_cache[f.num_glyphs];
+  for (unsigned i = 0; i < f.num_glyphs; ++i) {
+    glyph_cache& gl = glyphs[i];
+    gl.glyph_index = src[i].glyph_index;
+    gl.data = (int8u*)m_data + src[i].data_offset;
+    gl.data_size = src[i].data_size;
+    gl.data_type = glyph_data_type(src[i].data_type);
+    gl.bounds = rect_i(src[i].x1, src[i].y1, src[i].x2, src[i].y2);
+    gl.advance_x = src[i].advance_x;
+    gl.advance_y = src[i].advance_y;
+  }
+  m_glyphs[font] = glyphs;
+  return true;
+}
+
+//------------------------------------------------------------------------
+const glyph_cache* glyph_file::find_glyph(int font, unsigned code) {
+  if (font < 0 || unsigned(font) >= m_num_fonts) return 0;
+  if (m_glyphs[font] == 0 && !load_font(font)) return 0;
+
+  const glyph_file_font& f = m_fonts[font];
+  const glyph_file_glyph* src =
+      (const glyph_file_glyph*)(m_data + f.glyphs_offset);
+  unsigned lo = 0;
+  unsigned hi = f.num_glyphs;
+  while (lo < hi) {
+    unsigned mid = (lo + hi) >> 1;
+    if (src[mid].code < code) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < f.num_glyphs && src[lo].code == code) return m_glyphs[font] + lo;
+  return 0;
+}
+
+//------------------------------------------------------------------------
+glyph_file_writer::glyph_file_writer() {}
+
+//------------------------------------------------------------------------
+glyph_file_writer::~glyph_file_writer() { clear(); }
+
+//------------------------------------------------------------------------
+void glyph_file_writer::clear() {
+  for (unsigned i = 0; i < m_fonts.size(); ++i) delete[] m_fonts[i].signature;
+  m_fonts.remove_all();
+  m_glyphs.remove_all();
+  m_data.remove_all();
+}
+
+//------------------------------------------------------------------------
+void glyph_file_writer::add_font(const char* signature, int32u font_hash,
+                                 unsigned vertex_size) {
+  font_entry f;
+  f.signature = new char[strlen(signature) + 1];
+  strcpy(f.signature, signature);
+  f.font_hash = font_hash;
+  f.vertex_size = vertex_size;
+  f.first_glyph = m_glyphs.size();
+  m_fonts.add(f);
+}
+
+//------------------------------------------------------------------------
+void glyph_file_writer::add_glyph(unsigned code, unsigned glyph_index,
+                                  const int8u* data, unsigned data_size,
+                                  glyph_data_type data_type,
+                                  const rect_i& bounds, double advance_x,
+                                  double advance_y) {
+  if (m_fonts.size() == 0) return;
+  glyph_file_glyph gl;
+  memset(&gl, 0, sizeof(gl));
+  gl.code = code;
+  gl.glyph_index = glyph_index;
+  gl.data_offset = m_data.size();  // Relative to the data block for now
+  gl.data_size = data_size;
+  gl.data_type = data_type;
+  gl.x1 = bounds.x1;
+  gl.y1 = bounds.y1;
+  gl.x2 = bounds.x2;
+  gl.y2 = bounds.y2;
+  gl.advance_x = advance_x;
+  gl.advance_y = advance_y;
+  m_glyphs.add(gl);
+  for (unsigned i = 0; i < data_size; ++i) m_data.add(data[i]);
+  while (m_data.size() & 7) m_data.add(0);
+}
+
+//------------------------------------------------------------------------
+static int compare_glyph_codes(const void* a, const void* b) {
+  unsigned ca = ((const glyph_file_glyph*)a)->code;
+  unsigned cb = ((const glyph_file_glyph*)b)->code;
+  return ca < cb ? -1 : (ca > cb ? 1 : 0);
+}
+
+//------------------------------------------------------------------------
+bool glyph_file_writer::save(const char* file_name) const {
+  unsigned num_fonts = m_fonts.size();
+  glyph_file_header hdr;
+  memcpy(hdr.magic, glyph_file_magic, sizeof(hdr.magic));
+  hdr.version = glyph_file_version;
+  hdr.byte_order = glyph_file_byte_order;
+  hdr.num_fonts = num_fonts;
+  hdr.fonts_offset = sizeof(glyph_file_header);
+
+  // Font table, then signatures, glyph tables and data
+  pod_array<glyph_file_font> fonts(num_fonts);
+  pod_array<glyph_file_glyph> glyphs(m_glyphs.size());
+  unsigned ofs = hdr.fonts_offset + num_fonts * sizeof(glyph_file_font);
+  unsigned i, j;
+  for (i = 0; i < num_fonts; ++i) {
+    fonts[i].signature_offset = ofs;
+    ofs += align8(unsigned(strlen(m_fonts[i].signature)) + 1);
+  }
+  unsigned num_glyphs = 0;
+  for (i = 0; i < num_fonts; ++i) {
+    unsigned first = m_fonts[i].first_glyph;
+    unsigned last = i + 1 < num_fonts ? m_fonts[i + 1].first_glyph
+                                      : m_glyphs.size();
+    glyph_file_glyph* dst = &glyphs[0] + num_glyphs;
+    for (j = first; j < last; ++j) dst[j - first] = m_glyphs[j];
+    qsort(dst, last - first, sizeof(glyph_file_glyph), compare_glyph_codes);
+    // Keep the first of glyphs added twice
+    unsigned n = 0;
+    for (j = 0; j < last - first; ++j) {
+      if (n == 0 || dst[j].code != dst[n - 1].code) dst[n++] = dst[j];
+    }
+    fonts[i].font_hash = m_fonts[i].font_hash;
+    fonts[i].vertex_size = m_fonts[i].vertex_size;
+    fonts[i].num_glyphs = n;
+    fonts[i].glyphs_offset = ofs;
+    fonts[i].reserved = 0;
+    ofs += n * sizeof(glyph_file_glyph);
+    num_glyphs += n;
+  }
+  for (i = 0; i < num_glyphs; ++i) glyphs[i].data_offset += ofs;
+
+  FILE* fd = fopen(file_name, "wb");
+  if (fd == 0) return false;
+  static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  bool ok = fwrite(&hdr, sizeof(hdr), 1, fd) == 1;
+  if (num_fonts) {
+    ok = ok && fwrite(&fonts[0], sizeof(glyph_file_font), num_fonts, fd) ==
+                   num_fonts;
+  }
+  for (i = 0; ok && i < num_fonts; ++i) {
+    unsigned len = unsigned(strlen(m_fonts[i].signature)) + 1;
+    ok = fwrite(m_fonts[i].signature, 1, len, fd) == len &&
+         fwrite(zeros, 1, align8(len) - len, fd) == align8(len) - len;
+  }
+  if (ok && num_glyphs) {
+    ok = fwrite(&glyphs[0], sizeof(glyph_file_glyph), num_glyphs, fd) ==
+         num_glyphs;
+  }
+  for (i = 0; ok && i < m_data.size(); ++i) {
+    ok = fputc(m_data[i], fd) != EOF;
+  }
+  return fclose(fd) == 0 && ok;
+}
+
+}  // namespace agg
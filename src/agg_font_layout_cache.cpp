@@ -0,0 +1,242 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#include "agg_font_layout_cache.h"
+#include <string.h>
+
+namespace agg {
+
+//------------------------------------------------------------------------
+struct text_layout_cache::entry {
+  entry* bucket_next;
+  entry* lru_prev;
+  entry* lru_next;
+  unsigned hash;
+  char* signature;
+  unsigned* codes;
+  unsigned len;
+  text_style style;
+  text_layout layout;
+};
+
+//------------------------------------------------------------------------
+static inline bool style_equal(const text_style& a, const text_style& b) {
+  return a.width == b.width && a.slant == b.slant &&
+         a.interval == b.interval && a.line_height == b.line_height &&
+         a.kerning == b.kerning && a.snap_baseline == b.snap_baseline;
+}
+
+//------------------------------------------------------------------------
+static inline unsigned fnv1a(unsigned h, const void* data, unsigned size) {
+  const unsigned char* p = (const unsigned char*)data;
+  for (unsigned i = 0; i < size; ++i) {
+    h = (h ^ p[i]) * 16777619u;
+  }
+  return h;
+}
+
+//------------------------------------------------------------------------
+text_layout_recorder::text_layout_recorder(text_layout& layout,
+                                           const text_style& style)
+    : m_layout(&layout),
+      m_run_mtx(style.width, 0.0, style.slant, 1.0, 0.0, 0.0) {
+  m_layout->num_glyphs = 0;
+  m_layout->generation = 0;
+  m_layout->num_lines = 0;
+  m_layout->bounds = rect_d(1, 1, 0, 0);
+  m_layout->advance_x = 0.0;
+  m_layout->advance_y = 0.0;
+}
+
+//------------------------------------------------------------------------
+void text_layout_recorder::add_glyph(const glyph_cache* glyph, unsigned code,
+                                     double x, double y) {
+  positioned_glyph& pg = m_layout->glyphs[m_layout->num_glyphs++];
+  pg.glyph = glyph;
+  pg.code = code;
+  pg.glyph_index = glyph->glyph_index;
+  pg.line = m_layout->num_lines;
+  pg.x = x;
+  pg.y = y;
+
+  const rect_i& gb = glyph->bounds;
+  if (gb.x1 > gb.x2 || gb.y1 > gb.y2) return;
+
+  // Outlines are drawn through the run transformation, bitmaps as they are
+  double cx[4] = {double(gb.x1), double(gb.x2), double(gb.x2), double(gb.x1)};
+  double cy[4] = {double(gb.y1), double(gb.y1), double(gb.y2), double(gb.y2)};
+  rect_d& b = m_layout->bounds;
+  for (unsigned i = 0; i < 4; ++i) {
+    if (glyph->data_type == glyph_data_outline) {
+      m_run_mtx.transform(&cx[i], &cy[i]);
+    }
+    cx[i] += x;
+    cy[i] += y;
+    if (b.x1 > b.x2) {
+      b = rect_d(cx[i], cy[i], cx[i], cy[i]);
+    } else {
+      if (cx[i] < b.x1) b.x1 = cx[i];
+      if (cy[i] < b.y1) b.y1 = cy[i];
+      if (cx[i] > b.x2) b.x2 = cx[i];
+      if (cy[i] > b.y2) b.y2 = cy[i];
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+text_layout_cache::~text_layout_cache() {
+  clear();
+  delete[] m_buckets;
+}
+
+//------------------------------------------------------------------------
+text_layout_cache::text_layout_cache(unsigned max_layouts)
+    : m_buckets(0),
+      m_num_buckets(16),
+      m_lru_first(0),
+      m_lru_last(0),
+      m_num_layouts(0),
+      m_max_layouts(max_layouts ? max_layouts : 1),
+      m_byte_size(0),
+      m_hits(0),
+      m_misses(0),
+      m_codes() {
+  while (m_num_buckets < m_max_layouts) m_num_buckets <<= 1;
+  m_buckets = new entry*[m_num_buckets];
+  memset(m_buckets, 0, m_num_buckets * sizeof(entry*));
+}
+
+//------------------------------------------------------------------------
+unsigned text_layout_cache::calc_hash(const char* signature,
+                                      const unsigned* codes, unsigned len,
+                                      const text_style& style) {
+  unsigned h = 2166136261u;
+  h = fnv1a(h, signature, strlen(signature));
+  h = fnv1a(h, codes, len * sizeof(unsigned));
+  h = fnv1a(h, &style.width, sizeof(double));
+  h = fnv1a(h, &style.slant, sizeof(double));
+  h = fnv1a(h, &style.interval, sizeof(double));
+  h = fnv1a(h, &style.line_height, sizeof(double));
+  return h ^ (unsigned(style.kerning) << 1) ^ unsigned(style.snap_baseline);
+}
+
+//------------------------------------------------------------------------
+void text_layout_cache::unlink(entry* e) {
+  if (e->lru_prev) {
+    e->lru_prev->lru_next = e->lru_next;
+  } else {
+    m_lru_first = e->lru_next;
+  }
+  if (e->lru_next) {
+    e->lru_next->lru_prev = e->lru_prev;
+  } else {
+    m_lru_last = e->lru_prev;
+  }
+}
+
+//------------------------------------------------------------------------
+void text_layout_cache::push_front(entry* e) {
+  e->lru_prev = 0;
+  e->lru_next = m_lru_first;
+  if (m_lru_first) {
+    m_lru_first->lru_prev = e;
+  } else {
+    m_lru_last = e;
+  }
+  m_lru_first = e;
+}
+
+//------------------------------------------------------------------------
+void text_layout_cache::remove(entry* e) {
+  entry** link = &m_buckets[e->hash & (m_num_buckets - 1)];
+  while (*link != e) link = &(*link)->bucket_next;
+  *link = e->bucket_next;
+  unlink(e);
+
+  m_byte_size -= sizeof(entry) + strlen(e->signature) + 1 +
+                 e->len * (sizeof(unsigned) + sizeof(positioned_glyph));
+  --m_num_layouts;
+  delete[] e->signature;
+  delete[] e->codes;
+  delete[] e->layout.glyphs;
+  delete e;
+}
+
+//------------------------------------------------------------------------
+const text_layout* text_layout_cache::find(const char* signature,
+                                           const unsigned* codes,
+                                           unsigned len,
+                                           const text_style& style) {
+  unsigned hash = calc_hash(signature, codes, len, style);
+  entry* e = m_buckets[hash & (m_num_buckets - 1)];
+  for (; e; e = e->bucket_next) {
+    if (e->hash == hash && e->len == len && style_equal(e->style, style) &&
+        memcmp(e->codes, codes, len * sizeof(unsigned)) == 0 &&
+        strcmp(e->signature, signature) == 0) {
+      if (e != m_lru_first) {
+        unlink(e);
+        push_front(e);
+      }
+      ++m_hits;
+      return &e->layout;
+    }
+  }
+  ++m_misses;
+  return 0;
+}
+
+//------------------------------------------------------------------------
+text_layout* text_layout_cache::add(const char* signature,
+                                    const unsigned* codes, unsigned len,
+                                    const text_style& style) {
+  if (m_num_layouts >= m_max_layouts) {
+    remove(m_lru_last);
+  }
+
+  entry* e = new entry;
+  e->hash = calc_hash(signature, codes, len, style);
+  e->signature = new char[strlen(signature) + 1];
+  strcpy(e->signature, signature);
+  e->codes = new unsigned[len + 1];
+  memcpy(e->codes, codes, len * sizeof(unsigned));
+  e->len = len;
+  e->style = style;
+  e->layout.glyphs = new positioned_glyph[len + 1];
+  e->layout.num_glyphs = 0;
+  e->layout.generation = 0;
+  e->layout.num_lines = 0;
+  e->layout.bounds = rect_d(1, 1, 0, 0);
+  e->layout.advance_x = 0.0;
+  e->layout.advance_y = 0.0;
+
+  entry** bucket = &m_buckets[e->hash & (m_num_buckets - 1)];
+  e->bucket_next = *bucket;
+  *bucket = e;
+  push_front(e);
+
+  m_byte_size += sizeof(entry) + strlen(signature) + 1 +
+                 len * (sizeof(unsigned) + sizeof(positioned_glyph));
+  ++m_num_layouts;
+  return &e->layout;
+}
+
+//------------------------------------------------------------------------
+void text_layout_cache::clear() {
+  while (m_lru_last) remove(m_lru_last);
+  m_hits = 0;
+  m_misses = 0;
+}
+
+}  // namespace agg
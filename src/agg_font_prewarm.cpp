@@ -0,0 +1,422 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#include "agg_font_prewarm.h"
+#include <string.h>
+#include "agg_font_threads.h"
+#include "agg_gamma_functions.h"
+
+namespace agg {
+
+//------------------------------------------------------------------------
+void font_prewarm_request::match(const font_engine_freetype_base& feng) {
+  font_name = feng.name();
+  face_index = feng.face_index();
+  rendering = feng.rendering();
+  resolution = feng.resolution();
+  height = feng.height();
+  width = feng.width();
+  hinting = feng.hinting_mode();
+  embolden = feng.embolden();
+  oblique = feng.oblique();
+  stroke_width = feng.stroke_width();
+  stroke_join = feng.stroke_join();
+  stroke_miter_limit = feng.stroke_miter_limit();
+  num_axes = feng.axes(axes);
+  flip_y = feng.flip_y();
+  transform = feng.transform();
+  use_gamma_table = true;
+  for (unsigned i = 0; i < 256; ++i) {
+    gamma_table[i] = int8u(feng.apply_gamma(i));
+  }
+}
+
+//------------------------------------------------------------------------
+font_glyph_set::font_glyph_set() : m_signature(0), m_data(16384 - 16) {}
+
+//------------------------------------------------------------------------
+font_glyph_set::~font_glyph_set() { delete[] m_signature; }
+
+//------------------------------------------------------------------------
+void font_glyph_set::signature(const char* font_signature) {
+  delete[] m_signature;
+  m_signature = new char[strlen(font_signature) + 1];
+  strcpy(m_signature, font_signature);
+}
+
+//------------------------------------------------------------------------
+void font_glyph_set::add(const font_engine_freetype_base& feng,
+                         unsigned glyph_code) {
+  glyph_cache g;
+  g.glyph_index = feng.glyph_index();
+  g.data_size = feng.data_size();
+  g.data = g.data_size ? m_data.allocate(g.data_size) : 0;
+  g.data_type = feng.data_type();
+  g.bounds = feng.bounds();
+  g.advance_x = feng.advance_x();
+  g.advance_y = feng.advance_y();
+  if (g.data) feng.write_glyph_to(g.data);
+  m_glyphs.add(g);
+  m_codes.add(glyph_code);
+}
+
+//------------------------------------------------------------------------
+void font_glyph_set::clear() {
+  m_codes.remove_all();
+  m_glyphs.remove_all();
+  m_data.remove_all();
+}
+
+//------------------------------------------------------------------------
+enum prewarm_job_state_e {
+  prewarm_job_queued,
+  prewarm_job_running,
+  prewarm_job_done,
+  prewarm_job_failed
+};
+
+struct prewarm_job {
+  font_prewarm_request req;
+  char* font_name;
+  unsigned* codes;
+  unsigned num_codes;
+  prewarm_job_state_e state;
+  bool finishing;  // Done, the callback is running
+  bool released;   // Freed once it is done
+  int id;
+  font_glyph_set* glyphs;
+  prewarm_job* next;
+};
+
+//------------------------------------------------------------------------
+struct prewarm_queue {
+  bool flag32;
+  font_mutex mutex;
+  font_condition work_cond;
+  font_condition done_cond;
+  pod_bvector<prewarm_job*> jobs;  // By id, 0 for the ids free for reuse
+  pod_bvector<int> free_ids;
+  prewarm_job* queue_first;
+  prewarm_job* queue_last;
+  bool quit;
+  font_prewarm_callback callback;
+  void* callback_data;
+  unsigned num_threads;
+  font_thread* threads;
+  font_engine_freetype_base* engine;  // For jobs run by submit()
+
+  explicit prewarm_queue(bool f32)
+      : flag32(f32),
+        queue_first(0),
+        queue_last(0),
+        quit(false),
+        callback(0),
+        callback_data(0),
+        num_threads(0),
+        threads(0),
+        engine(0) {}
+};
+
+//------------------------------------------------------------------------
+static unsigned prewarm_charset_codes(font_prewarm_charset_e charset,
+                                      unsigned* codes) {
+  static const char digits[] = "0123456789+-.,:%$ ";
+  unsigned n = 0;
+  unsigned c;
+  switch (charset) {
+    case prewarm_digits:
+      for (c = 0; digits[c]; ++c) codes[n++] = (unsigned char)digits[c];
+      break;
+    case prewarm_latin1:
+      for (c = 160; c < 256; ++c) codes[n++] = c;
+      // Fall through
+    case prewarm_ascii:
+      for (c = 32; c < 127; ++c) codes[n++] = c;
+      break;
+    default:
+      break;
+  }
+  return n;
+}
+
+//------------------------------------------------------------------------
+// Gamma function giving back the levels of a table, as the rasterizer
+// samples it at i / 255
+class prewarm_gamma_table {
+ public:
+  explicit prewarm_gamma_table(const int8u* table) : m_table(table) {}
+  double operator()(double x) const {
+    return m_table[uround(x * 255.0)] / 255.0;
+  }
+
+ private:
+  const int8u* m_table;
+};
+
+//------------------------------------------------------------------------
+static bool prewarm_run(font_engine_freetype_base& feng, prewarm_job& job) {
+  const font_prewarm_request& r = job.req;
+  if (r.use_gamma_table) {
+    feng.gamma(prewarm_gamma_table(r.gamma_table));
+  } else if (r.gamma != 1.0) {
+    feng.gamma(gamma_power(r.gamma));
+  } else {
+    feng.gamma(gamma_none());
+  }
+  if (!feng.load_font(job.font_name, r.face_index, r.rendering, r.font_mem,
+                      r.font_mem_size)) {
+    return false;
+  }
+  feng.resolution(r.resolution);
+  feng.hinting(r.hinting);
+  feng.embolden(r.embolden);
+  feng.oblique(r.oblique);
+  feng.stroke(r.stroke_width, r.stroke_join, r.stroke_miter_limit);
+  if (feng.num_axes()) feng.axes(r.axes, r.num_axes);
+  feng.flip_y(r.flip_y);
+  feng.transform(r.transform);
+  if (!feng.height(r.height) || !feng.width(r.width)) return false;
+
+  font_glyph_set* set = new font_glyph_set;
+  set->signature(feng.font_signature());
+  for (unsigned i = 0; i < job.num_codes; ++i) {
+    if (feng.prepare_glyph(job.codes[i])) set->add(feng, job.codes[i]);
+  }
+  job.glyphs = set;
+  return true;
+}
+
+//------------------------------------------------------------------------
+// Free a job and make its id available, with the mutex held
+static void prewarm_free(prewarm_queue& m, prewarm_job* job) {
+  m.jobs[job->id] = 0;
+  m.free_ids.add(job->id);
+  delete[] job->font_name;
+  delete[] job->codes;
+  delete job->glyphs;
+  delete job;
+}
+
+//------------------------------------------------------------------------
+static void prewarm_finish(prewarm_queue& m, prewarm_job& job, bool ok) {
+  font_prewarm_callback cb;
+  void* cb_data;
+  int id;
+  {
+    font_lock lock(m.mutex);
+    job.state = ok ? prewarm_job_done : prewarm_job_failed;
+    delete[] job.font_name;
+    delete[] job.codes;
+    job.font_name = 0;
+    job.codes = 0;
+    m.done_cond.broadcast();
+    cb = m.callback;
+    cb_data = m.callback_data;
+    id = job.id;
+    job.finishing = true;
+  }
+  if (cb) cb(cb_data, id);
+
+  // A job released before this point is freed here, so that its id is
+  // not given to another job before the callback
+  font_lock lock(m.mutex);
+  job.finishing = false;
+  if (job.released) prewarm_free(m, &job);
+}
+
+//------------------------------------------------------------------------
+static prewarm_job* prewarm_find(const prewarm_queue& m, int id) {
+  if (id < 0 || unsigned(id) >= m.jobs.size()) return 0;
+  return m.jobs[id];
+}
+
+//------------------------------------------------------------------------
+static void prewarm_worker(prewarm_queue& m) {
+  font_engine_freetype_base feng(m.flag32);
+  for (;;) {
+    prewarm_job* job;
+    {
+      font_lock lock(m.mutex);
+      while (m.queue_first == 0 && !m.quit) m.work_cond.wait(m.mutex);
+      if (m.quit) return;
+      job = m.queue_first;
+      m.queue_first = job->next;
+      if (m.queue_first == 0) m.queue_last = 0;
+      job->state = prewarm_job_running;
+    }
+    bool ok = prewarm_run(feng, *job);
+    prewarm_finish(m, *job, ok);
+  }
+}
+
+//------------------------------------------------------------------------
+static void prewarm_thread(void* queue) {
+  prewarm_worker(*(prewarm_queue*)queue);
+}
+
+//------------------------------------------------------------------------
+font_prewarmer::font_prewarmer(bool flag32, unsigned num_threads)
+    : m_queue(new prewarm_queue(flag32)) {
+  m_queue->threads = new font_thread[num_threads ? num_threads : 1];
+  for (unsigned i = 0; i < num_threads; ++i) {
+    if (!m_queue->threads[i].start(prewarm_thread, m_queue)) break;
+    ++m_queue->num_threads;
+  }
+}
+
+//------------------------------------------------------------------------
+font_prewarmer::~font_prewarmer() {
+  {
+    font_lock lock(m_queue->mutex);
+    m_queue->quit = true;
+    m_queue->work_cond.broadcast();
+  }
+  for (unsigned i = 0; i < m_queue->num_threads; ++i) {
+    m_queue->threads[i].join();
+  }
+  delete[] m_queue->threads;
+  for (unsigned i = 0; i < m_queue->jobs.size(); ++i) {
+    prewarm_job* job = m_queue->jobs[i];
+    if (job == 0) continue;
+    delete[] job->font_name;
+    delete[] job->codes;
+    delete job->glyphs;
+    delete job;
+  }
+  delete m_queue->engine;
+  delete m_queue;
+}
+
+//------------------------------------------------------------------------
+int font_prewarmer::submit(const font_prewarm_request& req) {
+  if (req.font_name == 0) return -1;
+
+  prewarm_job* job = new prewarm_job;
+  job->req = req;
+  job->font_name = new char[strlen(req.font_name) + 1];
+  strcpy(job->font_name, req.font_name);
+  if (req.charset == prewarm_codes) {
+    job->codes = new unsigned[req.num_codes ? req.num_codes : 1];
+    if (req.num_codes) {
+      memcpy(job->codes, req.codes, req.num_codes * sizeof(unsigned));
+    }
+    job->num_codes = req.num_codes;
+  } else {
+    job->codes = new unsigned[256];
+    job->num_codes = prewarm_charset_codes(req.charset, job->codes);
+  }
+  job->req.font_name = job->font_name;
+  job->req.codes = job->codes;
+  job->state = prewarm_job_queued;
+  job->finishing = false;
+  job->released = false;
+  job->glyphs = 0;
+  job->next = 0;
+
+  int id;
+  {
+    font_lock lock(m_queue->mutex);
+    if (m_queue->free_ids.size()) {
+      id = m_queue->free_ids[m_queue->free_ids.size() - 1];
+      m_queue->free_ids.remove_last();
+      m_queue->jobs[id] = job;
+    } else {
+      id = int(m_queue->jobs.size());
+      m_queue->jobs.add(job);
+    }
+    job->id = id;
+    if (m_queue->num_threads) {
+      if (m_queue->queue_last) {
+        m_queue->queue_last->next = job;
+      } else {
+        m_queue->queue_first = job;
+      }
+      m_queue->queue_last = job;
+      m_queue->work_cond.broadcast();
+      return id;
+    }
+  }
+
+  // No worker thread, run it now
+  if (m_queue->engine == 0) {
+    m_queue->engine = new font_engine_freetype_base(m_queue->flag32);
+  }
+  job->state = prewarm_job_running;
+  bool ok = prewarm_run(*m_queue->engine, *job);
+  prewarm_finish(*m_queue, *job, ok);
+  return id;
+}
+
+//------------------------------------------------------------------------
+bool font_prewarmer::done(int job) const {
+  font_lock lock(m_queue->mutex);
+  const prewarm_job* j = prewarm_find(*m_queue, job);
+  if (j == 0) return false;
+  return j->state == prewarm_job_done || j->state == prewarm_job_failed;
+}
+
+//------------------------------------------------------------------------
+bool font_prewarmer::wait(int job) {
+  font_lock lock(m_queue->mutex);
+  const prewarm_job* j = prewarm_find(*m_queue, job);
+  if (j == 0 || j->released) return false;
+  while (j->state == prewarm_job_queued || j->state == prewarm_job_running) {
+    m_queue->done_cond.wait(m_queue->mutex);
+  }
+  return j->state == prewarm_job_done;
+}
+
+//------------------------------------------------------------------------
+void font_prewarmer::wait_all() {
+  unsigned n;
+  {
+    font_lock lock(m_queue->mutex);
+    n = m_queue->jobs.size();
+  }
+  for (unsigned i = 0; i < n; ++i) wait(int(i));
+}
+
+//------------------------------------------------------------------------
+const font_glyph_set* font_prewarmer::glyphs(int job) const {
+  font_lock lock(m_queue->mutex);
+  const prewarm_job* j = prewarm_find(*m_queue, job);
+  return j && j->state == prewarm_job_done ? j->glyphs : 0;
+}
+
+//------------------------------------------------------------------------
+void font_prewarmer::release(int job) {
+  font_lock lock(m_queue->mutex);
+  prewarm_job* j = prewarm_find(*m_queue, job);
+  if (j == 0 || j->released) return;
+  if ((j->state == prewarm_job_done || j->state == prewarm_job_failed) &&
+      !j->finishing) {
+    prewarm_free(*m_queue, j);
+  } else {
+    j->released = true;
+  }
+}
+
+//------------------------------------------------------------------------
+void font_prewarmer::completion_callback(font_prewarm_callback cb,
+                                         void* data) {
+  font_lock lock(m_queue->mutex);
+  m_queue->callback = cb;
+  m_queue->callback_data = data;
+}
+
+//------------------------------------------------------------------------
+unsigned font_prewarmer::num_threads() const { return m_queue->num_threads; }
+
+}  // namespace agg
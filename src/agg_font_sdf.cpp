@@ -0,0 +1,159 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+#include "agg_font_sdf.h"
+
+namespace agg {
+
+//------------------------------------------------------------------------
+void distance_field::reset() {
+  m_edges.remove_all();
+  m_start_x = m_start_y = 0.0;
+  m_last_x = m_last_y = 0.0;
+  m_open = false;
+  m_box = rect_d(1, 1, 0, 0);
+}
+
+//------------------------------------------------------------------------
+void distance_field::move_to(double x, double y) {
+  close_polygon();
+  m_start_x = m_last_x = x;
+  m_start_y = m_last_y = y;
+  m_open = true;
+}
+
+//------------------------------------------------------------------------
+void distance_field::line_to(double x, double y) {
+  if (!m_open) {
+    move_to(x, y);
+    return;
+  }
+  if (x == m_last_x && y == m_last_y) return;
+  edge e = {m_last_x, m_last_y, x, y};
+  m_edges.add(e);
+  if (m_box.x1 > m_box.x2) {
+    m_box = rect_d(m_last_x, m_last_y, m_last_x, m_last_y);
+  }
+  if (x < m_box.x1) m_box.x1 = x;
+  if (y < m_box.y1) m_box.y1 = y;
+  if (x > m_box.x2) m_box.x2 = x;
+  if (y > m_box.y2) m_box.y2 = y;
+  if (m_last_x < m_box.x1) m_box.x1 = m_last_x;
+  if (m_last_y < m_box.y1) m_box.y1 = m_last_y;
+  if (m_last_x > m_box.x2) m_box.x2 = m_last_x;
+  if (m_last_y > m_box.y2) m_box.y2 = m_last_y;
+  m_last_x = x;
+  m_last_y = y;
+}
+
+//------------------------------------------------------------------------
+void distance_field::close_polygon() {
+  if (m_open) {
+    line_to(m_start_x, m_start_y);
+    m_open = false;
+  }
+}
+
+//------------------------------------------------------------------------
+rect_i distance_field::bounds(double spread) const {
+  if (m_box.x1 > m_box.x2) return rect_i(1, 1, 0, 0);
+  return rect_i(int(floor(m_box.x1 - spread)), int(floor(m_box.y1 - spread)),
+                int(ceil(m_box.x2 + spread)), int(ceil(m_box.y2 + spread)));
+}
+
+//------------------------------------------------------------------------
+// Squared distance from (px, py) to a segment
+static inline double segment_dist2(double px, double py, double x1,
+                                   double y1, double x2, double y2) {
+  double dx = x2 - x1;
+  double dy = y2 - y1;
+  double len2 = dx * dx + dy * dy;
+  double t = len2 > 0.0 ? ((px - x1) * dx + (py - y1) * dy) / len2 : 0.0;
+  if (t < 0.0) t = 0.0;
+  if (t > 1.0) t = 1.0;
+  double ex = x1 + t * dx - px;
+  double ey = y1 + t * dy - py;
+  return ex * ex + ey * ey;
+}
+
+//------------------------------------------------------------------------
+void distance_field::build(int8u* data, const rect_i& b, double spread) {
+  int w = b.x2 - b.x1;
+  int h = b.y2 - b.y1;
+  if (w <= 0 || h <= 0 || spread <= 0.0) return;
+
+  // Unsigned distance, each edge only visits the pixels within spread
+  double max2 = spread * spread;
+  m_dist.allocate(unsigned(w * h));
+  unsigned i;
+  for (i = 0; i < m_dist.size(); ++i) m_dist[i] = max2;
+  for (i = 0; i < m_edges.size(); ++i) {
+    const edge& e = m_edges[i];
+    int ex1 = int(floor((e.x1 < e.x2 ? e.x1 : e.x2) - spread)) - b.x1;
+    int ex2 = int(ceil((e.x1 > e.x2 ? e.x1 : e.x2) + spread)) - b.x1;
+    int ey1 = int(floor((e.y1 < e.y2 ? e.y1 : e.y2) - spread)) - b.y1;
+    int ey2 = int(ceil((e.y1 > e.y2 ? e.y1 : e.y2) + spread)) - b.y1;
+    if (ex1 < 0) ex1 = 0;
+    if (ey1 < 0) ey1 = 0;
+    if (ex2 > w) ex2 = w;
+    if (ey2 > h) ey2 = h;
+    for (int y = ey1; y < ey2; ++y) {
+      double py = b.y1 + y + 0.5;
+      double* row = &m_dist[y * w];
+      for (int x = ex1; x < ex2; ++x) {
+        double d2 = segment_dist2(b.x1 + x + 0.5, py, e.x1, e.y1, e.x2, e.y2);
+        if (d2 < row[x]) row[x] = d2;
+      }
+    }
+  }
+
+  // Sign by the nonzero winding at the pixel centers, row by row
+  m_crossings.capacity(m_edges.size());
+  for (int y = 0; y < h; ++y) {
+    double py = b.y1 + y + 0.5;
+    m_crossings.remove_all();
+    for (i = 0; i < m_edges.size(); ++i) {
+      const edge& e = m_edges[i];
+      if ((e.y1 <= py && py < e.y2) || (e.y2 <= py && py < e.y1)) {
+        crossing c;
+        c.x = e.x1 + (py - e.y1) * (e.x2 - e.x1) / (e.y2 - e.y1);
+        c.dir = e.y2 > e.y1 ? 1 : -1;
+        // Insertion sort, a row crosses few edges
+        unsigned j = m_crossings.size();
+        m_crossings.add(c);
+        for (; j > 0 && m_crossings[j - 1].x > c.x; --j) {
+          m_crossings[j] = m_crossings[j - 1];
+        }
+        m_crossings[j] = c;
+      }
+    }
+
+    int winding = 0;
+    unsigned k = 0;
+    const double* row = &m_dist[y * w];
+    int8u* out = data + y * w;
+    for (int x = 0; x < w; ++x) {
+      double px = b.x1 + x + 0.5;
+      while (k < m_crossings.size() && m_crossings[k].x < px) {
+        winding += m_crossings[k++].dir;
+      }
+      double t = sqrt(row[x]) / spread;
+      if (winding == 0) t = -t;
+      out[x] = int8u(uround((t + 1.0) * 127.5));
+    }
+  }
+}
+
+}  // namespace agg
@@ -0,0 +1,174 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+//
+// Minimal threads, mutex and condition variable shared by the worker
+// pools of the library, Win32 or pthreads. With AGG_FONT_NO_THREADS no
+// thread starts and the mutex and condition are no-ops. Not installed.
+//
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_THREADS_INCLUDED
+#define AGG_FONT_THREADS_INCLUDED
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <process.h>
+#elif !defined(AGG_FONT_NO_THREADS)
+#include <pthread.h>
+#define AGG_FONT_PTHREADS
+#endif
+
+namespace agg {
+
+//------------------------------------------------------------------------
+class font_mutex {
+ public:
+#if defined(_WIN32)
+  font_mutex() { InitializeCriticalSection(&m_cs); }
+  ~font_mutex() { DeleteCriticalSection(&m_cs); }
+  void lock() { EnterCriticalSection(&m_cs); }
+  void unlock() { LeaveCriticalSection(&m_cs); }
+  CRITICAL_SECTION m_cs;
+#elif defined(AGG_FONT_PTHREADS)
+  font_mutex() { pthread_mutex_init(&m_mutex, 0); }
+  ~font_mutex() { pthread_mutex_destroy(&m_mutex); }
+  void lock() { pthread_mutex_lock(&m_mutex); }
+  void unlock() { pthread_mutex_unlock(&m_mutex); }
+  pthread_mutex_t m_mutex;
+#else
+  font_mutex() {}
+  void lock() {}
+  void unlock() {}
+#endif
+
+ private:
+  font_mutex(const font_mutex&);
+  const font_mutex& operator=(const font_mutex&);
+};
+
+//------------------------------------------------------------------------
+class font_condition {
+ public:
+#if defined(_WIN32)
+  font_condition() { InitializeConditionVariable(&m_cond); }
+  void wait(font_mutex& m) {
+    SleepConditionVariableCS(&m_cond, &m.m_cs, INFINITE);
+  }
+  void broadcast() { WakeAllConditionVariable(&m_cond); }
+  CONDITION_VARIABLE m_cond;
+#elif defined(AGG_FONT_PTHREADS)
+  font_condition() { pthread_cond_init(&m_cond, 0); }
+  ~font_condition() { pthread_cond_destroy(&m_cond); }
+  void wait(font_mutex& m) { pthread_cond_wait(&m_cond, &m.m_mutex); }
+  void broadcast() { pthread_cond_broadcast(&m_cond); }
+  pthread_cond_t m_cond;
+#else
+  font_condition() {}
+  void wait(font_mutex&) {}
+  void broadcast() {}
+#endif
+
+ private:
+  font_condition(const font_condition&);
+  const font_condition& operator=(const font_condition&);
+};
+
+//------------------------------------------------------------------------
+class font_lock {
+ public:
+  explicit font_lock(font_mutex& m) : m_mutex(&m) { m_mutex->lock(); }
+  ~font_lock() { m_mutex->unlock(); }
+
+ private:
+  font_lock(const font_lock&);
+  const font_lock& operator=(const font_lock&);
+
+  font_mutex* m_mutex;
+};
+
+//------------------------------------------------------------------------
+// A thread running func(arg), start() returns false if it cannot be
+// started, always without thread support.
+typedef void (*font_thread_func)(void* arg);
+
+#if defined(_WIN32)
+static unsigned __stdcall font_thread_entry(void* thread);
+#elif defined(AGG_FONT_PTHREADS)
+extern "C" {
+static void* font_thread_entry(void* thread);
+}
+#endif
+
+class font_thread {
+ public:
+  font_thread() : m_func(0), m_arg(0), m_started(false) {}
+
+  bool start(font_thread_func func, void* arg) {
+    m_func = func;
+    m_arg = arg;
+#if defined(_WIN32)
+    uintptr_t h = _beginthreadex(0, 0, font_thread_entry, this, 0, 0);
+    m_started = h != 0;
+    if (m_started) m_handle = (HANDLE)h;
+#elif defined(AGG_FONT_PTHREADS)
+    m_started = pthread_create(&m_handle, 0, font_thread_entry, this) == 0;
+#endif
+    return m_started;
+  }
+
+  void join() {
+    if (!m_started) return;
+#if defined(_WIN32)
+    WaitForSingleObject(m_handle, INFINITE);
+    CloseHandle(m_handle);
+#elif defined(AGG_FONT_PTHREADS)
+    pthread_join(m_handle, 0);
+#endif
+    m_started = false;
+  }
+
+  void run() { m_func(m_arg); }
+
+ private:
+  font_thread(const font_thread&);
+  const font_thread& operator=(const font_thread&);
+
+#if defined(_WIN32)
+  HANDLE m_handle;
+#elif defined(AGG_FONT_PTHREADS)
+  pthread_t m_handle;
+#endif
+  font_thread_func m_func;
+  void* m_arg;
+  bool m_started;
+};
+
+#if defined(_WIN32)
+static unsigned __stdcall font_thread_entry(void* thread) {
+  ((font_thread*)thread)->run();
+  return 0;
+}
+#elif defined(AGG_FONT_PTHREADS)
+extern "C" {
+static void* font_thread_entry(void* thread) {
+  ((font_thread*)thread)->run();
+  return 0;
+}
+}
+#endif
+
+}  // namespace agg
+
+#endif
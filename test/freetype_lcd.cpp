@@ -12,10 +12,11 @@
 #include "agg_renderer_primitives.h"
 #include "agg_rasterizer_scanline_aa.h"
 #include "agg_conv_curve.h"
-#include "agg_conv_contour.h"
 #include "agg_pixfmt_rgb.h"
 #include "agg_pixfmt_rgb24_lcd.h"
 #include "agg_font_freetype.h"
+#include "agg_font_text.h"
+#include "agg_font_utf8.h"
 #include "platform/agg_platform_support.h"
 #include "agg_gamma_lut.h"
 
@@ -111,42 +112,12 @@ static char text4[] =
 
 
 
-template<class VertexSource> class faux_weight
-{
-public:
-    faux_weight(VertexSource& vs) : 
-        m_mtx_zoom_in_y(agg::trans_affine_scaling(1, 100)),
-        m_mtx_zoom_out_y(agg::trans_affine_scaling(1, 1.0/100.0)),
-        m_source(&vs),
-        m_trans_zoom_in_y(*m_source, m_mtx_zoom_in_y),
-        m_contour(m_trans_zoom_in_y),
-        m_trans_zoom_out(m_contour, m_mtx_zoom_out_y) 
-    {
-        m_contour.auto_detect_orientation(false);
-    }
-
-    void weight(double v) { m_contour.width(v); }
-
-    void rewind(unsigned path_id=0) {m_trans_zoom_out.rewind(path_id); }
-    unsigned vertex(double* x, double* y) { return m_trans_zoom_out.vertex(x, y); }
-
-private:
-    agg::trans_affine m_mtx_zoom_in_y;
-    agg::trans_affine m_mtx_zoom_out_y;
-    VertexSource* m_source;
-    agg::conv_transform<VertexSource> m_trans_zoom_in_y;
-    agg::conv_contour<agg::conv_transform<VertexSource> > m_contour;
-    agg::conv_transform<agg::conv_contour<agg::conv_transform<VertexSource> > > m_trans_zoom_out;
-};
-
-
-
 class the_application : public agg::platform_support
 {
     typedef agg::pixfmt_rgb24 pixfmt_type;
     typedef agg::renderer_base<pixfmt_type> base_ren_type;
     typedef agg::renderer_scanline_aa_solid<base_ren_type> renderer_solid;
-    typedef agg::font_engine_freetype_int32 font_engine_type;
+    typedef agg::font_engine_freetype_int16 font_engine_type;
     typedef agg::font_cache_manager<font_engine_type> font_manager_type;
 
     agg::rbox_ctrl<agg::rgba8>   m_typeface;
@@ -165,14 +136,9 @@ class the_application : public agg::platform_support
     agg::cbox_ctrl<agg::rgba8>   m_invert;
     font_engine_type             m_feng;
     font_manager_type            m_fman;
+    agg::ascii_glyph_table<font_engine_type, font_manager_type> m_glyphs;
     double                       m_old_height;
-    agg::gamma_lut<>             m_gamma_lut;
-
-    // Pipeline to process the vectors glyph paths (curves + contour)
-    agg::trans_affine m_mtx;
-    agg::conv_curve<font_manager_type::path_adaptor_type> m_curves;
-    agg::conv_transform<agg::conv_curve<font_manager_type::path_adaptor_type> > m_trans;
-    faux_weight<agg::conv_transform<agg::conv_curve<font_manager_type::path_adaptor_type> > > m_weight;
+    agg::lcd_gamma_lut16         m_gamma_lut;
 public:
     the_application(agg::pix_format_e format, bool flip_y) :
         agg::platform_support(format, flip_y),
@@ -193,10 +159,8 @@ public:
         m_invert       (200, 95.0, "Invert",    !flip_y),
         m_feng(),
         m_fman(m_feng),
-        m_old_height(0.0),
-        m_curves(m_fman.path_adaptor()),
-        m_trans(m_curves, m_mtx),
-        m_weight(m_trans)
+        m_glyphs(m_feng, m_fman),
+        m_old_height(0.0)
     {
         for (int i = 0; i < 5; i++) {
             m_typeface.add_item(os_face_name[i]);
@@ -287,65 +251,29 @@ public:
 
         agg::glyph_rendering gren = agg::glyph_ren_outline;
 
-        double scale_x = 100;
-
         if(m_feng.load_font(full_file_name(font), 0, gren))
         {
+            // Vertical only hinting at the real size, stretched for the
+            // subpixels
             m_feng.height(height);
-            m_feng.width(height * scale_x * subpixel_scale);
-            m_feng.hinting(m_hinting.status());
+            m_feng.width(height * subpixel_scale);
+            m_feng.hinting(m_hinting.status() ? agg::font_hinting_light :
+                                                agg::font_hinting_none);
 
-            const char* p = text;
+            // Faux weight and italic are made by the engine and cached
+            // with the glyphs
+            m_feng.embolden(m_faux_weight.value() * height * subpixel_scale * 2 / 15);
+            m_feng.oblique(tan(m_faux_italic.value() * subpixel_scale / 3));
 
             x *= subpixel_scale;
-            double start_x = x;
 
-            while(*p)
-            {
-                if(*p == '\n')
-                {
-                    x = start_x;
-                    y -= height * 1.25;
-                    ++p;
-                    continue;
-                }
-
-                const agg::glyph_cache* glyph = m_fman.glyph(*p);
-                if(glyph)
-                {
-                    if(m_kerning.status())
-                    {
-                        m_fman.add_kerning(&x, &y);
-                    }
-
-                    m_fman.init_embedded_adaptors(glyph, 0, 0);
-                    if(glyph->data_type == agg::glyph_data_outline)
-                    {
-                        double ty = m_hinting.status() ? floor(y + 0.5) : y;
-                        ras.reset();
-                        m_mtx.reset();
-                        m_mtx *= agg::trans_affine_scaling(m_width.value() / scale_x, 1);
-                        m_mtx *= agg::trans_affine_skewing(m_faux_italic.value() * subpixel_scale / 3, 0);
-                        m_mtx *= agg::trans_affine_translation(start_x + x/scale_x, ty);
-                        if(fabs(m_faux_weight.value()) < 0.05)
-                        {
-                            ras.add_path(m_trans);
-                        }
-                        else
-                        {
-                            m_weight.weight(-m_faux_weight.value() * height * subpixel_scale / 15);
-                            ras.add_path(m_weight);
-                        }
-                        ren_solid.color(color);
-                        agg::render_scanlines(ras, sl, ren_solid);
-                    }
-
-                    // increment pen position
-                    x += glyph->advance_x + m_interval.value() * scale_x * subpixel_scale;
-                    y += glyph->advance_y;
-                }
-                ++p;
-            }
+            agg::text_style style;
+            style.width = m_width.value();
+            style.interval = m_interval.value() * subpixel_scale;
+            style.kerning = m_kerning.status();
+            style.snap_baseline = m_hinting.status();
+            ren_solid.color(color);
+            agg::render_text_utf8(m_glyphs, ras, sl, ren_solid, text, strlen(text), &x, &y, style);
         }
         return y;
     }
@@ -389,10 +317,10 @@ public:
         // The values below are fine tuned as in the Elementary Plot library.
         // The primary weight should be 0.448 but is left adjustable.
         agg::lcd_distribution_lut lut(m_primary.value(), 0.184, 0.092);
-        typedef agg::pixfmt_rgb24_lcd_gamma<agg::gamma_lut<> > pixfmt_lcd_type;
+        typedef agg::pixfmt_rgb24_lcd_linear<agg::lcd_gamma_lut16> pixfmt_lcd_type;
         pixfmt_lcd_type pf_lcd(rbuf_window(), lut, m_gamma_lut);
         agg::renderer_base<pixfmt_lcd_type> ren_base_lcd(pf_lcd);
-        agg::renderer_scanline_aa_solid<agg::renderer_base<pixfmt_lcd_type> > ren_solid_lcd(ren_base_lcd);
+        agg::renderer_scanline_lcd_solid<agg::renderer_base<pixfmt_lcd_type> > ren_solid_lcd(ren_base_lcd);
 
 
         double y = height() - 20;
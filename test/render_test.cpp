@@ -0,0 +1,481 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+// Headless rendering test. Renders text blocks with the gray and LCD
+// pixel formats and a few hinting, kerning and gamma variants into
+// memory, compares them with golden PPM images and checks the rendering
+// time against recorded budgets. The cases drawn in bands on threads must
+// also be identical to the same case drawn on a single thread.
+//
+//   agg-font-render-test [options] font-file
+//     -g dir        golden images and budgets.txt (default golden)
+//     -o dir        where to write the images of failed cases (default .)
+//     -t tolerance  max difference per channel (default 2)
+//     -u            write the golden images and budgets to the output
+//                   directory instead of checking them
+//
+// A budget is twice the best time measured when updating. A case without
+// a golden image fails, its image is written to the output directory.
+//
+// The golden images depend on the font and the FreeType version, none
+// are kept in the tree. To start a golden set, run with -u and copy the
+// .ppm files and budgets.txt of the output directory to the golden
+// directory, test/golden for the meson test. Without a golden directory
+// only the band checks are done. Without a font, or with no golden
+// directory and no failure, the exit code is 77, which marks the test as
+// skipped.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "agg_font_bands.h"
+#include "agg_font_freetype.h"
+#include "agg_font_text.h"
+#include "agg_gamma_lut.h"
+#include "agg_pixfmt_rgb.h"
+#include "agg_pixfmt_rgb24_lcd.h"
+#include "agg_rasterizer_scanline_aa.h"
+#include "agg_renderer_base.h"
+#include "agg_renderer_scanline.h"
+#include "agg_rendering_buffer.h"
+#include "agg_scanline_u.h"
+
+namespace {
+
+const char text_block[] =
+    "The quick brown fox jumps over the lazy dog.\n"
+    "AVAWATAY To Ta Yo, fi fl ff; \"quoted\" (1234567890)\n"
+    "Sphinx of black quartz, judge my vow!";
+
+const unsigned image_width = 420;
+const unsigned image_height = 80;
+const unsigned repeats = 20;
+
+typedef agg::font_engine_freetype_int32 font_engine_type;
+typedef agg::font_cache_manager<font_engine_type> font_manager_type;
+
+enum pixfmt_e { pix_gray, pix_lcd, pix_lcd_gamma, pix_lcd_linear };
+
+struct test_case {
+  const char* name;
+  pixfmt_e pixfmt;
+  agg::glyph_rendering mode;
+  double height;
+  bool hinting;
+  bool kerning;
+  double gamma;
+  unsigned threads;  // Drawn by band_text_renderer if not zero
+};
+
+const test_case cases[] = {
+    {"gray", pix_gray, agg::glyph_ren_outline, 13.0, false, true, 1.0, 0},
+    {"gray_hinted", pix_gray, agg::glyph_ren_outline, 13.0, true, true, 1.0,
+     0},
+    {"gray_nokern", pix_gray, agg::glyph_ren_outline, 13.0, false, false, 1.0,
+     0},
+    {"gray_native", pix_gray, agg::glyph_ren_native_gray8, 13.0, true, true,
+     1.0, 0},
+    {"lcd", pix_lcd, agg::glyph_ren_outline, 13.0, false, true, 1.0, 0},
+    {"lcd_hinted", pix_lcd, agg::glyph_ren_outline, 13.0, true, true, 1.0, 0},
+    {"lcd_small", pix_lcd, agg::glyph_ren_outline, 9.0, true, true, 1.0, 0},
+    {"lcd_gamma", pix_lcd_gamma, agg::glyph_ren_outline, 13.0, false, true,
+     1.8, 0},
+    {"lcd_linear", pix_lcd_linear, agg::glyph_ren_outline, 13.0, false, true,
+     2.2, 0},
+    {"gray_bands", pix_gray, agg::glyph_ren_outline, 13.0, false, true, 1.0, 3},
+    {"gray_native_bands", pix_gray, agg::glyph_ren_native_gray8, 13.0, true,
+     true, 1.0, 3},
+    {"lcd_bands", pix_lcd, agg::glyph_ren_outline, 13.0, true, true, 1.0, 3},
+    {"lcd_linear_bands", pix_lcd_linear, agg::glyph_ren_outline, 13.0, false,
+     true, 2.2, 7},
+};
+
+//------------------------------------------------------------------------
+double now() {
+#ifdef _WIN32
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return double(count.QuadPart) / double(freq.QuadPart);
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return double(ts.tv_sec) + double(ts.tv_nsec) * 1e-9;
+#endif
+}
+
+//------------------------------------------------------------------------
+struct image {
+  unsigned width;
+  unsigned height;
+  agg::pod_array<agg::int8u> data;
+
+  image(unsigned w, unsigned h) : width(w), height(h), data(w * h * 3) {}
+};
+
+bool write_ppm(const char* file_name, const image& img) {
+  FILE* fd = fopen(file_name, "wb");
+  if (fd == 0) return false;
+  fprintf(fd, "P6\n%u %u\n255\n", img.width, img.height);
+  unsigned size = img.width * img.height * 3;
+  bool ok = fwrite(&img.data[0], 1, size, fd) == size;
+  return fclose(fd) == 0 && ok;
+}
+
+// Read a header field, skipping white space and comments
+bool read_ppm_field(FILE* fd, unsigned* value) {
+  int c = fgetc(fd);
+  while (c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+    if (c == '#') {
+      while (c != '\n' && c != EOF) c = fgetc(fd);
+    }
+    c = fgetc(fd);
+  }
+  if (c < '0' || c > '9') return false;
+  *value = 0;
+  while (c >= '0' && c <= '9') {
+    *value = *value * 10 + unsigned(c - '0');
+    c = fgetc(fd);
+  }
+  return true;  // The single white space after the field is consumed
+}
+
+bool read_ppm(const char* file_name, image& img) {
+  FILE* fd = fopen(file_name, "rb");
+  if (fd == 0) return false;
+  unsigned w, h, max_value;
+  bool ok = fgetc(fd) == 'P' && fgetc(fd) == '6' && read_ppm_field(fd, &w) &&
+            read_ppm_field(fd, &h) && read_ppm_field(fd, &max_value) &&
+            w == img.width && h == img.height && max_value == 255;
+  unsigned size = img.width * img.height * 3;
+  ok = ok && fread(&img.data[0], 1, size, fd) == size;
+  fclose(fd);
+  return ok;
+}
+
+//------------------------------------------------------------------------
+template <class PixFmt>
+void draw(font_engine_type& feng, font_manager_type& fman, PixFmt& pf,
+          const test_case& tc, double width) {
+  typedef agg::renderer_base<PixFmt> base_type;
+  base_type ren_base(pf);
+  agg::renderer_scanline_aa_solid<base_type> ren(ren_base);
+  agg::rasterizer_scanline_aa<> ras;
+  agg::scanline_u8 sl;
+  ren_base.clear(agg::rgba8(255, 255, 255));
+  ren.color(agg::rgba8(0, 0, 0));
+
+  agg::text_style style;
+  style.width = width;
+  style.kerning = tc.kerning;
+  style.snap_baseline = tc.hinting;
+  double x = 4.0 * width;
+  double y = 4.0 + tc.height;
+  agg::render_text(feng, fman, ras, sl, ren, text_block,
+                   unsigned(sizeof(text_block) - 1), &x, &y, style);
+}
+
+template <class PixFmt, class BandRenderer>
+void draw_bands(font_engine_type& feng, font_manager_type& fman, PixFmt& pf,
+                BandRenderer& bands, const test_case& tc, double width) {
+  agg::renderer_base<PixFmt> ren_base(pf);
+  ren_base.clear(agg::rgba8(255, 255, 255));
+
+  agg::text_style style;
+  style.width = width;
+  style.kerning = tc.kerning;
+  style.snap_baseline = tc.hinting;
+  double x = 4.0 * width;
+  double y = 4.0 + tc.height;
+  agg::text_block block;
+  block.add_text(feng, fman, text_block, unsigned(sizeof(text_block) - 1),
+                 &x, &y, style);
+  bands.render(block, agg::rgba8(0, 0, 0));
+}
+
+// Render the case into img, returns the best time of the repeats, which
+// is the time with the glyphs cached
+double render(const char* font, const test_case& tc, image& img) {
+  font_engine_type feng;
+  font_manager_type fman(feng);
+  if (!feng.load_font(font, 0, tc.mode)) return -1.0;
+  feng.flip_y(true);
+  feng.hinting(tc.hinting);
+  feng.height(tc.height);
+
+  agg::rendering_buffer rbuf(&img.data[0], img.width, img.height,
+                             int(img.width * 3));
+  agg::lcd_distribution_lut lut(1.0 / 3.0, 2.0 / 9.0, 1.0 / 9.0);
+  agg::gamma_lut<> gamma(tc.gamma);
+  agg::lcd_gamma_lut16 gamma16(tc.gamma);
+  agg::font_band_pool pool(tc.threads);
+  double best = 1e30;
+  for (unsigned i = 0; i < repeats; ++i) {
+    double start = now();
+    switch (tc.pixfmt) {
+      case pix_gray: {
+        agg::pixfmt_rgb24 pf(rbuf);
+        if (tc.threads) {
+          agg::band_text_renderer<font_manager_type, agg::pixfmt_rgb24> bands(
+              pool, 0, rbuf);
+          draw_bands(feng, fman, pf, bands, tc, 1.0);
+        } else {
+          draw(feng, fman, pf, tc, 1.0);
+        }
+      } break;
+      case pix_lcd: {
+        agg::pixfmt_rgb24_lcd pf(rbuf, lut);
+        if (tc.threads) {
+          agg::band_text_renderer<font_manager_type, agg::pixfmt_rgb24_lcd>
+              bands(pool, 0, rbuf, lut);
+          draw_bands(feng, fman, pf, bands, tc, 3.0);
+        } else {
+          draw(feng, fman, pf, tc, 3.0);
+        }
+      } break;
+      case pix_lcd_gamma: {
+        agg::pixfmt_rgb24_lcd_gamma<agg::gamma_lut<> > pf(rbuf, lut, gamma);
+        draw(feng, fman, pf, tc, 3.0);
+      } break;
+      case pix_lcd_linear: {
+        typedef agg::pixfmt_rgb24_lcd_linear<agg::lcd_gamma_lut16> pixfmt_type;
+        pixfmt_type pf(rbuf, lut, gamma16);
+        if (tc.threads) {
+          agg::band_text_renderer<font_manager_type, pixfmt_type> bands(
+              pool, 0, rbuf, lut, gamma16);
+          draw_bands(feng, fman, pf, bands, tc, 3.0);
+        } else {
+          draw(feng, fman, pf, tc, 3.0);
+        }
+      } break;
+    }
+    double t = now() - start;
+    if (t < best) best = t;
+  }
+  return best;
+}
+
+//------------------------------------------------------------------------
+struct budget_table {
+  char names[sizeof(cases) / sizeof(cases[0])][64];
+  double seconds[sizeof(cases) / sizeof(cases[0])];
+  unsigned num;
+
+  budget_table() : num(0) {}
+
+  bool load(const char* file_name) {
+    FILE* fd = fopen(file_name, "r");
+    if (fd == 0) return false;
+    while (num < sizeof(cases) / sizeof(cases[0]) &&
+           fscanf(fd, "%63s %lf", names[num], &seconds[num]) == 2) {
+      ++num;
+    }
+    fclose(fd);
+    return true;
+  }
+
+  double find(const char* name) const {
+    for (unsigned i = 0; i < num; ++i) {
+      if (strcmp(names[i], name) == 0) return seconds[i];
+    }
+    return 0.0;
+  }
+};
+
+// The directories are checked to fit in path_max with the file names
+const unsigned path_max = 1024;
+const unsigned dir_max = path_max - 64;
+
+void join_path(char* buf, const char* dir, const char* name,
+               const char* ext) {
+  sprintf(buf, "%s/%s%s", dir, name, ext);
+}
+
+bool is_dir(const char* name) {
+#ifdef _WIN32
+  struct _stat st;
+  return _stat(name, &st) == 0 && (st.st_mode & _S_IFDIR) != 0;
+#else
+  struct stat st;
+  return stat(name, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: agg-font-render-test [-g dir] [-o dir] [-t tolerance] [-u] "
+          "font-file\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const char* golden_dir = "golden";
+  const char* output_dir = ".";
+  int tolerance = 2;
+  bool update = false;
+
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-'; ++i) {
+    if (strcmp(argv[i], "-u") == 0) {
+      update = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      usage();
+      return 1;
+    }
+    if (strcmp(argv[i], "-g") == 0) {
+      golden_dir = argv[++i];
+    } else if (strcmp(argv[i], "-o") == 0) {
+      output_dir = argv[++i];
+    } else if (strcmp(argv[i], "-t") == 0) {
+      tolerance = atoi(argv[++i]);
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (i >= argc || argv[i][0] == 0) {
+    fprintf(stderr, "no font given, set the test_font option\n");
+    return 77;
+  }
+  const char* font = argv[i];
+  if (strlen(golden_dir) > dir_max || strlen(output_dir) > dir_max) {
+    fprintf(stderr, "directory name too long\n");
+    return 1;
+  }
+
+  char path[path_max];
+  join_path(path, golden_dir, "budgets", ".txt");
+  budget_table budgets;
+  budgets.load(path);
+  bool have_golden = is_dir(golden_dir);
+  if (!have_golden && !update) {
+    printf("no golden directory %s, only the bands are checked\n",
+           golden_dir);
+  }
+  FILE* budget_out = 0;
+  if (update) {
+#ifdef _WIN32
+    _mkdir(output_dir);
+#else
+    mkdir(output_dir, 0777);
+#endif
+    join_path(path, output_dir, "budgets", ".txt");
+    budget_out = fopen(path, "w");
+    if (budget_out == 0) {
+      fprintf(stderr, "cannot write %s\n", path);
+      return 1;
+    }
+  }
+
+  unsigned failed = 0;
+  for (unsigned n = 0; n < sizeof(cases) / sizeof(cases[0]); ++n) {
+    const test_case& tc = cases[n];
+    image img(image_width, image_height);
+    double t = render(font, tc, img);
+    if (t < 0.0) {
+      fprintf(stderr, "cannot load font %s\n", font);
+      if (budget_out) fclose(budget_out);
+      return 1;
+    }
+
+    // Exact, the bands must not show in the image
+    if (tc.threads && !update) {
+      test_case single = tc;
+      single.threads = 0;
+      image ref(image_width, image_height);
+      render(font, single, ref);
+      if (memcmp(&img.data[0], &ref.data[0], image_width * image_height * 3)) {
+        printf("%-12s FAIL differs from the single-threaded rendering\n",
+               tc.name);
+        join_path(path, output_dir, tc.name, ".out.ppm");
+        write_ppm(path, img);
+        ++failed;
+        continue;
+      }
+    }
+
+    if (update) {
+      join_path(path, output_dir, tc.name, ".ppm");
+      if (!write_ppm(path, img)) {
+        fprintf(stderr, "cannot write %s\n", path);
+        fclose(budget_out);
+        return 1;
+      }
+      fprintf(budget_out, "%s %.6f\n", tc.name, 2.0 * t);
+      printf("%-12s updated, %.3f ms\n", tc.name, t * 1e3);
+      continue;
+    }
+
+    if (!have_golden) continue;
+
+    join_path(path, golden_dir, tc.name, ".ppm");
+    image golden(image_width, image_height);
+    if (!read_ppm(path, golden)) {
+      printf("%-12s FAIL no golden image %s, run with -u to write it\n",
+             tc.name, path);
+      join_path(path, output_dir, tc.name, ".out.ppm");
+      write_ppm(path, img);
+      ++failed;
+      continue;
+    }
+
+    unsigned num_diffs = 0;
+    int max_diff = 0;
+    image diff(image_width, image_height);
+    for (unsigned j = 0; j < image_width * image_height * 3; ++j) {
+      int d = abs(int(img.data[j]) - int(golden.data[j]));
+      if (d > max_diff) max_diff = d;
+      if (d > tolerance) ++num_diffs;
+      diff.data[j] = agg::int8u(255 - (d > tolerance ? 255 : d * 16));
+    }
+    double budget = budgets.find(tc.name);
+    bool pixels_ok = num_diffs == 0;
+    bool time_ok = budget <= 0.0 || t <= budget;
+    printf("%-12s %s max diff %d, %u over tolerance, %.3f ms", tc.name,
+           pixels_ok && time_ok ? "PASS" : "FAIL", max_diff, num_diffs,
+           t * 1e3);
+    if (budget > 0.0) printf(" (budget %.3f ms)", budget * 1e3);
+    printf("\n");
+
+    if (!pixels_ok) {
+      join_path(path, output_dir, tc.name, ".out.ppm");
+      write_ppm(path, img);
+      join_path(path, output_dir, tc.name, ".diff.ppm");
+      write_ppm(path, diff);
+    }
+    if (!pixels_ok || !time_ok) ++failed;
+  }
+
+  if (budget_out) {
+    fclose(budget_out);
+    return 0;
+  }
+  if (failed) return 1;
+  return have_golden ? 0 : 77;
+}
@@ -0,0 +1,646 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+// Unit tests of the components that do not need a font file. Prints the
+// failed checks and exits with 1 if there is any.
+//
+//   agg-font-unit-test
+
+#include <stdio.h>
+#include <string.h>
+
+#include "agg_font_arena.h"
+#include "agg_font_budget_cache.h"
+#include "agg_font_color.h"
+#include "agg_font_glyph_file.h"
+#include "agg_font_layout_cache.h"
+#include "agg_font_sdf.h"
+#include "agg_font_utf8.h"
+#include "agg_pixfmt_lcd.h"
+#include "agg_renderer_base.h"
+#include "agg_rendering_buffer.h"
+#include "agg_scanline_p.h"
+#include "agg_scanline_u.h"
+
+namespace {
+
+unsigned num_checks = 0;
+unsigned num_failed = 0;
+
+void check(bool ok, const char* test, const char* what) {
+  ++num_checks;
+  if (ok) return;
+  ++num_failed;
+  printf("FAIL %s: %s\n", test, what);
+}
+
+//------------------------------------------------------------------------
+// A partly covered span in each orientation and subpixel order
+const unsigned lcd_size = 6;
+const agg::int8u lcd_covers[] = {32, 128, 255, 255, 255, 255, 200, 90, 10};
+
+template <class PixFmt>
+void lcd_span(agg::int8u* buf, const agg::rgba8& c) {
+  memset(buf, 255, lcd_size * lcd_size * 3);
+  agg::rendering_buffer rbuf(buf, lcd_size, lcd_size, lcd_size * 3);
+  agg::lcd_distribution_lut lut(1.0 / 3.0, 2.0 / 9.0, 1.0 / 9.0);
+  PixFmt pf(rbuf, lut);
+  pf.blend_solid_hspan(4, 2, sizeof(lcd_covers), c, lcd_covers);
+}
+
+void test_lcd_orientation() {
+  const char* name = "lcd_orientation";
+  const unsigned size = lcd_size * lcd_size * 3;
+  agg::int8u h[size], v[size], bgr[size];
+  agg::rgba8 c(10, 100, 200);
+  lcd_span<agg::pixfmt_lcd<agg::lcd_layout_rgb24> >(h, c);
+  lcd_span<agg::pixfmt_lcd<agg::lcd_layout_rgb24_v> >(v, c);
+
+  bool touched = false, stray = false, transposed = true;
+  for (unsigned y = 0; y < lcd_size; ++y) {
+    for (unsigned x = 0; x < lcd_size; ++x) {
+      const agg::int8u* ph = h + (y * lcd_size + x) * 3;
+      const agg::int8u* pv = v + (x * lcd_size + y) * 3;
+      if (memcmp(ph, pv, 3) != 0) transposed = false;
+      if (ph[0] != 255 || ph[1] != 255 || ph[2] != 255) {
+        if (y != 2) stray = true;
+        touched = true;
+      }
+    }
+  }
+  check(touched, name, "the span draws nothing");
+  check(!stray, name, "the span draws outside its row");
+  check(transposed, name, "vertical is not the transposed horizontal");
+
+  // BGR stripes with the color swapped give the RGB result swapped
+  lcd_span<agg::pixfmt_lcd<agg::lcd_layout_rgb24_bgr> >(
+      bgr, agg::rgba8(200, 100, 10));
+  bool swapped = true;
+  for (unsigned i = 0; i < size; i += 3) {
+    if (bgr[i] != h[i + 2] || bgr[i + 1] != h[i + 1] || bgr[i + 2] != h[i]) {
+      swapped = false;
+    }
+  }
+  check(swapped, name, "BGR stripes are not the mirrored RGB ones");
+
+  lcd_span<agg::pixfmt_lcd<agg::lcd_layout_rgb24_vbgr> >(
+      v, agg::rgba8(200, 100, 10));
+  swapped = true;
+  for (unsigned y = 0; y < lcd_size; ++y) {
+    for (unsigned x = 0; x < lcd_size; ++x) {
+      const agg::int8u* ph = h + (y * lcd_size + x) * 3;
+      const agg::int8u* pv = v + (x * lcd_size + y) * 3;
+      if (pv[0] != ph[2] || pv[1] != ph[1] || pv[2] != ph[0]) swapped = false;
+    }
+  }
+  check(swapped, name, "vertical BGR stripes are not the mirrored RGB ones");
+
+  double x = 2.0, y = 5.0;
+  agg::lcd_layout_rgb24_v::subpixel_mtx().transform(&x, &y);
+  check(x == 15.0 && y == 2.0, name, "vertical subpixel_mtx");
+  x = 2.0;
+  y = 5.0;
+  agg::lcd_layout_rgb24::subpixel_mtx().transform(&x, &y);
+  check(x == 6.0 && y == 5.0, name, "horizontal subpixel_mtx");
+}
+
+//------------------------------------------------------------------------
+// 21 values cover both the 8 lane loop and the scalar tail
+void test_lcd_blend_linear16() {
+  const char* name = "lcd_blend_linear16";
+  const unsigned n = 21;
+  agg::int16u d[n], s[n], a[n];
+  for (unsigned k = 0; k < n; ++k) {
+    d[k] = agg::int16u(65535 - k * 3000);
+    s[k] = agg::int16u(k / 3 % 2 * 40000);  // Black text included
+    a[k] = k % 3 == 0 ? 0 : (k % 3 == 1 ? 65535 : 32768);
+  }
+  agg::lcd_blend_linear16(d, s, a, n);
+  bool clear = true, opaque = true, half = true;
+  for (unsigned k = 0; k < n; ++k) {
+    unsigned d0 = 65535 - k * 3000;
+    if (k % 3 == 0 && d[k] != d0) clear = false;
+    if (k % 3 == 1 && d[k] != s[k]) opaque = false;
+    if (k % 3 == 2) {
+      int mid = int(d0 + s[k]) / 2;
+      if (d[k] < mid - 1 || d[k] > mid + 1) half = false;
+    }
+  }
+  check(clear, name, "zero alpha changes the destination");
+  check(opaque, name, "full alpha does not give the source");
+  check(half, name, "half alpha");
+}
+
+//------------------------------------------------------------------------
+// A row with a solid run, a span 3 subpixels after it and a far one
+const int lcd_row = 60;
+const agg::int8u lcd_left[] = {40, 180, 255, 255, 255, 255, 255, 255,
+                               255, 255, 255, 255, 255, 255, 120, 30};
+const agg::int8u lcd_mid[] = {60, 200, 90};
+const agg::int8u lcd_far[] = {255, 255, 255, 100};
+
+template <class Scanline>
+void lcd_scanline_row(agg::int8u* buf, Scanline& sl) {
+  typedef agg::pixfmt_lcd<agg::lcd_layout_rgb24> pixfmt_type;
+  typedef agg::renderer_base<pixfmt_type> base_ren_type;
+  memset(buf, 255, lcd_row);
+  agg::rendering_buffer rbuf(buf, lcd_row / 3, 1, lcd_row);
+  agg::lcd_distribution_lut lut(1.0 / 3.0, 2.0 / 9.0, 1.0 / 9.0);
+  pixfmt_type pf(rbuf, lut);
+  base_ren_type ren_base(pf);
+  agg::renderer_scanline_lcd_solid<base_ren_type> ren(ren_base);
+  ren.color(agg::rgba8(20, 60, 160));
+  ren.prepare();
+  ren.render(sl);
+}
+
+void test_lcd_scanline() {
+  const char* name = "lcd_scanline";
+  const int left = 5, mid = left + sizeof(lcd_left) + 3, far = 50;
+
+  agg::scanline_u8 sl_u;
+  sl_u.reset(0, lcd_row - 1);
+  for (unsigned k = 0; k < sizeof(lcd_left); ++k)
+    sl_u.add_cell(left + k, lcd_left[k]);
+  for (unsigned k = 0; k < sizeof(lcd_mid); ++k)
+    sl_u.add_cell(mid + k, lcd_mid[k]);
+  for (unsigned k = 0; k < sizeof(lcd_far); ++k)
+    sl_u.add_cell(far + k, lcd_far[k]);
+  sl_u.finalize(0);
+
+  // The rasterizer gives the solid runs to scanline_p8 as hlines
+  agg::scanline_p8 sl_p;
+  sl_p.reset(0, lcd_row - 1);
+  sl_p.add_cell(left, lcd_left[0]);
+  sl_p.add_cell(left + 1, lcd_left[1]);
+  sl_p.add_span(left + 2, sizeof(lcd_left) - 4, 255);
+  sl_p.add_cell(left + sizeof(lcd_left) - 2, lcd_left[sizeof(lcd_left) - 2]);
+  sl_p.add_cell(left + sizeof(lcd_left) - 1, lcd_left[sizeof(lcd_left) - 1]);
+  for (unsigned k = 0; k < sizeof(lcd_mid); ++k)
+    sl_p.add_cell(mid + k, lcd_mid[k]);
+  sl_p.add_span(far, 3, 255);
+  sl_p.add_cell(far + 3, lcd_far[3]);
+  sl_p.finalize(0);
+
+  agg::int8u u[lcd_row], p[lcd_row], ref[lcd_row];
+  lcd_scanline_row(u, sl_u);
+  lcd_scanline_row(p, sl_p);
+  check(memcmp(u, p, lcd_row) == 0, name,
+        "scanline_p8 output differs from scanline_u8");
+
+  // Reference: one hspan for the close spans, one for the far span
+  agg::int8u covers[far - left];
+  memset(covers, 0, sizeof(covers));
+  memcpy(covers, lcd_left, sizeof(lcd_left));
+  memcpy(covers + (mid - left), lcd_mid, sizeof(lcd_mid));
+  memset(ref, 255, lcd_row);
+  agg::rendering_buffer rbuf(ref, lcd_row / 3, 1, lcd_row);
+  agg::lcd_distribution_lut lut(1.0 / 3.0, 2.0 / 9.0, 1.0 / 9.0);
+  agg::pixfmt_lcd<agg::lcd_layout_rgb24> pf(rbuf, lut);
+  agg::rgba8 c(20, 60, 160);
+  pf.blend_solid_hspan(left, 0, mid + sizeof(lcd_mid) - left, c, covers);
+  pf.blend_solid_hspan(far, 0, sizeof(lcd_far), c, lcd_far);
+  check(memcmp(u, ref, lcd_row) == 0, name,
+        "close spans are not filtered as one hspan");
+}
+
+//------------------------------------------------------------------------
+// Solid runs skip the filter: the result must not change. The reference
+// filters every subpixel of a horizontal RGB row.
+enum lcd_blend_e { lcd_plain, lcd_gamma, lcd_linear };
+
+const unsigned lcd_run_row = 48;
+const agg::int8u lcd_runs[] = {30,  200, 255, 255, 255, 255, 255, 255, 255,
+                               255, 255, 255, 255, 255, 255, 255, 255, 180,
+                               60,  255, 255, 255, 255, 255, 255, 255, 90};
+
+void lcd_run_dest(agg::int8u* row) {
+  for (unsigned k = 0; k < lcd_run_row; ++k) row[k] = agg::int8u(250 - k * 5);
+}
+
+template <class Gamma>
+void lcd_run_reference(agg::int8u* row, int x, const agg::rgba8& c,
+                       lcd_blend_e blend, const Gamma& gamma) {
+  agg::lcd_distribution_lut lut(1.0 / 3.0, 2.0 / 9.0, 1.0 / 9.0);
+  const unsigned len = sizeof(lcd_runs);
+  const agg::int8u rgb[3] = {c.r, c.g, c.b};
+  for (int cx = -2; cx <= int(len) + 1; ++cx) {
+    unsigned c_conv = lut.convolution(lcd_runs, cx, 0, len - 1);
+    agg::int8u* q = row + x + cx;
+    unsigned dst_col = rgb[(x + cx) % 3], src_col = *q;
+    if (blend == lcd_plain) {
+      unsigned alpha = (c_conv + 1) * (c.a + 1);
+      *q = agg::int8u((((dst_col - src_col) * alpha) + (src_col << 16)) >> 16);
+    } else if (blend == lcd_gamma) {
+      unsigned alpha = (c_conv + 1) * (c.a + 1);
+      dst_col = gamma.dir(agg::int8u(dst_col));
+      src_col = gamma.dir(agg::int8u(src_col));
+      *q = gamma.inv(
+          (((dst_col - src_col) * alpha) + (src_col << 16)) >> 16);
+    } else {
+      agg::int16u lin = gamma.dir(*q);
+      agg::int16u src = gamma.dir(agg::int8u(dst_col));
+      agg::int16u alpha = agg::int16u((c_conv * c.a * 66051u) >> 16);
+      agg::lcd_blend_linear16(&lin, &src, &alpha, 1);
+      *q = gamma.inv(lin);
+    }
+  }
+}
+
+template <class PixFmt, class Gamma>
+bool lcd_runs_match(lcd_blend_e blend, const Gamma& gamma,
+                    const agg::rgba8& c) {
+  agg::lcd_distribution_lut lut(1.0 / 3.0, 2.0 / 9.0, 1.0 / 9.0);
+  bool match = true;
+  for (int x = 6; x < 9; ++x) {
+    agg::int8u row[lcd_run_row], ref[lcd_run_row];
+    lcd_run_dest(row);
+    lcd_run_dest(ref);
+    agg::rendering_buffer rbuf(row, lcd_run_row / 3, 1, lcd_run_row);
+    PixFmt pf(rbuf, lut, gamma);
+    pf.blend_solid_hspan(x, 0, sizeof(lcd_runs), c, lcd_runs);
+    lcd_run_reference(ref, x, c, blend, gamma);
+    if (memcmp(row, ref, lcd_run_row) != 0) match = false;
+  }
+  return match;
+}
+
+// pixfmt_lcd takes no gamma: adapt its constructor
+template <class Layout>
+struct pixfmt_lcd_plain : agg::pixfmt_lcd<Layout> {
+  template <class Gamma>
+  pixfmt_lcd_plain(agg::rendering_buffer& rb,
+                   const agg::lcd_distribution_lut& lut, const Gamma&)
+      : agg::pixfmt_lcd<Layout>(rb, lut) {}
+};
+
+void test_lcd_full_cover_run() {
+  const char* name = "lcd_full_cover_run";
+  typedef agg::gamma_lut<> gamma8_type;
+  gamma8_type gamma8(1.8);
+  agg::lcd_gamma_lut16 gamma16(2.2);
+  const agg::rgba8 colors[] = {agg::rgba8(20, 60, 160),
+                               agg::rgba8(220, 40, 90, 140)};
+  for (unsigned k = 0; k < 2; ++k) {
+    check(lcd_runs_match<pixfmt_lcd_plain<agg::lcd_layout_rgb24> >(
+              lcd_plain, gamma8, colors[k]),
+          name, "pixfmt_lcd solid runs differ from the filtered result");
+    check(lcd_runs_match<
+              agg::pixfmt_lcd_gamma<agg::lcd_layout_rgb24, gamma8_type> >(
+              lcd_gamma, gamma8, colors[k]),
+          name, "pixfmt_lcd_gamma solid runs differ from the filtered result");
+    check(lcd_runs_match<agg::pixfmt_lcd_linear<agg::lcd_layout_rgb24,
+                                                agg::lcd_gamma_lut16> >(
+              lcd_linear, gamma16, colors[k]),
+          name,
+          "pixfmt_lcd_linear solid runs differ from the filtered result");
+  }
+}
+
+//------------------------------------------------------------------------
+void test_utf8_decode() {
+  const char* name = "utf8_decode";
+  unsigned codes[16];
+  const char valid[] = "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80";
+  unsigned n = agg::utf8_decode(valid, sizeof(valid) - 1, codes);
+  check(n == 4 && codes[0] == 'a' && codes[1] == 0xE9 &&
+            codes[2] == 0x20AC && codes[3] == 0x1F600,
+        name, "valid sequences");
+
+  // Overlong, surrogate, stray continuation, bad lead and truncated
+  const char bad[] = "\xC0\x80\xED\xA0\x80\x80\xFF\xE2\x82";
+  n = agg::utf8_decode(bad, sizeof(bad) - 1, codes);
+  bool all_replaced = n == 5;
+  for (unsigned i = 0; i < n; ++i) {
+    if (codes[i] != 0xFFFD) all_replaced = false;
+  }
+  check(all_replaced, name, "malformed sequences decode as U+FFFD");
+
+  char text[40];
+  memset(text, 'x', sizeof(text));
+  check(agg::utf8_is_ascii(text, sizeof(text)), name, "ASCII text");
+  text[37] = char(0xC3);
+  check(!agg::utf8_is_ascii(text, sizeof(text)), name,
+        "non-ASCII byte after the 16 byte blocks");
+}
+
+//------------------------------------------------------------------------
+// Engine and cache manager giving every code the same glyph
+struct fake_engine {
+  const char* font_signature() const { return "fake"; }
+  double height() const { return 10.0; }
+  bool flip_y() const { return false; }
+  bool add_kerning(unsigned, unsigned, double*, double*) { return false; }
+};
+
+struct fake_cache_manager {
+  agg::glyph_cache g;
+  unsigned lookups;
+
+  fake_cache_manager() : lookups(0) {
+    g.glyph_index = 1;
+    g.data = 0;
+    g.data_size = 0;
+    g.data_type = agg::glyph_data_outline;
+    g.bounds = agg::rect_i(0, 0, 5, 8);
+    g.advance_x = 6.0;
+    g.advance_y = 0.0;
+  }
+
+  const agg::glyph_cache* glyph(unsigned) {
+    ++lookups;
+    return &g;
+  }
+};
+
+// Glyph sink keeping the last pen position
+struct glyph_counter {
+  unsigned glyphs;
+  unsigned lines;
+  double x;
+  double y;
+
+  glyph_counter() : glyphs(0), lines(0), x(0.0), y(0.0) {}
+  void add_glyph(const agg::glyph_cache*, unsigned, double gx, double gy) {
+    ++glyphs;
+    x = gx;
+    y = gy;
+  }
+  void end_line() { ++lines; }
+};
+
+void test_layout_cache() {
+  const char* name = "layout_cache";
+  fake_engine feng;
+  fake_cache_manager fman;
+  agg::text_layout_cache cache(2);
+
+  const agg::text_layout* ab = cache.layout(feng, fman, "ab\nc", 4);
+  check(ab && ab->num_glyphs == 3 && ab->num_lines == 2, name, "layout");
+  unsigned lookups = fman.lookups;
+  check(cache.layout(feng, fman, "ab\nc", 4) == ab &&
+            fman.lookups == lookups && cache.hits() == 1,
+        name, "a hit looks glyphs up");
+
+  // "ab\nc" is the most recent, "x" goes first
+  cache.layout(feng, fman, "x", 1);
+  cache.layout(feng, fman, "ab\nc", 4);
+  cache.layout(feng, fman, "yz", 2);
+  check(cache.size() == 2, name, "size above max_layouts");
+  unsigned misses = cache.misses();
+  cache.layout(feng, fman, "ab\nc", 4);
+  check(cache.misses() == misses, name, "the most recent layout is evicted");
+  cache.layout(feng, fman, "x", 1);
+  check(cache.misses() == misses + 1, name, "the oldest layout is kept");
+
+  glyph_counter counter;
+  agg::layout_glyphs(ab->glyphs, ab->num_glyphs, 100.0, 50.0, counter);
+  check(counter.glyphs == 3 && counter.lines == 2 && counter.x == 100.0 &&
+            counter.y == 50.0 - 12.5,
+        name, "layout_glyphs replays the layout");
+
+  cache.clear();
+  check(cache.size() == 0 && cache.byte_size() == 0, name, "clear");
+}
+
+//------------------------------------------------------------------------
+void test_glyph_file() {
+  const char* name = "glyph_file";
+  const char* file_name = "agg-font-unit-test.glyphs";
+  const agg::int8u data[] = {1, 2, 3, 4, 5, 6, 7};
+
+  agg::glyph_file_writer writer;
+  writer.add_font("12,0,4,0,0:16x16,0,0,00000000", 0x1234, 8);
+  writer.add_glyph('A', 36, data, sizeof(data), agg::glyph_data_gray8,
+                   agg::rect_i(-1, -2, 5, 9), 6.5, 0.0);
+  writer.add_glyph('B', 37, data, 3, agg::glyph_data_mono,
+                   agg::rect_i(0, 0, 4, 4), 7.0, 0.0);
+  writer.add_font("24,0,4,0,0:16x16,0,0,00000000", 0x1234, 8);
+  writer.add_glyph('A', 36, data + 1, 2, agg::glyph_data_gray8,
+                   agg::rect_i(0, 0, 2, 1), 13.0, 0.0);
+  check(writer.save(file_name), name, "save");
+
+  agg::glyph_file file;
+  check(file.open(file_name) && file.num_fonts() == 2, name, "open");
+  int font = file.find_font("24,0,4,0,0:16x16,0,0,00000000", 0x1234, 8);
+  check(font == 1, name, "find_font");
+  check(file.find_font("24,0,4,0,0:16x16,0,0,00000000", 0x4321, 8) < 0,
+        name, "find_font with another font hash");
+  check(file.find_font("24,0,4,0,0:16x16,0,0,00000000", 0x1234, 16) < 0,
+        name, "find_font with another vertex size");
+
+  const agg::glyph_cache* g = file.find_glyph(0, 'A');
+  check(g && g->glyph_index == 36 && g->data_size == sizeof(data) &&
+            memcmp(g->data, data, sizeof(data)) == 0 &&
+            g->data_type == agg::glyph_data_gray8 && g->bounds.x1 == -1 &&
+            g->bounds.y1 == -2 && g->bounds.x2 == 5 && g->bounds.y2 == 9 &&
+            g->advance_x == 6.5,
+        name, "glyph read back");
+  g = file.find_glyph(font, 'A');
+  check(g && g->data_size == 2 && g->data[0] == 2 && g->advance_x == 13.0,
+        name, "glyph of the second font");
+  check(file.find_glyph(font, 'B') == 0, name, "glyph not in the font");
+  file.close();
+
+  // A truncated file is rejected
+  FILE* fd = fopen(file_name, "wb");
+  if (fd) {
+    fwrite("AGG", 1, 3, fd);
+    fclose(fd);
+  }
+  check(!file.open(file_name), name, "truncated file");
+  remove(file_name);
+}
+
+//------------------------------------------------------------------------
+void test_arena() {
+  const char* name = "arena";
+  agg::font_block_pool pool(256, 4);
+  {
+    agg::font_arena arena(pool);
+    agg::int8u* first = arena.allocate(10);
+    agg::int8u* aligned = arena.allocate(8, 8);
+    check(first && ((size_t)aligned % 8) == 0, name, "alignment");
+    check(arena.bytes_used() == 18 && arena.bytes_reserved() == 256,
+          name, "allocations share a block");
+    arena.allocate(1000);
+    check(arena.bytes_reserved() == 1256 && pool.bytes_in_use() == 1256,
+          name, "block of a larger allocation");
+
+    arena.reset();
+    check(arena.bytes_used() == 0 && arena.bytes_reserved() == 256 &&
+              pool.bytes_in_use() == 256,
+          name, "blocks kept by reset");
+    check(arena.allocate(10) == first, name, "reset does not reuse the blocks");
+
+    arena.release();
+    check(arena.bytes_reserved() == 0 && pool.bytes_in_use() == 0 &&
+              pool.bytes_free() == 256,
+          name, "blocks given back by release");
+
+    agg::font_arena other(pool);
+    check(other.allocate(10) == first && pool.bytes_free() == 0, name,
+          "the pool does not hand the block out again");
+  }
+  pool.trim();
+  check(pool.bytes_free() == 0, name, "trim");
+}
+
+//------------------------------------------------------------------------
+void test_budget_cache() {
+  const char* name = "budget_cache";
+  const unsigned max_bytes = 4096;
+  agg::glyph_budget_cache cache(max_bytes);
+  cache.font("a");
+  for (unsigned code = 0; code < 100; ++code) {
+    agg::glyph_cache* g = cache.cache_glyph(code, code, 200,
+                                            agg::glyph_data_gray8,
+                                            agg::rect_i(0, 0, 10, 20), 1, 0);
+    if (g) memset(g->data, int(code), 200);
+  }
+  check(cache.bytes_used() <= max_bytes, name, "bytes over the budget");
+  check(cache.evictions() > 0 && cache.generation() > 0, name,
+        "eviction does not change the generation");
+  check(cache.num_glyphs() + cache.evictions() == 100, name,
+        "glyph count");
+  check(cache.find_glyph(0) == 0, name, "the oldest glyph is kept");
+
+  // Touching a glyph keeps it over older ones
+  const agg::glyph_cache* g = cache.find_glyph(98);
+  check(g && g->data[0] == 98, name, "a recent glyph is evicted");
+  unsigned oldest = 100 - cache.num_glyphs();
+  check(cache.find_glyph(oldest) != 0, name, "the oldest glyph kept is missing");
+  cache.cache_glyph(100, 100, 200, agg::glyph_data_gray8,
+                    agg::rect_i(0, 0, 10, 20), 1, 0);
+  check(cache.find_glyph(oldest) != 0 && cache.find_glyph(98) != 0 &&
+            cache.find_glyph(oldest + 1) == 0,
+        name, "eviction is not least recently used");
+
+  // A glyph larger than the budget spares the two most recent ones
+  cache.cache_glyph(101, 101, max_bytes * 2, agg::glyph_data_gray8,
+                    agg::rect_i(0, 0, 10, 20), 1, 0);
+  check(cache.num_glyphs() == 3 && cache.find_glyph(101) != 0 &&
+            cache.find_glyph(98) != 0,
+        name, "the two most recent glyphs are evicted");
+
+  unsigned generation = cache.generation();
+  check(cache.remove_glyph(101) && cache.find_glyph(101) == 0 &&
+            !cache.remove_glyph(101) && cache.generation() != generation,
+        name, "remove_glyph");
+
+  generation = cache.generation();
+  cache.clear();
+  check(cache.num_glyphs() == 0 && cache.generation() != generation, name,
+        "clear");
+}
+
+//------------------------------------------------------------------------
+void test_distance_field() {
+  const char* name = "distance_field";
+  agg::distance_field df;
+  df.move_to(0, 0);
+  df.line_to(10, 0);
+  df.line_to(10, 10);
+  df.line_to(0, 10);
+  df.close_polygon();
+
+  const double spread = 2.0;
+  agg::rect_i b = df.bounds(spread);
+  check(b.x1 == -2 && b.y1 == -2 && b.x2 == 12 && b.y2 == 12, name,
+        "bounds");
+  const unsigned w = 14;
+  agg::int8u field[w * w];
+  memset(field, 77, sizeof(field));
+  df.build(field, b, spread);
+
+  // Row through the middle of the square, x = -2 .. 11
+  const agg::int8u* row = field + 7 * w;
+  check(field[0] == 0 && row[7] == 255, name,
+        "saturation beyond spread");
+  check(row[1] < 128 && row[2] > 127, name, "outline value");
+  check(row[1] + row[2] == 255 && row[11] + row[12] == 255, name,
+        "distances are not symmetric about the outline");
+  bool monotonic = true;
+  for (unsigned x = 1; x <= 7; ++x) {
+    if (row[x] < row[x - 1]) monotonic = false;
+  }
+  check(monotonic, name, "distance does not grow inwards");
+
+  df.reset();
+  b = df.bounds(spread);
+  check(b.x1 > b.x2, name, "empty field bounds");
+}
+
+//------------------------------------------------------------------------
+// 4x4 BGRA strike, opaque red texels on odd columns of the left half
+void test_color_bitmap() {
+  const char* name = "color_bitmap";
+  agg::int8u strike[4 * 4 * 4];
+  memset(strike, 0, sizeof(strike));
+  for (unsigned i = 0; i < 16; ++i) {
+    if (i % 4 == 1) strike[i * 4 + 2] = strike[i * 4 + 3] = 255;
+  }
+
+  agg::int8u half[2 * 2 * 4];
+  agg::color_bitmap_resample(strike, 4, 4, 0.0, 0.0, 0.5, 0.5, half, 2, 2);
+  check(half[2] == 128 && half[3] == 128 && half[6] == 0 && half[7] == 0 &&
+            memcmp(half, half + 8, 8) == 0,
+        name, "box average at half size");
+
+  // A quarter pixel offset moves a quarter of each texel to the next pixel
+  agg::int8u shifted[3 * 1 * 4];
+  agg::color_bitmap_resample(strike, 2, 1, 0.25, 0.0, 1.0, 1.0, shifted, 3,
+                             1);
+  check(shifted[3] == 0 && shifted[7] == 191 && shifted[11] == 64, name,
+        "offset");
+
+  agg::glyph_cache g;
+  g.glyph_index = 5;
+  g.data = strike;
+  g.data_size = sizeof(strike);
+  g.data_type = agg::glyph_data_invalid;
+  g.bounds = agg::rect_i(-1, -3, 3, 1);
+  g.advance_x = 4.0;
+  g.advance_y = 0.0;
+  agg::color_bitmap_cache cache;
+  cache.font("sig", 0.5, 0.5);
+  const agg::glyph_cache* s = cache.scaled(&g);
+  check(s && s->bounds.x1 == -1 && s->bounds.y1 == -2 &&
+            s->bounds.x2 == 2 && s->bounds.y2 == 1 && s->data_size == 36,
+        name, "scaled bounds");
+  check(cache.scaled(&g) == s, name, "scaled glyph not cached");
+  cache.font("sig", 0.25, 0.25);
+  check(cache.scaled(&g) != s && cache.bitmaps().num_glyphs() == 2, name,
+        "another scale shares the bitmap");
+}
+
+}  // namespace
+
+int main() {
+  test_lcd_orientation();
+  test_lcd_blend_linear16();
+  test_lcd_scanline();
+  test_lcd_full_cover_run();
+  test_utf8_decode();
+  test_layout_cache();
+  test_glyph_file();
+  test_arena();
+  test_budget_cache();
+  test_distance_field();
+  test_color_bitmap();
+
+  printf("%u checks, %u failed\n", num_checks, num_failed);
+  return num_failed ? 1 : 0;
+}
@@ -0,0 +1,201 @@
+//----------------------------------------------------------------------------
+// Anti-Grain Geometry - Version 2.4
+// Copyright (C) 2002-2005 Maxim Shemanarev (http://www.antigrain.com)
+//
+// Permission to copy, use, modify, sell and distribute this software
+// is granted provided this copyright notice appears in all copies.
+// This software is provided "as is" without express or implied
+// warranty, and with no claim as to its suitability for any purpose.
+//
+//----------------------------------------------------------------------------
+// Contact: mcseem@antigrain.com
+//          mcseemagg@yahoo.com
+//          http://www.antigrain.com
+//----------------------------------------------------------------------------
+
+// Pre-bakes the glyphs of a font for a list of sizes into a glyph file
+// that can be loaded at startup with agg::glyph_file.
+//
+//   agg-font-bake [options] font-file size...
+//
+// The engine parameters given here are part of the font signature and
+// have to match those of the application for the glyphs to be used.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "agg_font_freetype.h"
+#include "agg_font_glyph_file.h"
+#include "agg_font_utf8.h"
+
+namespace {
+
+struct bake_options {
+  const char* output;
+  const char* chars;
+  agg::glyph_rendering mode;
+  unsigned face_index;
+  unsigned resolution;
+  double width;
+  agg::font_hinting_e hinting;
+  bool flip_y;
+  bool int16;
+};
+
+void usage() {
+  fprintf(stderr,
+          "usage: agg-font-bake [options] font-file size...\n"
+          "  -o file   output glyph file (default glyphs.bin)\n"
+          "  -m mode   mono, gray8, outline, agg-mono or agg-gray8 "
+          "(default outline)\n"
+          "  -c chars  UTF-8 characters to bake (default printable ASCII)\n"
+          "  -i index  face index (default 0)\n"
+          "  -r dpi    resolution (default 0, sizes in pixels)\n"
+          "  -w width  character width (default 0, same as size)\n"
+          "  -H hint   none, light, native or autohint (default none)\n"
+          "  -f        flip y\n"
+          "  -s        16-bit outline coordinates "
+          "(font_engine_freetype_int16)\n");
+}
+
+bool parse_mode(const char* s, agg::glyph_rendering* mode) {
+  static const struct {
+    const char* name;
+    agg::glyph_rendering mode;
+  } modes[] = {{"mono", agg::glyph_ren_native_mono},
+               {"gray8", agg::glyph_ren_native_gray8},
+               {"outline", agg::glyph_ren_outline},
+               {"agg-mono", agg::glyph_ren_agg_mono},
+               {"agg-gray8", agg::glyph_ren_agg_gray8}};
+  for (unsigned i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i) {
+    if (strcmp(s, modes[i].name) == 0) {
+      *mode = modes[i].mode;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool parse_hinting(const char* s, agg::font_hinting_e* hinting) {
+  static const struct {
+    const char* name;
+    agg::font_hinting_e hinting;
+  } modes[] = {{"none", agg::font_hinting_none},
+               {"light", agg::font_hinting_light},
+               {"native", agg::font_hinting_native},
+               {"autohint", agg::font_hinting_autohint}};
+  for (unsigned i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i) {
+    if (strcmp(s, modes[i].name) == 0) {
+      *hinting = modes[i].hinting;
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class FontEngine>
+bool bake(const bake_options& opt, const char* font_file,
+          char** sizes, int num_sizes) {
+  FontEngine feng;
+  if (opt.resolution) feng.resolution(opt.resolution);
+  feng.hinting(opt.hinting);
+  feng.flip_y(opt.flip_y);
+  if (!feng.load_font(font_file, opt.face_index, opt.mode)) {
+    fprintf(stderr, "cannot load font %s (error %d)\n", font_file,
+            feng.last_error());
+    return false;
+  }
+
+  unsigned len = unsigned(strlen(opt.chars));
+  agg::pod_array<unsigned> codes(len + 1);
+  unsigned num_codes = agg::utf8_decode(opt.chars, len, &codes[0]);
+  agg::int32u font_hash = agg::font_file_hash(font_file);
+
+  agg::glyph_file_writer writer;
+  for (int i = 0; i < num_sizes; ++i) {
+    double size = atof(sizes[i]);
+    if (size <= 0.0) {
+      fprintf(stderr, "invalid size %s\n", sizes[i]);
+      return false;
+    }
+    feng.height(size);
+    if (opt.width > 0.0) feng.width(opt.width);
+    unsigned n =
+        agg::bake_glyphs(feng, writer, &codes[0], num_codes, font_hash);
+    printf("%s: %u glyphs\n", feng.font_signature(), n);
+  }
+
+  if (!writer.save(opt.output)) {
+    fprintf(stderr, "cannot write %s\n", opt.output);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  static char ascii[96];
+  for (int c = 32; c < 127; ++c) ascii[c - 32] = char(c);
+
+  bake_options opt;
+  opt.output = "glyphs.bin";
+  opt.chars = ascii;
+  opt.mode = agg::glyph_ren_outline;
+  opt.face_index = 0;
+  opt.resolution = 0;
+  opt.width = 0.0;
+  opt.hinting = agg::font_hinting_none;
+  opt.flip_y = false;
+  opt.int16 = false;
+
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-'; ++i) {
+    const char* arg = argv[i];
+    bool has_value =
+        arg[1] != 0 && strchr("omciwrH", arg[1]) != 0 && arg[2] == 0;
+    if (has_value && i + 1 >= argc) {
+      usage();
+      return 1;
+    }
+    if (strcmp(arg, "-o") == 0) {
+      opt.output = argv[++i];
+    } else if (strcmp(arg, "-m") == 0) {
+      if (!parse_mode(argv[++i], &opt.mode)) {
+        usage();
+        return 1;
+      }
+    } else if (strcmp(arg, "-c") == 0) {
+      opt.chars = argv[++i];
+    } else if (strcmp(arg, "-i") == 0) {
+      opt.face_index = unsigned(atoi(argv[++i]));
+    } else if (strcmp(arg, "-r") == 0) {
+      opt.resolution = unsigned(atoi(argv[++i]));
+    } else if (strcmp(arg, "-w") == 0) {
+      opt.width = atof(argv[++i]);
+    } else if (strcmp(arg, "-H") == 0) {
+      if (!parse_hinting(argv[++i], &opt.hinting)) {
+        usage();
+        return 1;
+      }
+    } else if (strcmp(arg, "-f") == 0) {
+      opt.flip_y = true;
+    } else if (strcmp(arg, "-s") == 0) {
+      opt.int16 = true;
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (argc - i < 2) {
+    usage();
+    return 1;
+  }
+
+  bool ok = opt.int16 ? bake<agg::font_engine_freetype_int16>(
+                            opt, argv[i], argv + i + 1, argc - i - 1)
+                      : bake<agg::font_engine_freetype_int32>(
+                            opt, argv[i], argv + i + 1, argc - i - 1);
+  return ok ? 0 : 1;
+}